@@ -0,0 +1,65 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "alloc_counter.h"
+
+using namespace std;
+
+atomic<unsigned long long> g_allocationCount{0};
+thread_local unsigned long long t_allocationCount = 0;
+thread_local AllocationHook t_allocationHook = NULL;
+
+unsigned long long GetAllocationCount()
+{
+  return g_allocationCount.load(memory_order_relaxed);
+}
+
+unsigned long long GetThreadAllocationCount()
+{
+  return t_allocationCount;
+}
+
+void SetThreadAllocationHook(AllocationHook hook)
+{
+  t_allocationHook = hook;
+}
+
+void *operator new(size_t size)
+{
+  g_allocationCount.fetch_add(1, memory_order_relaxed);
+  t_allocationCount++;
+  if (t_allocationHook != NULL)
+  {
+    t_allocationHook(size);
+  }
+  if (void *memory = malloc(size == 0 ? 1 : size))
+  {
+    return memory;
+  }
+  throw bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+  free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+  free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+  free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+  free(memory);
+}
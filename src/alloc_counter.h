@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+// Replaces the global operator new/delete with versions that count calls, so
+// we can tell how many heap allocations a frame makes. Only C++ allocations
+// are seen; SDL's own malloc calls are not.
+unsigned long long GetAllocationCount();
+// Only the calling thread's, so background threads that are allowed to
+// allocate (world generation, asset decoding) don't muddy a frame's count.
+unsigned long long GetThreadAllocationCount();
+
+// Called on every allocation the calling thread makes from now on, with its
+// size, until replaced; NULL removes it. It must not allocate itself.
+typedef void (*AllocationHook)(size_t size);
+void SetThreadAllocationHook(AllocationHook hook);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <SDL.h>
+#include "content.h"
+
+using namespace std;
+
+// Plays animation clips from the content for any number of sprites. Each
+// sprite is a slot in a few parallel arrays holding only what stepping it
+// needs, so Tick() is one straight pass over all of them with no per-sprite
+// branching on what the sprite is or which clip it plays.
+class Animator
+{
+public:
+  Animator(const Content *content);
+
+  // A new sprite playing clip from startFrame (counted from the clip's
+  // first frame). Returns its index.
+  int Add(int clip, int startFrame = 0);
+  int GetCount() const;
+
+  // Starts clip from its first frame, unless the sprite already plays it.
+  // keepPhase carries the frame number and time left on it over instead,
+  // for the same motion seen from another side.
+  void Play(int sprite, int clip, bool keepPhase = false);
+
+  // Advances every sprite by one simulation tick.
+  void Tick();
+
+  int GetClip(int sprite) const;
+  // Frame number within the clip.
+  int GetFrame(int sprite) const;
+  const SDL_Rect &GetRect(int sprite) const;
+
+  // For save files: how many more ticks the current frame shows for.
+  int GetTicksLeft(int sprite) const;
+  // Puts a sprite back on frame of clip as saved. False, changing nothing,
+  // if the content has no such frame.
+  bool Restore(int sprite, int clip, int frame, int ticksLeft);
+
+private:
+  const SDL_Rect *frameRects;
+  const int *frameTicks;
+  const Content *content;
+
+  // Stepped every tick. Frames index frameRects and frameTicks directly.
+  vector<int> frames;
+  vector<int> ticksLeft;
+  vector<int> clipStarts;
+  vector<int> clipEnds;
+  // Only read when a sprite changes clip.
+  vector<int> clips;
+};
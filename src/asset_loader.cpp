@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SDL.h>
+#include <SDL_image.h>
+#include "asset_loader.h"
+
+using namespace std;
+
+AssetLoader::AssetLoader(int threads) : epoch(chrono::steady_clock::now())
+{
+  if (threads <= 0)
+  {
+    threads = max(1, (int)thread::hardware_concurrency());
+  }
+  for (int worker = 0; worker < threads; worker++)
+  {
+    workers.emplace_back(&AssetLoader::WorkerLoop, this, worker);
+  }
+}
+
+AssetLoader::~AssetLoader()
+{
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  workAvailable.notify_all();
+  for (thread &worker : workers)
+  {
+    worker.join();
+  }
+  for (Job *job : jobs)
+  {
+    // Only set if the callback never ran.
+    if (job->surface != NULL)
+    {
+      SDL_FreeSurface(job->surface);
+    }
+    delete job;
+  }
+}
+
+void AssetLoader::LoadImage(const string &path, function<void(SDL_Surface *)> onLoaded)
+{
+  Job *job = new Job();
+  job->path = path;
+  job->isImage = true;
+  job->onImageLoaded = move(onLoaded);
+  Queue(job);
+}
+
+void AssetLoader::LoadFile(const string &path, function<void(vector<char> &)> onLoaded)
+{
+  Job *job = new Job();
+  job->path = path;
+  job->isImage = false;
+  job->onFileLoaded = move(onLoaded);
+  Queue(job);
+}
+
+void AssetLoader::Queue(Job *job)
+{
+  job->queuedMs = NowMs();
+  jobs.push_back(job);
+  {
+    lock_guard<mutex> guard(lock);
+    pending.push_back(job);
+  }
+  workAvailable.notify_one();
+}
+
+void AssetLoader::WorkerLoop(int worker)
+{
+  while (true)
+  {
+    Job *job;
+    {
+      unique_lock<mutex> guard(lock);
+      workAvailable.wait(guard, [this]
+                         { return stopping || !pending.empty(); });
+      if (stopping)
+      {
+        return;
+      }
+      job = pending.front();
+      pending.pop_front();
+    }
+
+    job->worker = worker;
+    job->startMs = NowMs();
+    if (job->isImage)
+    {
+      job->surface = IMG_Load(job->path.c_str());
+      if (job->surface == NULL)
+      {
+        job->error = IMG_GetError();
+      }
+    }
+    else
+    {
+      ifstream in(job->path, ios::binary);
+      if (in)
+      {
+        job->data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+      }
+    }
+    job->loadedMs = NowMs();
+
+    {
+      lock_guard<mutex> guard(lock);
+      finished.push_back(job);
+    }
+    workFinished.notify_one();
+  }
+}
+
+bool AssetLoader::Update()
+{
+  while (true)
+  {
+    Job *job;
+    {
+      lock_guard<mutex> guard(lock);
+      if (finished.empty())
+      {
+        break;
+      }
+      job = finished.front();
+      finished.pop_front();
+    }
+
+    if (job->isImage)
+    {
+      if (job->surface == NULL)
+      {
+        printf("Unable to load %s! SDL_image Error: %s\n", job->path.c_str(), job->error.c_str());
+      }
+      SDL_Surface *surface = job->surface;
+      job->surface = NULL;
+      job->onImageLoaded(surface);
+    }
+    else
+    {
+      if (job->data.empty())
+      {
+        printf("Unable to read %s\n", job->path.c_str());
+      }
+      job->onFileLoaded(job->data);
+      vector<char>().swap(job->data);
+    }
+    job->handledMs = NowMs();
+    handledCount++;
+  }
+  return handledCount == (int)jobs.size();
+}
+
+void AssetLoader::Finish()
+{
+  while (!Update())
+  {
+    unique_lock<mutex> guard(lock);
+    workFinished.wait(guard, [this]
+                      { return !finished.empty(); });
+  }
+}
+
+double AssetLoader::GetProgress() const
+{
+  return jobs.empty() ? 1.0 : (double)handledCount / jobs.size();
+}
+
+void AssetLoader::PrintTimeline() const
+{
+  printf("Asset timeline (ms since loader start):\n");
+  for (const Job *job : jobs)
+  {
+    printf("  %7.1f queued  %7.1f - %7.1f %s on worker %d  %7.1f handled  %s\n",
+           job->queuedMs, job->startMs, job->loadedMs, job->isImage ? "decode" : "read  ",
+           job->worker, job->handledMs, job->path.c_str());
+  }
+}
+
+double AssetLoader::NowMs() const
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - epoch).count();
+}
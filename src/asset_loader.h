@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SDL.h>
+
+using namespace std;
+
+// Reads and decodes assets on a pool of worker threads. Anything that has to
+// touch the renderer or the mixer happens in the onLoaded callbacks, which
+// Update() runs on the calling (render) thread as each asset finishes, so a
+// texture is uploaded as soon as its PNG is decoded instead of after all of
+// them.
+class AssetLoader
+{
+public:
+  // threads <= 0 uses one per core.
+  AssetLoader(int threads = 0);
+  ~AssetLoader();
+
+  // onLoaded gets the decoded surface and owns it; NULL if decoding failed.
+  void LoadImage(const string &path, function<void(SDL_Surface *)> onLoaded);
+  // onLoaded gets the file contents; empty if it could not be read.
+  void LoadFile(const string &path, function<void(vector<char> &)> onLoaded);
+
+  // Runs the callbacks of finished assets. Callbacks may queue more loads.
+  // Returns true once everything queued so far is loaded and handled.
+  bool Update();
+  // Blocks until Update() would return true.
+  void Finish();
+
+  // Finished assets over queued assets, for a progress bar.
+  double GetProgress() const;
+
+  // One line per asset: queued/decode/upload times since the loader started
+  // and which worker decoded it.
+  void PrintTimeline() const;
+
+private:
+  struct Job
+  {
+    string path;
+    bool isImage;
+    function<void(SDL_Surface *)> onImageLoaded;
+    function<void(vector<char> &)> onFileLoaded;
+    SDL_Surface *surface = NULL;
+    vector<char> data;
+    string error; // SDL errors are per thread, so keep the worker's
+    int worker = -1;
+    double queuedMs = 0, startMs = 0, loadedMs = 0, handledMs = 0;
+  };
+
+  void Queue(Job *job);
+  void WorkerLoop(int worker);
+  double NowMs() const;
+
+  chrono::steady_clock::time_point epoch;
+  vector<thread> workers;
+  // Every job ever queued, in order, for the timeline; owned here.
+  vector<Job *> jobs;
+  int handledCount = 0;
+
+  mutable mutex lock;
+  condition_variable workAvailable;
+  condition_variable workFinished;
+  deque<Job *> pending;
+  deque<Job *> finished;
+  bool stopping = false;
+};
@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <SDL.h>
+#include "mapped_file.h"
+#include "asset_pack.h"
+
+using namespace std;
+
+AssetPack *AssetPack::Open(const string &path)
+{
+  unique_ptr<MappedFile> file = make_unique<MappedFile>();
+  if (!file->Open(path))
+  {
+    return NULL;
+  }
+
+  AssetPackHeader header;
+  if (file->GetSize() < sizeof(header))
+  {
+    printf("%s is too small to be an asset pack\n", path.c_str());
+    return NULL;
+  }
+  memcpy(&header, file->GetData(), sizeof(header));
+  if (memcmp(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic)) != 0 || header.version != ASSET_PACK_VERSION)
+  {
+    printf("%s is not a version %u asset pack\n", path.c_str(), ASSET_PACK_VERSION);
+    return NULL;
+  }
+  if (header.indexOffset % alignof(AssetPackEntry) != 0 ||
+      header.indexOffset > file->GetSize() ||
+      (file->GetSize() - header.indexOffset) / sizeof(AssetPackEntry) < header.entryCount)
+  {
+    printf("%s has a damaged index\n", path.c_str());
+    return NULL;
+  }
+
+  const AssetPackEntry *index = (const AssetPackEntry *)(file->GetData() + header.indexOffset);
+  for (uint32_t i = 0; i < header.entryCount; i++)
+  {
+    const AssetPackEntry &entry = index[i];
+    if (entry.offset > file->GetSize() || file->GetSize() - entry.offset < entry.size ||
+        entry.name[ASSET_PACK_NAME_LENGTH - 1] != '\0' ||
+        (entry.kind == ASSET_PACK_IMAGE && (uint64_t)entry.pitch * entry.height > entry.size))
+    {
+      printf("%s has a damaged entry %u\n", path.c_str(), i);
+      return NULL;
+    }
+  }
+
+  AssetPack *pack = new AssetPack();
+  pack->index = index;
+  pack->entryCount = header.entryCount;
+  pack->file = move(file);
+  return pack;
+}
+
+const AssetPackEntry *AssetPack::Find(const string &name) const
+{
+  // A handful of entries, looked up once each at startup.
+  for (uint32_t i = 0; i < entryCount; i++)
+  {
+    if (name == index[i].name)
+    {
+      return &index[i];
+    }
+  }
+  return NULL;
+}
+
+const unsigned char *AssetPack::GetData(const AssetPackEntry *entry) const
+{
+  return file->GetData() + entry->offset;
+}
+
+SDL_Texture *AssetPack::CreateTexture(SDL_Renderer *renderer, const AssetPackEntry *entry) const
+{
+  if (entry->kind != ASSET_PACK_IMAGE)
+  {
+    return NULL;
+  }
+  SDL_Texture *texture = SDL_CreateTexture(renderer, entry->format, SDL_TEXTUREACCESS_STATIC, entry->width, entry->height);
+  if (texture == NULL)
+  {
+    printf("Unable to create texture for %s! SDL Error: %s\n", entry->name, SDL_GetError());
+    return NULL;
+  }
+  SDL_UpdateTexture(texture, NULL, GetData(entry), entry->pitch);
+  return texture;
+}
+
+SDL_RWops *AssetPack::OpenStream(const AssetPackEntry *entry) const
+{
+  return SDL_RWFromConstMem(GetData(entry), (int)entry->size);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <SDL.h>
+#include "mapped_file.h"
+
+using namespace std;
+
+// Asset pack (.tbp), little-endian, written by tools/pack_assets.cpp:
+//   AssetPackHeader
+//   entry data, each starting on an ASSET_PACK_ALIGN boundary
+//   AssetPackEntry index[entryCount] at indexOffset
+//
+// Images are stored already decoded, row by row in `format`, so a texture
+// is created straight from the mapped bytes. Everything else is stored as
+// the original file.
+const char ASSET_PACK_MAGIC[4] = {'T', 'B', 'R', 'P'};
+const uint32_t ASSET_PACK_VERSION = 1;
+const int ASSET_PACK_ALIGN = 64;
+const int ASSET_PACK_NAME_LENGTH = 48;
+
+struct AssetPackHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t reserved;
+  uint64_t indexOffset;
+};
+
+enum AssetPackKind : uint32_t
+{
+  ASSET_PACK_RAW = 0,
+  ASSET_PACK_IMAGE = 1,
+};
+
+struct AssetPackEntry
+{
+  char name[ASSET_PACK_NAME_LENGTH]; // file name inside assets/, NUL padded
+  uint32_t kind;
+  uint32_t format; // SDL_PixelFormatEnum, images only
+  uint32_t width, height, pitch;
+  uint32_t reserved;
+  uint64_t offset, size;
+};
+
+// A memory-mapped asset pack. Entries are looked up by name and handed out
+// as pointers into the mapped index, which stay valid while the pack is
+// open.
+class AssetPack
+{
+public:
+  // NULL if the file is missing, damaged or from another version.
+  static AssetPack *Open(const string &path);
+
+  const AssetPackEntry *Find(const string &name) const;
+  const unsigned char *GetData(const AssetPackEntry *entry) const;
+
+  // A static texture filled from the mapped pixels; NULL on failure.
+  SDL_Texture *CreateTexture(SDL_Renderer *renderer, const AssetPackEntry *entry) const;
+  // A read-only stream over the entry, e.g. for Mix_LoadMUS_RW. The pack
+  // must stay open for as long as the stream is used.
+  SDL_RWops *OpenStream(const AssetPackEntry *entry) const;
+
+private:
+  unique_ptr<MappedFile> file;
+  const AssetPackEntry *index;
+  uint32_t entryCount;
+};
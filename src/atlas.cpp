@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <SDL.h>
+#include <SDL_image.h>
+#include "asset_loader.h"
+#include "asset_pack.h"
+#include "profiler.h"
+#include "atlas.h"
+
+using namespace std;
+
+void SetSheetColor(SpriteSheet *sheet, Uint8 r, Uint8 g, Uint8 b)
+{
+  if (sheet->color.r != r || sheet->color.g != g || sheet->color.b != b)
+  {
+    g_profiler.Count(ProfileCounter::ColorModChanges);
+  }
+  sheet->color = {r : r, g : g, b : b, a : 255};
+}
+
+Atlas::Atlas(SDL_Renderer *renderer, const string &assetsDir, AssetLoader *loader, const AssetPack *pack)
+    : renderer(renderer), pages(ATLAS_PAGE_COUNT, NULL)
+{
+  for (const AtlasEntry &entry : ATLAS_ENTRIES)
+  {
+    sheets[entry.file] = {
+      texture : NULL,
+      origin : {x : entry.rect.x, y : entry.rect.y},
+      color : {r : 255, g : 255, b : 255, a : 255}};
+  }
+
+  for (int page = 0; page < ATLAS_PAGE_COUNT; page++)
+  {
+    string pageFile = "atlas" + to_string(page) + ".png";
+    const AssetPackEntry *packed = pack != NULL ? pack->Find(pageFile) : NULL;
+    if (packed != NULL && packed->width == ATLAS_PAGE_W && packed->height == ATLAS_PAGE_H)
+    {
+      SDL_Texture *texture = pack->CreateTexture(renderer, packed);
+      if (texture != NULL)
+      {
+        SetPage(page, texture);
+        continue;
+      }
+    }
+    else if (packed != NULL)
+    {
+      printf("%s in the asset pack does not match the atlas layout! Rerun tools/pack_assets.\n", pageFile.c_str());
+    }
+
+    string pagePath = assetsDir + "/" + pageFile;
+    loader->LoadImage(pagePath, [this, page, pagePath, assetsDir, loader](SDL_Surface *surface)
+                      {
+      if (surface == NULL)
+      {
+        printf("No packed atlas at %s, composing it from the source sheets\n", pagePath.c_str());
+        ComposePage(page, assetsDir, loader);
+        return;
+      }
+      UploadPage(page, surface); });
+  }
+}
+
+Atlas::~Atlas()
+{
+  for (SDL_Texture *page : pages)
+  {
+    if (page != NULL)
+    {
+      SDL_DestroyTexture(page);
+    }
+  }
+}
+
+SpriteSheet *Atlas::GetSheet(const string &file)
+{
+  auto it = sheets.find(file);
+  if (it == sheets.end())
+  {
+    printf("Sheet %s is not in the atlas! Rerun tools/pack_atlas.\n", file.c_str());
+    return NULL;
+  }
+  return &it->second;
+}
+
+void Atlas::ComposePage(int page, const string &assetsDir, AssetLoader *loader)
+{
+  SDL_Surface *pageSurface = SDL_CreateRGBSurfaceWithFormat(0, ATLAS_PAGE_W, ATLAS_PAGE_H, 32, SDL_PIXELFORMAT_RGBA32);
+  auto sheetsLeft = make_shared<int>(count_if(begin(ATLAS_ENTRIES), end(ATLAS_ENTRIES), [page](const AtlasEntry &entry)
+                                              { return entry.page == page; }));
+  if (*sheetsLeft == 0)
+  {
+    UploadPage(page, pageSurface);
+    return;
+  }
+
+  // Sheets decode in parallel; each is blitted in as it arrives and the page
+  // is uploaded with the last one.
+  for (const AtlasEntry &entry : ATLAS_ENTRIES)
+  {
+    if (entry.page != page)
+    {
+      continue;
+    }
+
+    loader->LoadImage(assetsDir + "/" + entry.file, [this, page, pageSurface, sheetsLeft, &entry](SDL_Surface *sheet)
+                      {
+      if (sheet != NULL)
+      {
+        if (sheet->w != entry.rect.w || sheet->h != entry.rect.h)
+        {
+          printf("%s is %dx%d but the atlas layout expects %dx%d! Rerun tools/pack_atlas.\n",
+                 entry.file, sheet->w, sheet->h, entry.rect.w, entry.rect.h);
+        }
+
+        SDL_Rect srcRect = {x : 0, y : 0, w : min(sheet->w, entry.rect.w), h : min(sheet->h, entry.rect.h)};
+        SDL_Rect dstRect = entry.rect;
+        SDL_SetSurfaceBlendMode(sheet, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(sheet, &srcRect, pageSurface, &dstRect);
+        SDL_FreeSurface(sheet);
+      }
+      if (--*sheetsLeft == 0)
+      {
+        UploadPage(page, pageSurface);
+      } });
+  }
+}
+
+void Atlas::UploadPage(int page, SDL_Surface *surface)
+{
+  SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
+  SDL_FreeSurface(surface);
+  if (texture == NULL)
+  {
+    printf("Unable to create atlas page %d! SDL Error: %s\n", page, SDL_GetError());
+    return;
+  }
+  SetPage(page, texture);
+}
+
+void Atlas::SetPage(int page, SDL_Texture *texture)
+{
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+  pages[page] = texture;
+
+  for (const AtlasEntry &entry : ATLAS_ENTRIES)
+  {
+    if (entry.page == page)
+    {
+      sheets[entry.file].texture = texture;
+    }
+  }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <SDL.h>
+#include "asset_loader.h"
+#include "asset_pack.h"
+
+using namespace std;
+
+struct AtlasEntry
+{
+  const char *file;
+  int page;
+  SDL_Rect rect;
+};
+
+#include "atlas_layout.h"
+
+// A source sheet as it lives inside an atlas page. Source rects stay in the
+// sheet's own coordinates; SpriteBatch offsets them by origin when drawing.
+struct SpriteSheet
+{
+  SDL_Texture *texture;
+  SDL_Point origin;
+  SDL_Color color;
+};
+
+void SetSheetColor(SpriteSheet *sheet, Uint8 r, Uint8 g, Uint8 b);
+
+// Owns the atlas page textures described by atlas_layout.h. Pages written by
+// tools/pack_atlas.cpp are loaded directly; if one is missing it is composed
+// from the individual sheets instead, so a fresh checkout still runs.
+//
+// Pages found in the asset pack (may be NULL) are created from its mapped
+// pixels on the spot; the rest load through an AssetLoader. Sheets can be
+// handed out right away, but their textures stay NULL until the loader has
+// finished.
+class Atlas
+{
+public:
+  Atlas(SDL_Renderer *renderer, const string &assetsDir, AssetLoader *loader, const AssetPack *pack);
+  ~Atlas();
+
+  SpriteSheet *GetSheet(const string &file);
+
+private:
+  void ComposePage(int page, const string &assetsDir, AssetLoader *loader);
+  void UploadPage(int page, SDL_Surface *surface);
+  void SetPage(int page, SDL_Texture *texture);
+
+  SDL_Renderer *renderer;
+  vector<SDL_Texture *> pages;
+  unordered_map<string, SpriteSheet> sheets;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+// Generated by tools/pack_atlas.cpp from assets/*.png. Do not edit by hand;
+// rerun the packer whenever a sheet is added or resized.
+
+const int ATLAS_PAGE_W = 512, ATLAS_PAGE_H = 512;
+const int ATLAS_PAGE_COUNT = 1;
+
+const AtlasEntry ATLAS_ENTRIES[] = {
+    {file : "characters.png", page : 0, rect : {x : 0, y : 0, w : 192, h : 128}},
+    {file : "worldmap.png", page : 0, rect : {x : 193, y : 0, w : 128, h : 128}},
+    {file : "enemies.png", page : 0, rect : {x : 322, y : 0, w : 48, h : 80}},
+    {file : "gui.png", page : 0, rect : {x : 371, y : 0, w : 88, h : 64}},
+    {file : "battle.png", page : 0, rect : {x : 0, y : 129, w : 80, h : 64}},
+    {file : "font.png", page : 0, rect : {x : 81, y : 129, w : 80, h : 56}},
+    {file : "battleBGs.png", page : 0, rect : {x : 162, y : 129, w : 138, h : 26}},
+};
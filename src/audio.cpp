@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include <SDL_mixer.h>
+#include "asset_loader.h"
+#include "asset_pack.h"
+#include "audio.h"
+
+using namespace std;
+
+const char *MUSIC_FILES[] = {"wizardquest1.ogg", "wizardquest1.wav"};
+const char *SFX_FILES[(int)Sfx::Count] = {"sfx_attack.wav", "sfx_magic.wav", "sfx_menu.wav"};
+// A callback this much later than expected counts as late.
+const double LATE_CALLBACK_FACTOR = 1.5;
+
+Audio *Audio::Open(int bufferSamples, size_t sfxBudgetBytes)
+{
+  Mix_Init(MIX_INIT_OGG);
+  if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, bufferSamples) < 0)
+  {
+    printf("SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError());
+    return NULL;
+  }
+  return new Audio(bufferSamples, sfxBudgetBytes);
+}
+
+Audio::Audio(int bufferSamples, size_t sfxBudgetBytes) : sfxBudgetBytes(sfxBudgetBytes)
+{
+  int frequency = 44100, channels;
+  Uint16 format;
+  Mix_QuerySpec(&frequency, &format, &channels);
+  expectedCallbackIntervalMs = 1000.0 * bufferSamples / frequency;
+  Mix_AllocateChannels(SFX_VOICES);
+  Mix_SetPostMix(PostMix, this);
+}
+
+Audio::~Audio()
+{
+  Mix_SetPostMix(NULL, NULL);
+  Mix_HaltChannel(-1);
+  Mix_FreeMusic(music);
+  for (Mix_Chunk *chunk : sfxChunks)
+  {
+    Mix_FreeChunk(chunk);
+  }
+  Mix_CloseAudio();
+}
+
+void Audio::PlayMusic(const string &assetsDir, const AssetPack *pack)
+{
+  for (const char *file : MUSIC_FILES)
+  {
+    const AssetPackEntry *entry = pack != NULL ? pack->Find(file) : NULL;
+    if (entry != NULL)
+    {
+      music = Mix_LoadMUS_RW(pack->OpenStream(entry), 1);
+      musicBytes = entry->size;
+      musicInMemory = true;
+    }
+    else if (filesystem::exists(assetsDir + "/" + file))
+    {
+      music = Mix_LoadMUS((assetsDir + "/" + file).c_str());
+      musicBytes = filesystem::file_size(assetsDir + "/" + file);
+      musicInMemory = false;
+    }
+    if (music != NULL)
+    {
+      Mix_PlayMusic(music, -1);
+      return;
+    }
+  }
+  printf("No music found in %s\n", assetsDir.c_str());
+}
+
+void Audio::LoadSoundEffects(const string &assetsDir, const AssetPack *pack, AssetLoader *loader)
+{
+  for (int sfx = 0; sfx < (int)Sfx::Count; sfx++)
+  {
+    const char *file = SFX_FILES[sfx];
+    const AssetPackEntry *entry = pack != NULL ? pack->Find(file) : NULL;
+    if (entry != NULL)
+    {
+      AddSoundEffect((Sfx)sfx, Mix_LoadWAV_RW(pack->OpenStream(entry), 1), file);
+    }
+    else if (filesystem::exists(assetsDir + "/" + file))
+    {
+      loader->LoadFile(assetsDir + "/" + file, [this, sfx, file](vector<char> &data)
+                       { AddSoundEffect((Sfx)sfx, Mix_LoadWAV_RW(SDL_RWFromConstMem(data.data(), data.size()), 1), file); });
+    }
+  }
+}
+
+void Audio::AddSoundEffect(Sfx sfx, Mix_Chunk *chunk, const char *file)
+{
+  if (chunk == NULL)
+  {
+    printf("Unable to decode %s! SDL_mixer Error: %s\n", file, Mix_GetError());
+    return;
+  }
+  if (sfxBytes + chunk->alen > sfxBudgetBytes)
+  {
+    printf("%s would take sound effects past their %zu KB budget, leaving it out\n", file, sfxBudgetBytes / 1024);
+    Mix_FreeChunk(chunk);
+    return;
+  }
+  sfxBytes += chunk->alen;
+  sfxChunks[(int)sfx] = chunk;
+}
+
+void Audio::Play(Sfx sfx)
+{
+  Mix_Chunk *chunk = sfxChunks[(int)sfx];
+  if (chunk == NULL)
+  {
+    return;
+  }
+  if (Mix_PlayChannel(-1, chunk, 0) < 0)
+  {
+    Mix_PlayChannel(Mix_GroupOldest(-1), chunk, 0);
+    voicesStolen++;
+  }
+}
+
+void Audio::PostMix(void *userData, Uint8 *stream, int length)
+{
+  Audio *audio = (Audio *)userData;
+  uint64_t now = SDL_GetPerformanceCounter();
+  uint64_t last = audio->lastCallbackTicks.exchange(now);
+  if (last == 0)
+  {
+    return;
+  }
+
+  uint64_t interval = now - last;
+  audio->callbacks++;
+  audio->callbackIntervalTicksSum += interval;
+  if (interval > audio->worstCallbackIntervalTicks)
+  {
+    audio->worstCallbackIntervalTicks = interval;
+  }
+  if (interval * 1000.0 / SDL_GetPerformanceFrequency() > audio->expectedCallbackIntervalMs * LATE_CALLBACK_FACTOR)
+  {
+    audio->lateCallbacks++;
+  }
+}
+
+AudioStats Audio::GetStats()
+{
+  double msPerTick = 1000.0 / SDL_GetPerformanceFrequency();
+  int callbackCount = callbacks.exchange(0);
+  uint64_t ticksSum = callbackIntervalTicksSum.exchange(0);
+  AudioStats stats = {
+    sfxBytes : sfxBytes,
+    musicBytes : musicBytes,
+    musicInMemory : musicInMemory,
+    voicesPlaying : Mix_Playing(-1),
+    voicesStolen : voicesStolen,
+    callbacks : callbackCount,
+    expectedCallbackIntervalMs : expectedCallbackIntervalMs,
+    averageCallbackIntervalMs : callbackCount > 0 ? ticksSum * msPerTick / callbackCount : 0,
+    worstCallbackIntervalMs : worstCallbackIntervalTicks.exchange(0) * msPerTick,
+    lateCallbacks : lateCallbacks.exchange(0)};
+  voicesStolen = 0;
+  return stats;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <SDL.h>
+#include <SDL_mixer.h>
+#include "asset_loader.h"
+#include "asset_pack.h"
+
+using namespace std;
+
+enum class Sfx
+{
+  Attack,
+  Magic,
+  MenuMove,
+  Count
+};
+
+const int SFX_VOICES = 8;
+const int DEFAULT_AUDIO_BUFFER_SAMPLES = 1024;
+const size_t DEFAULT_SFX_BUDGET_BYTES = 4 * 1024 * 1024;
+
+struct AudioStats
+{
+  size_t sfxBytes;    // decoded sound effects, all resident
+  size_t musicBytes;  // size of the music file being streamed
+  bool musicInMemory; // streamed from the mapped pack rather than a file
+  int voicesPlaying;
+  int voicesStolen;   // since the last GetStats()
+  // Mixer callbacks since the last GetStats(), and the time between one
+  // callback and the next (not the time spent in them). A callback
+  // arriving much later than one buffer's worth of audio means the device
+  // came close to (or did) underrun.
+  int callbacks;
+  double expectedCallbackIntervalMs;
+  double averageCallbackIntervalMs;
+  double worstCallbackIntervalMs;
+  int lateCallbacks;
+};
+
+// Owns the mixer. Music streams from disk (or the mapped pack) in
+// buffer-sized pieces, so a compressed track never sits decoded in memory.
+// Sound effects are decoded up front into a fixed pool, capped by a byte
+// budget, and play on SFX_VOICES channels; when all are busy the oldest
+// voice is cut off for the new sound.
+class Audio
+{
+public:
+  // Opens the audio device; NULL if that fails. bufferSamples trades
+  // latency for headroom against underruns.
+  static Audio *Open(int bufferSamples, size_t sfxBudgetBytes);
+  ~Audio();
+
+  // Prefers an .ogg over a .wav, and the pack over the assets folder.
+  void PlayMusic(const string &assetsDir, const AssetPack *pack);
+  // Effects missing from the pack are read on the loader's workers and
+  // decoded as they arrive. Missing files just stay silent.
+  void LoadSoundEffects(const string &assetsDir, const AssetPack *pack, AssetLoader *loader);
+
+  void Play(Sfx sfx);
+
+  AudioStats GetStats();
+
+private:
+  Audio(int bufferSamples, size_t sfxBudgetBytes);
+  void AddSoundEffect(Sfx sfx, Mix_Chunk *chunk, const char *file);
+  static void PostMix(void *userData, Uint8 *stream, int length);
+
+  size_t sfxBudgetBytes;
+  size_t sfxBytes = 0;
+  Mix_Chunk *sfxChunks[(int)Sfx::Count] = {};
+  Mix_Music *music = NULL;
+  size_t musicBytes = 0;
+  bool musicInMemory = false;
+  int voicesStolen = 0;
+  double expectedCallbackIntervalMs;
+
+  // Written on the audio thread, read and reset by GetStats().
+  atomic<uint64_t> lastCallbackTicks{0};
+  atomic<int> callbacks{0};
+  atomic<uint64_t> callbackIntervalTicksSum{0};
+  atomic<uint64_t> worstCallbackIntervalTicks{0};
+  atomic<int> lateCallbacks{0};
+};
@@ -0,0 +1,58 @@
+#include "rng.h"
+#include "battle.h"
+
+using namespace std;
+
+const BattleActionRule BATTLE_ACTION_RULES[BATTLE_ACTION_COUNT] = {
+    {minAmount : 1, maxAmount : 3}, // Attack
+    {minAmount : 1, maxAmount : 5}, // Magic
+    {minAmount : 1, maxAmount : 4}, // Item
+    {minAmount : 0, maxAmount : 0}, // Run
+};
+
+void StartBattle(BattleState *state, const int *enemyHp, int enemyCount)
+{
+  state->enemyCount = enemyCount;
+  for (int i = 0; i < enemyCount; i++)
+  {
+    state->enemyHp[i] = enemyHp[i];
+    state->enemyMaxHp[i] = enemyHp[i];
+  }
+  state->turns = 0;
+}
+
+bool IsBattleWon(const BattleState *state)
+{
+  return FirstLivingEnemy(state) < 0;
+}
+
+int FirstLivingEnemy(const BattleState *state)
+{
+  for (int i = 0; i < state->enemyCount; i++)
+  {
+    if (state->enemyHp[i] > 0)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+BattleResult PerformAction(BattleState *state, BattleAction action, int target, Rng *rng)
+{
+  const BattleActionRule &rule = BATTLE_ACTION_RULES[static_cast<int>(action)];
+  BattleResult result = {action : action, target : target, amount : 0};
+  if (rule.maxAmount > 0)
+  {
+    result.amount = rng->Range(rule.minAmount, rule.maxAmount);
+  }
+
+  if (action == BattleAction::Attack || action == BattleAction::Magic)
+  {
+    state->enemyHp[target] -= result.amount;
+  }
+  // The player has no health yet, so an Item's healing only shows in the text.
+
+  state->turns++;
+  return result;
+}
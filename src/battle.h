@@ -0,0 +1,53 @@
+#pragma once
+
+#include "rng.h"
+
+using namespace std;
+
+enum class BattleAction
+{
+  Attack = 0,
+  Magic = 1,
+  Item = 2,
+  Run = 3
+};
+
+const int BATTLE_ACTION_COUNT = 4;
+const int MAX_BATTLE_ENEMIES = 8;
+
+// How much an action does: damage to the target for Attack/Magic, healing
+// for Item, nothing for Run. Rolled uniformly in [minAmount, maxAmount].
+struct BattleActionRule
+{
+  int minAmount, maxAmount;
+};
+
+extern const BattleActionRule BATTLE_ACTION_RULES[BATTLE_ACTION_COUNT];
+
+// Everything a battle needs and nothing the renderer does. Enemies are kept
+// as parallel arrays indexed by slot, so the simulator's hot checks (is
+// anyone left, who to target) are short scans over a few ints.
+struct BattleState
+{
+  int enemyCount;
+  int enemyHp[MAX_BATTLE_ENEMIES];
+  int enemyMaxHp[MAX_BATTLE_ENEMIES];
+  int turns;
+};
+
+struct BattleResult
+{
+  BattleAction action;
+  int target;
+  int amount;
+};
+
+void StartBattle(BattleState *state, const int *enemyHp, int enemyCount);
+bool IsBattleWon(const BattleState *state);
+// Index of the first living enemy, or -1 if there is none.
+int FirstLivingEnemy(const BattleState *state);
+
+// Rolls and applies one player action and counts it as a turn. target is
+// only used by Attack and Magic and may be an enemy that is already down,
+// just like in the menu.
+BattleResult PerformAction(BattleState *state, BattleAction action, int target, Rng *rng);
@@ -0,0 +1,95 @@
+#include <SDL.h>
+#include "constants.h"
+#include "atlas.h"
+#include "sprite_batch.h"
+#include "content.h"
+#include "gui.h"
+#include "battle_ui.h"
+
+using namespace std;
+
+BattleUi::BattleUi(SpriteBatch *batch, Atlas *atlas, const BattleLayout *layout, const SDL_Rect &background)
+    : batch(batch), layout(layout), background(background)
+{
+  gui = atlas->GetSheet("gui.png");
+  battle = atlas->GetSheet("battle.png");
+  battleBGs = atlas->GetSheet("battleBGs.png");
+  // Made up front, so drawing never needs the renderer.
+  SDL_Renderer *renderer = batch->GetRenderer();
+  useRenderTargets = SDL_RenderTargetSupported(renderer);
+  if (useRenderTargets)
+  {
+    staticLayer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, GAME_W, GAME_H);
+    if (staticLayer == NULL)
+    {
+      printf("Unable to create battle UI texture! SDL Error: %s\n", SDL_GetError());
+      useRenderTargets = false;
+    }
+    else
+    {
+      SDL_SetTextureBlendMode(staticLayer, SDL_BLENDMODE_BLEND);
+    }
+  }
+}
+
+BattleUi::~BattleUi()
+{
+  if (staticLayer != NULL)
+  {
+    SDL_DestroyTexture(staticLayer);
+  }
+}
+
+void BattleUi::SetBackground(const SDL_Rect *backgroundRect)
+{
+  if (!SDL_RectEquals(&background, backgroundRect))
+  {
+    background = *backgroundRect;
+    dirty = true;
+  }
+}
+
+void BattleUi::InvalidateAll()
+{
+  dirty = true;
+}
+
+void BattleUi::DrawStatic()
+{
+  if (!useRenderTargets)
+  {
+    DrawStaticDirect();
+    return;
+  }
+
+  if (dirty)
+  {
+    batch->BeginTarget(staticLayer);
+    DrawStaticDirect();
+    batch->EndTarget();
+    dirty = false;
+  }
+
+  SDL_Rect dstRect = {x : 0, y : 0, w : GAME_W, h : GAME_H};
+  batch->Draw(staticLayer, NULL, &dstRect);
+}
+
+void BattleUi::DrawStaticDirect()
+{
+  SDL_Rect guiRect;
+  guiRect = {x : 0, y : 0, w : GAME_W, h : GAME_H};
+  DrawGuiBox(batch, gui, &guiRect);
+  guiRect = {x : 0, y : 104, w : GAME_W, h : GUI_BORDER_H};
+  DrawGuiLineH(batch, gui, &guiRect, &junctionR, &junctionL);
+  guiRect = {x : 143, y : 0, w : GUI_BORDER_W, h : 109};
+  DrawGuiLineV(batch, gui, &guiRect, &junctionB, &junctionT);
+  guiRect = {x : 167, y : 104, w : GUI_BORDER_W, h : 76};
+  DrawGuiLineV(batch, gui, &guiRect, &junctionB, &junctionT);
+
+  for (int action = 0; action < BATTLE_ACTION_COUNT; action++)
+  {
+    batch->Draw(battle, &layout->actionLabels[action], &layout->actionLabelPositions[action]);
+  }
+
+  batch->Draw(battleBGs, &background, &layout->backgroundPosition);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <SDL.h>
+#include "constants.h"
+#include "atlas.h"
+#include "sprite_batch.h"
+#include "content.h"
+
+using namespace std;
+
+// The parts of the battle screen that only change when the battle itself
+// does: the frame, its dividers, the menu labels and the background. They are
+// composed into one render-target texture and rebaked only when marked dirty,
+// so a battle frame draws them with a single blit. Everything that moves
+// (cursor, text, enemies, highlight) is still drawn on top every frame.
+class BattleUi
+{
+public:
+  BattleUi(SpriteBatch *batch, Atlas *atlas, const BattleLayout *layout, const SDL_Rect &background);
+  ~BattleUi();
+
+  // Marks the static layer dirty only if the background actually changes.
+  void SetBackground(const SDL_Rect *backgroundRect);
+
+  void DrawStatic();
+
+  // The static layer is rebaked on next use. Needed after
+  // SDL_RENDER_TARGETS_RESET, when the renderer drops target contents.
+  void InvalidateAll();
+
+private:
+  void DrawStaticDirect();
+
+  SpriteBatch *batch;
+  const BattleLayout *layout;
+  SpriteSheet *gui;
+  SpriteSheet *battle;
+  SpriteSheet *battleBGs;
+  bool useRenderTargets;
+  SDL_Texture *staticLayer = NULL;
+  bool dirty = true;
+  SDL_Rect background;
+};
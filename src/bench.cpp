@@ -0,0 +1,431 @@
+// Headless benchmark: runs the game on SDL's dummy video driver with the
+// software renderer, drives scripted input through the map and battle
+// screens and prints per-scene frame statistics as JSON.
+//
+// Usage: bench [--frames N] [--out results.json] [--replay session.tbi] [--check-allocations]
+//
+// --check-allocations fails the run if any map or battle frame after the
+// first ALLOCATION_WARMUP_FRAMES allocates on the heap, and prints the size
+// of each allocation it catches (break in ReportSteadyAllocation for the call
+// stack). Background threads, like world generation, are not counted.
+//
+// --replay adds a scene that plays a recorded session tick for tick, on a
+// fresh game built from the recording's seed.
+//
+// The "long_paths" scene is not frames but LONG_PATH_QUERIES routes between
+// far-apart tiles of a fully generated world, each timed on its own.
+
+#include "./constants.h"
+#include "./asset_loader.cpp"
+#include "./alloc_counter.cpp"
+#include "./profiler.cpp"
+#include "./atlas.cpp"
+#include "./draw_list.cpp"
+#include "./sprite_batch.cpp"
+#include "./screen.cpp"
+#include "./text_renderer.cpp"
+#include "./mapped_file.cpp"
+#include "./asset_pack.cpp"
+#include "./terrain.cpp"
+#include "./save_state.cpp"
+#include "./world.cpp"
+#include "./entities.cpp"
+#include "./pathfinder.cpp"
+#include "./tile_map_renderer.cpp"
+#include "./battle_ui.cpp"
+#include "./gui.cpp"
+#include "./rng.cpp"
+#include "./battle.cpp"
+#include "./content.cpp"
+#include "./animator.cpp"
+#include "./audio.cpp"
+#include "./game.cpp"
+#include "./input_log.cpp"
+#include "./paths.cpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include <SDL_image.h>
+
+using namespace std;
+
+const int CROWD_WORLD_SIZE = 1024;
+const int CROWD_ENTITIES = 50000;
+// Long enough for the map script's walk to come round once and for every
+// battle message to have been shown.
+const int ALLOCATION_WARMUP_FRAMES = 600;
+const int MAX_REPORTED_ALLOCATIONS = 20;
+const int LONG_PATH_QUERIES = 1000;
+// Ends are at least this many tiles apart, across and down together.
+const int LONG_PATH_MIN_TILES = WORLD_W / 2;
+
+struct SceneResult
+{
+  string name;
+  int frames;
+  double p50Ms, p95Ms, p99Ms, maxMs;
+  double spritesPerFrame;
+  double drawCallsPerFrame;
+  double allocationsPerFrame;
+  int steadyAllocatingFrames; // frames past the warm-up that allocated on the bench thread
+};
+
+// One step of a scripted input sequence: which keys to hold and which to
+// press for a tick, and optionally where to click.
+typedef function<void(int tick, Uint8 *held, Uint8 *pressed, const SDL_Point **click)> InputScript;
+
+void MapScript(int tick, Uint8 *held, Uint8 *pressed, const SDL_Point **click)
+{
+  // The game starts in battle, so switch to the map first, then walk a
+  // few tiles in each direction in turn.
+  if (tick == 0)
+  {
+    pressed[SDL_SCANCODE_B] = 1;
+  }
+  const SDL_Scancode directions[] = {SDL_SCANCODE_LEFT, SDL_SCANCODE_UP, SDL_SCANCODE_RIGHT, SDL_SCANCODE_DOWN};
+  held[directions[tick / (WALK_TICKS * 4) % 4]] = 1;
+}
+
+void BattleScript(int tick, Uint8 *held, Uint8 *pressed, const SDL_Point **click)
+{
+  // Back to battle, then every few ticks move the cursor or confirm, which
+  // cycles through the actions, the target list and the result text.
+  if (tick == 0)
+  {
+    pressed[SDL_SCANCODE_B] = 1;
+    return;
+  }
+  const SDL_Scancode steps[] = {SDL_SCANCODE_DOWN, SDL_SCANCODE_Z, SDL_SCANCODE_DOWN, SDL_SCANCODE_Z, SDL_SCANCODE_Z,
+                                SDL_SCANCODE_UP, SDL_SCANCODE_Z, SDL_SCANCODE_Z};
+  if (tick % 10 == 0)
+  {
+    pressed[steps[tick / 10 % SDL_arraysize(steps)]] = 1;
+  }
+}
+
+double Percentile(const vector<double> &sorted, double percentile)
+{
+  if (sorted.empty())
+  {
+    return 0;
+  }
+  size_t index = min(sorted.size() - 1, (size_t)(percentile / 100.0 * sorted.size()));
+  return sorted[index];
+}
+
+int g_reportedAllocations = 0;
+
+void ReportSteadyAllocation(size_t size)
+{
+  if (g_reportedAllocations++ < MAX_REPORTED_ALLOCATIONS)
+  {
+    printf("Steady-state frame allocated %zu bytes\n", size);
+  }
+}
+
+SceneResult RunScene(const string &name, InputScript script, int frames, Game *game, SpriteBatch *batch, Screen *screen,
+                     bool checkAllocations = false)
+{
+  Uint8 held[SDL_NUM_SCANCODES], pressed[SDL_NUM_SCANCODES];
+  vector<double> frameMs;
+  frameMs.reserve(frames);
+  long long sprites = 0, drawCalls = 0;
+  unsigned long long allocationsBefore = GetAllocationCount();
+  int steadyAllocatingFrames = 0;
+
+  for (int frame = 0; frame < frames; frame++)
+  {
+    if (checkAllocations && frame == ALLOCATION_WARMUP_FRAMES)
+    {
+      SetThreadAllocationHook(ReportSteadyAllocation);
+    }
+    unsigned long long threadAllocationsBefore = GetThreadAllocationCount();
+    memset(held, 0, sizeof(held));
+    memset(pressed, 0, sizeof(pressed));
+    const SDL_Point *click = NULL;
+    script(frame, held, pressed, &click);
+
+    // One tick per frame keeps the workload identical from run to run.
+    auto start = chrono::steady_clock::now();
+    game->Tick({held : held, pressed : pressed, click : click});
+    // Recorded and played back to back; the game pipelines the two.
+    game->Render(0.5);
+    batch->EndFrame();
+    screen->BeginFrame();
+    batch->Submit();
+    screen->Present();
+    frameMs.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    if (checkAllocations && frame >= ALLOCATION_WARMUP_FRAMES && GetThreadAllocationCount() != threadAllocationsBefore)
+    {
+      steadyAllocatingFrames++;
+    }
+
+    SpriteBatchStats drawStats = batch->GetLastFrameStats();
+    sprites += drawStats.sprites;
+    drawCalls += drawStats.drawCalls;
+  }
+
+  SetThreadAllocationHook(NULL);
+  unsigned long long allocations = GetAllocationCount() - allocationsBefore;
+  sort(frameMs.begin(), frameMs.end());
+  return {
+    name : name,
+    frames : frames,
+    p50Ms : Percentile(frameMs, 50),
+    p95Ms : Percentile(frameMs, 95),
+    p99Ms : Percentile(frameMs, 99),
+    maxMs : frameMs.empty() ? 0 : frameMs.back(),
+    spritesPerFrame : (double)sprites / frames,
+    drawCallsPerFrame : (double)drawCalls / frames,
+    allocationsPerFrame : (double)allocations / frames,
+    steadyAllocatingFrames : steadyAllocatingFrames};
+}
+
+SceneResult RunLongPaths()
+{
+  World *world = World::Generate(WORLD_W, WORLD_H, 1);
+  Pathfinder *pathfinder = new Pathfinder(world);
+  Rng rng(1);
+  auto randomLand = [world, &rng]()
+  {
+    SDL_Point tile;
+    do
+    {
+      tile = {x : rng.Range(0, world->GetWidth() - 1), y : rng.Range(0, world->GetHeight() - 1)};
+    } while (TILE_MOVE_COSTS[world->Get(tile.x, tile.y)] == 0);
+    return tile;
+  };
+
+  vector<double> queryMs;
+  queryMs.reserve(LONG_PATH_QUERIES);
+  Path path;
+  for (int query = 0; query < LONG_PATH_QUERIES; query++)
+  {
+    SDL_Point from = randomLand(), to;
+    do
+    {
+      to = randomLand();
+    } while (abs(to.x - from.x) + abs(to.y - from.y) < LONG_PATH_MIN_TILES);
+    auto start = chrono::steady_clock::now();
+    pathfinder->FindPath(from, to, &path);
+    queryMs.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+  }
+  delete pathfinder;
+  delete world;
+
+  sort(queryMs.begin(), queryMs.end());
+  return {
+    name : "long_paths",
+    frames : LONG_PATH_QUERIES,
+    p50Ms : Percentile(queryMs, 50),
+    p95Ms : Percentile(queryMs, 95),
+    p99Ms : Percentile(queryMs, 99),
+    maxMs : queryMs.back(),
+    spritesPerFrame : 0,
+    drawCallsPerFrame : 0,
+    allocationsPerFrame : 0,
+    steadyAllocatingFrames : 0};
+}
+
+string ResultsJson(const vector<SceneResult> &results, const char *rendererName)
+{
+  string json = format("{{\"renderer\": \"{}\", \"scenes\": [", rendererName);
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const SceneResult &result = results[i];
+    json += format("{}\n  {{\"name\": \"{}\", \"frames\": {}, \"p50_ms\": {:.4f}, \"p95_ms\": {:.4f}, \"p99_ms\": {:.4f}, \"max_ms\": {:.4f}, "
+                   "\"sprites_per_frame\": {:.1f}, \"draw_calls_per_frame\": {:.2f}, \"allocations_per_frame\": {:.2f}, "
+                   "\"steady_allocating_frames\": {}}}",
+                   i > 0 ? "," : "", result.name, result.frames, result.p50Ms, result.p95Ms, result.p99Ms, result.maxMs,
+                   result.spritesPerFrame, result.drawCallsPerFrame, result.allocationsPerFrame, result.steadyAllocatingFrames);
+  }
+  json += "\n]}\n";
+  return json;
+}
+
+int main(int argc, char **argv)
+{
+  int frames = 2000;
+  string outPath, replayPath;
+  bool checkAllocations = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (string(argv[i]) == "--check-allocations")
+    {
+      checkAllocations = true;
+    }
+  }
+  for (int i = 1; i + 1 < argc; i++)
+  {
+    if (string(argv[i]) == "--frames")
+    {
+      frames = max(1, atoi(argv[i + 1]));
+    }
+    else if (string(argv[i]) == "--out")
+    {
+      outPath = argv[i + 1];
+    }
+    else if (string(argv[i]) == "--replay")
+    {
+      replayPath = argv[i + 1];
+    }
+  }
+
+  SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+  SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) < 0)
+  {
+    printf("SDL could not initialize! SDL Error: %s\n", SDL_GetError());
+    return EXIT_FAILURE;
+  }
+  if (IMG_Init(IMG_INIT_PNG) < 1)
+  {
+    printf("SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError());
+    return EXIT_FAILURE;
+  }
+
+  SDL_Window *window = SDL_CreateWindow("TBRPG bench", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_W, SCREEN_H, SDL_WINDOW_HIDDEN);
+  SDL_Renderer *renderer = window != NULL ? SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE) : NULL;
+  if (NULL == window || NULL == renderer)
+  {
+    printf("Unable to create a headless renderer! SDL Error: %s\n", SDL_GetError());
+    return EXIT_FAILURE;
+  }
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+  Screen *screen = new Screen(renderer);
+  SDL_RendererInfo rendererInfo;
+  SDL_GetRendererInfo(renderer, &rendererInfo);
+
+  string project_dir_path = ProjectDirPath();
+  Content *content = Content::Load(project_dir_path + "/assets/content", project_dir_path + "/assets/content.tbc");
+  if (content == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+  SpriteBatch *batch = new SpriteBatch(renderer);
+  AssetPack *pack = AssetPack::Open(project_dir_path + "/assets/assets.tbp");
+  AssetLoader *loader = new AssetLoader();
+  Atlas *atlas = new Atlas(renderer, project_dir_path + "/assets", loader, pack);
+  loader->Finish();
+  delete loader;
+  TextRenderer *textRenderer = new TextRenderer(batch, atlas->GetSheet("font.png"));
+  // Same world and rolls every run
+  World *world = World::GenerateOnDemand(WORLD_W, WORLD_H, 1);
+  TileMapRenderer *tileMapRenderer = new TileMapRenderer(batch, atlas->GetSheet("worldmap.png"), world);
+  EntityTable *entities = EntityTable::Spawn(world, Game::PrepareStartArea(world), DEFAULT_ENTITIES, 1);
+  Pathfinder *pathfinder = new Pathfinder(world);
+  Game *game = new Game(batch, textRenderer, atlas, content, world, tileMapRenderer, entities, pathfinder, 1);
+
+  vector<SceneResult> results;
+  results.push_back(RunScene("map", MapScript, frames, game, batch, screen, checkAllocations));
+  results.push_back(RunScene("battle", BattleScript, frames, game, batch, screen, checkAllocations));
+  if (checkAllocations && frames <= ALLOCATION_WARMUP_FRAMES)
+  {
+    printf("Nothing checked: --frames must be over %d to get past the warm-up\n", ALLOCATION_WARMUP_FRAMES);
+  }
+
+  // The same walk on a large, densely populated map. Only what is near the
+  // player is touched, so this should cost about the same as "map".
+  {
+    World *crowdWorld = World::Generate(CROWD_WORLD_SIZE, CROWD_WORLD_SIZE, 1);
+    TileMapRenderer *crowdMapRenderer = new TileMapRenderer(batch, atlas->GetSheet("worldmap.png"), crowdWorld);
+    EntityTable *crowd = EntityTable::Spawn(crowdWorld, Game::PrepareStartArea(crowdWorld), CROWD_ENTITIES, 1);
+    Pathfinder *crowdPathfinder = new Pathfinder(crowdWorld);
+    Game *crowdGame = new Game(batch, textRenderer, atlas, content, crowdWorld, crowdMapRenderer, crowd, crowdPathfinder, 1);
+    results.push_back(RunScene("crowd", MapScript, frames, crowdGame, batch, screen));
+    delete crowdGame;
+    delete crowdPathfinder;
+    delete crowd;
+    delete crowdMapRenderer;
+    delete crowdWorld;
+  }
+
+  results.push_back(RunLongPaths());
+
+  if (!replayPath.empty())
+  {
+    InputPlayer *player = InputPlayer::Open(replayPath);
+    if (player == NULL || player->GetTickCount() == 0)
+    {
+      printf("Nothing to replay in %s\n", replayPath.c_str());
+      return EXIT_FAILURE;
+    }
+    // The game loads assets/world.tbw when there is one, so do the same to
+    // see the same map.
+    World *replayWorld = World::Open(project_dir_path + "/assets/world.tbw");
+    if (replayWorld == NULL)
+    {
+      replayWorld = World::GenerateOnDemand(WORLD_W, WORLD_H, player->GetSeed());
+    }
+    TileMapRenderer *replayMapRenderer = new TileMapRenderer(batch, atlas->GetSheet("worldmap.png"), replayWorld);
+    EntityTable *replayEntities = EntityTable::Spawn(replayWorld, Game::PrepareStartArea(replayWorld), DEFAULT_ENTITIES,
+                                                            player->GetSeed());
+    Pathfinder *replayPathfinder = new Pathfinder(replayWorld, 0, project_dir_path + "/assets/world.tbg");
+    Game *replayGame = new Game(batch, textRenderer, atlas, content, replayWorld, replayMapRenderer, replayEntities,
+                                replayPathfinder, player->GetSeed());
+    auto replayScript = [player](int tick, Uint8 *held, Uint8 *pressed, const SDL_Point **click)
+    {
+      InputState input;
+      player->NextTick(&input);
+      memcpy(held, input.held, SDL_NUM_SCANCODES);
+      memcpy(pressed, input.pressed, SDL_NUM_SCANCODES);
+      // Stays valid until the next NextTick().
+      *click = input.click;
+    };
+    results.push_back(RunScene("replay", replayScript, player->GetTickCount(), replayGame, batch, screen));
+    if (replayGame->GetStateHash() != player->GetFinalStateHash())
+    {
+      fprintf(stderr, "Replay of %s diverged from the recording\n", replayPath.c_str());
+    }
+    delete replayGame;
+    delete replayPathfinder;
+    delete replayEntities;
+    delete replayMapRenderer;
+    delete replayWorld;
+    delete player;
+  }
+
+  string json = ResultsJson(results, rendererInfo.name);
+  if (outPath.empty())
+  {
+    printf("%s", json.c_str());
+  }
+  else
+  {
+    ofstream(outPath) << json;
+  }
+
+  bool allocated = false;
+  for (const SceneResult &result : results)
+  {
+    if (checkAllocations && result.steadyAllocatingFrames > 0)
+    {
+      fprintf(stderr, "%s: %d frames allocated after the warm-up\n", result.name.c_str(),
+              result.steadyAllocatingFrames);
+      allocated = true;
+    }
+  }
+
+  delete game;
+  delete tileMapRenderer;
+  delete entities;
+  delete pathfinder;
+  delete world;
+  delete textRenderer;
+  delete atlas;
+  delete content;
+  delete pack;
+  delete batch;
+  delete screen;
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+  IMG_Quit();
+  SDL_Quit();
+  return allocated ? EXIT_FAILURE : EXIT_SUCCESS;
+}
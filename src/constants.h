@@ -10,12 +10,32 @@ const int TILES_L = GAME_W / TILE_W / 2 + 2,
           TILES_U = GAME_H / TILE_H / 2 + 2,
           TILES_D = GAME_H / TILE_H / 2 + 2;
 
-// Window coords
-const int SCALING_FACTOR = 6; // 1920 x 1080
-const int SCREEN_W = GAME_W * SCALING_FACTOR, SCREEN_H = GAME_H * SCALING_FACTOR;
+// Map chunks, baked into one texture each
+const int CHUNK_TILES = 16;
+const int CHUNK_W = CHUNK_TILES * TILE_W, CHUNK_H = CHUNK_TILES * TILE_H;
+const int CHUNK_AREA = CHUNK_TILES * CHUNK_TILES;
+static_assert((CHUNK_TILES & (CHUNK_TILES - 1)) == 0, "World indexing needs a power-of-two chunk size");
+
+// World, when generated rather than loaded. Chunks are only made as the
+// player gets near them, so the size costs little.
+const int WORLD_W = 4096, WORLD_H = 4096;
+const int DEFAULT_ENTITIES = 300;
+
+// Window coords. Only the size asked for: the game is scaled by whatever
+// whole factor fits the window it actually gets.
+const int WINDOW_SCALE = 6; // 1920 x 1080
+const int SCREEN_W = GAME_W * WINDOW_SCALE, SCREEN_H = GAME_H * WINDOW_SCALE;
 
 const double MAX_FPS = 240.0;
-const int WALK_FRAMES = 72;
+const int FRAME_ARENA_BYTES = 64 * 1024; // transient text and scratch for one frame
+const int AUTOSAVE_SECONDS = 5;           // copied between frames, written in the background
+
+// Simulation, in fixed ticks independent of the frame rate
+const int TICKS_PER_SECOND = 60;
+const int MAX_TICKS_PER_FRAME = 8;
+const int WALK_TICKS = 18;            // 0.3 s per tile
+const int TEXT_CHARS_PER_SECOND = 80; // typewriter reveal speed
+const int ACTION_TEXT_CAPACITY = 128; // battle messages, kept inline
 
 enum Direction
 {
@@ -25,10 +45,24 @@ enum Direction
   DOWN,
 };
 
-enum Tile
+enum Tile : unsigned char
 {
   G,
   W,
   M,
   H
 };
+// Every tile fits in these bits. Tiles mapped from a world file are masked
+// as they are read instead of checked when it is opened, so a damaged file
+// shows the wrong terrain rather than reading past the tables below.
+const int TILE_MASK = 3;
+static_assert(H <= TILE_MASK, "Tiles need to fit in TILE_MASK");
+
+// Cost of stepping onto each tile; 0 means it cannot be entered.
+constexpr int TILE_MOVE_COSTS[] = {
+    10, // G
+    0,  // W
+    0,  // M
+    20, // H
+};
+const int MIN_TILE_MOVE_COST = 10;
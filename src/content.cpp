@@ -0,0 +1,675 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <SDL.h>
+#include <boost/json/parse.hpp>
+#include <boost/json/value.hpp>
+#include "battle.h"
+#include "content.h"
+
+using namespace std;
+namespace json = boost::json;
+
+const char *const CONTENT_FILES[] = {"sprites.json", "animations.json", "enemies.json", "formations.json", "layouts.json"};
+// Names in sprites.json and layouts.json, in BattleAction order.
+const char *const BATTLE_ACTION_KEYS[BATTLE_ACTION_COUNT] = {"attack", "magic", "item", "run"};
+const char *const HIGHLIGHT_CORNER_KEYS[] = {"highlightTL", "highlightTR", "highlightBR", "highlightBL"};
+// Keys of the player's clips in layouts.json, in Direction order.
+const char *const DIRECTION_KEYS[] = {"left", "right", "up", "down"};
+// Bounds on any coordinate, to catch typos rather than to fit some screen.
+const int MAX_CONTENT_COORD = 1 << 16;
+
+// sheet -> sprite name -> rect
+typedef unordered_map<string, unordered_map<string, SDL_Rect>> SpriteTable;
+
+// FNV-1a
+static uint64_t StampBytes(uint64_t stamp, const void *data, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    stamp = (stamp ^ ((const unsigned char *)data)[i]) * 0x100000001b3ULL;
+  }
+  return stamp;
+}
+
+// Changes whenever a source file is added, removed, resized or saved, which
+// is cheaper to check than the contents. 0 if there are no sources at all.
+static uint64_t StampSources(const string &sourceDir)
+{
+  uint64_t stamp = 0xcbf29ce484222325ULL;
+  bool found = false;
+  for (const char *name : CONTENT_FILES)
+  {
+    filesystem::path path = filesystem::path(sourceDir) / name;
+    error_code error;
+    uint64_t size = filesystem::file_size(path, error);
+    if (error)
+    {
+      size = UINT64_MAX;
+    }
+    int64_t modified = filesystem::last_write_time(path, error).time_since_epoch().count();
+    found = found || size != UINT64_MAX;
+    stamp = StampBytes(stamp, name, strlen(name));
+    stamp = StampBytes(stamp, &size, sizeof(size));
+    stamp = StampBytes(stamp, &modified, sizeof(modified));
+  }
+  return found ? stamp : 0;
+}
+
+// Cheap checks that indices in a cache from disk stay in range.
+static bool IsValidClip(const ContentData &data, int clip)
+{
+  return clip >= 0 && clip < data.animClipCount;
+}
+
+static bool IsValidContent(const ContentData &data)
+{
+  if (data.animFrameCount < 1 || data.animFrameCount > MAX_ANIM_FRAMES ||
+      data.animClipCount < 1 || data.animClipCount > MAX_ANIM_CLIPS ||
+      data.enemyKindCount < 1 || data.enemyKindCount > MAX_ENEMY_KINDS ||
+      data.formationCount < 1 || data.formationCount > MAX_FORMATIONS ||
+      !IsValidClip(data, data.map.monster) || !IsValidClip(data, data.map.object) ||
+      !IsValidClip(data, data.map.villager))
+  {
+    return false;
+  }
+  for (int direction = 0; direction < 4; direction++)
+  {
+    if (!IsValidClip(data, data.map.playerStand[direction]) || !IsValidClip(data, data.map.playerWalk[direction]))
+    {
+      return false;
+    }
+  }
+  for (int i = 0; i < data.animFrameCount; i++)
+  {
+    if (data.animFrameTicks[i] < 1)
+    {
+      return false;
+    }
+  }
+  for (int i = 0; i < data.animClipCount; i++)
+  {
+    const AnimClip &clip = data.animClips[i];
+    if (clip.name[CONTENT_NAME_LENGTH - 1] != '\0' || clip.frameCount < 1 || clip.firstFrame < 0 ||
+        clip.firstFrame > data.animFrameCount - clip.frameCount)
+    {
+      return false;
+    }
+  }
+  for (int i = 0; i < data.enemyKindCount; i++)
+  {
+    if (data.enemyKinds[i].name[CONTENT_NAME_LENGTH - 1] != '\0' || !IsValidClip(data, data.enemyKinds[i].idleClip))
+    {
+      return false;
+    }
+  }
+  for (int i = 0; i < data.formationCount; i++)
+  {
+    const Formation &formation = data.formations[i];
+    if (formation.name[CONTENT_NAME_LENGTH - 1] != '\0' || formation.slotCount < 1 ||
+        formation.slotCount > MAX_BATTLE_ENEMIES)
+    {
+      return false;
+    }
+    for (int slot = 0; slot < formation.slotCount; slot++)
+    {
+      const FormationSlot &formationSlot = formation.slots[slot];
+      if (formationSlot.enemyKind < 0 || formationSlot.enemyKind >= data.enemyKindCount || formationSlot.startFrame < 0 ||
+          formationSlot.startFrame >= data.animClips[data.enemyKinds[formationSlot.enemyKind].idleClip].frameCount)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// sourceStamp 0 takes the cache whatever it was built from.
+static bool ReadCache(const string &path, uint64_t sourceStamp, ContentData *data)
+{
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL)
+  {
+    return false;
+  }
+  ContentCacheHeader header;
+  bool read = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, CONTENT_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+              header.version == CONTENT_CACHE_VERSION && header.dataSize == sizeof(ContentData) &&
+              (sourceStamp == 0 || header.sourceStamp == sourceStamp) &&
+              fread(data, sizeof(*data), 1, file) == 1;
+  fclose(file);
+  if (read && !IsValidContent(*data))
+  {
+    printf("%s is damaged\n", path.c_str());
+    return false;
+  }
+  return read;
+}
+
+static void WriteCache(const string &path, uint64_t sourceStamp, const ContentData &data)
+{
+  FILE *file = fopen(path.c_str(), "wb");
+  if (file == NULL)
+  {
+    printf("Unable to write content cache %s\n", path.c_str());
+    return;
+  }
+  ContentCacheHeader header = {};
+  memcpy(header.magic, CONTENT_CACHE_MAGIC, sizeof(header.magic));
+  header.version = CONTENT_CACHE_VERSION;
+  header.sourceStamp = sourceStamp;
+  header.dataSize = sizeof(ContentData);
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(&data, sizeof(data), 1, file);
+  fclose(file);
+}
+
+// The top level of every source file is an object.
+static bool ParseFile(const string &sourceDir, const char *name, json::value *value)
+{
+  string path = sourceDir + "/" + name;
+  ifstream in(path, ios::binary);
+  if (!in)
+  {
+    printf("Unable to open %s\n", path.c_str());
+    return false;
+  }
+  string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+  json::error_code error;
+  *value = json::parse(text, error);
+  if (error)
+  {
+    printf("%s: %s\n", name, error.message().c_str());
+    return false;
+  }
+  if (!value->is_object())
+  {
+    printf("%s should hold an object\n", name);
+    return false;
+  }
+  return true;
+}
+
+static const json::value *Member(const json::value &object, const char *key, const string &where)
+{
+  const json::object *members = object.if_object();
+  const json::value *member = members != NULL ? members->if_contains(key) : NULL;
+  if (member == NULL)
+  {
+    printf("%s: missing \"%s\"\n", where.c_str(), key);
+  }
+  return member;
+}
+
+static bool ReadInt(const json::value *value, const string &where, int min, int max, int *out)
+{
+  const int64_t *number = value != NULL ? value->if_int64() : NULL;
+  if (number == NULL || *number < min || *number > max)
+  {
+    printf("%s should be a whole number from %d to %d\n", where.c_str(), min, max);
+    return false;
+  }
+  *out = (int)*number;
+  return true;
+}
+
+// [x, y] or [x, y, w, h]
+static bool ReadInts(const json::value *value, const string &where, int *out, size_t count)
+{
+  const json::array *numbers = value != NULL ? value->if_array() : NULL;
+  if (numbers == NULL || numbers->size() != count)
+  {
+    printf("%s should be %s\n", where.c_str(), count == 2 ? "[x, y]" : "[x, y, w, h]");
+    return false;
+  }
+  for (size_t i = 0; i < count; i++)
+  {
+    if (!ReadInt(&(*numbers)[i], where, -MAX_CONTENT_COORD, MAX_CONTENT_COORD, &out[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool ReadRect(const json::value *value, const string &where, SDL_Rect *rect)
+{
+  int numbers[4];
+  if (!ReadInts(value, where, numbers, 4))
+  {
+    return false;
+  }
+  *rect = {x : numbers[0], y : numbers[1], w : numbers[2], h : numbers[3]};
+  if (rect->w <= 0 || rect->h <= 0)
+  {
+    printf("%s is empty\n", where.c_str());
+    return false;
+  }
+  return true;
+}
+
+static bool ReadName(const json::value *value, const string &where, string *name)
+{
+  const json::string *text = value != NULL ? value->if_string() : NULL;
+  if (text == NULL || text->size() == 0 || text->size() >= (size_t)CONTENT_NAME_LENGTH)
+  {
+    printf("%s should be a name of 1 to %d characters\n", where.c_str(), CONTENT_NAME_LENGTH - 1);
+    return false;
+  }
+  *name = text->c_str();
+  return true;
+}
+
+static bool FindSprite(const SpriteTable &sprites, const char *sheet, const string &name, const string &where,
+                       SDL_Rect *rect)
+{
+  auto sheetSprites = sprites.find(sheet);
+  if (sheetSprites == sprites.end() || !sheetSprites->second.contains(name))
+  {
+    printf("%s: no sprite \"%s\" in %s\n", where.c_str(), name.c_str(), sheet);
+    return false;
+  }
+  *rect = sheetSprites->second.at(name);
+  return true;
+}
+
+static bool ReadSprite(const SpriteTable &sprites, const char *sheet, const json::value *value, const string &where,
+                       SDL_Rect *rect)
+{
+  string name;
+  return ReadName(value, where, &name) && FindSprite(sprites, sheet, name, where, rect);
+}
+
+static bool ReadEnemyKind(const ContentData &data, const json::value *value, const string &where, int *kind)
+{
+  string name;
+  if (!ReadName(value, where, &name))
+  {
+    return false;
+  }
+  for (int i = 0; i < data.enemyKindCount; i++)
+  {
+    if (name == data.enemyKinds[i].name)
+    {
+      *kind = i;
+      return true;
+    }
+  }
+  printf("%s: no enemy \"%s\" in enemies.json\n", where.c_str(), name.c_str());
+  return false;
+}
+
+static bool ReadClip(const ContentData &data, const json::value *value, const string &where, int *clip)
+{
+  string name;
+  if (!ReadName(value, where, &name))
+  {
+    return false;
+  }
+  for (int i = 0; i < data.animClipCount; i++)
+  {
+    if (name == data.animClips[i].name)
+    {
+      *clip = i;
+      return true;
+    }
+  }
+  printf("%s: no clip \"%s\" in animations.json\n", where.c_str(), name.c_str());
+  return false;
+}
+
+static bool CompileSprites(const json::value &source, SpriteTable *sprites)
+{
+  for (const json::key_value_pair &sheet : source.get_object())
+  {
+    string where = format("sprites.json: {}", string_view(sheet.key()));
+    if (!sheet.value().is_object())
+    {
+      printf("%s should hold an object\n", where.c_str());
+      return false;
+    }
+    for (const json::key_value_pair &sprite : sheet.value().get_object())
+    {
+      if (!ReadRect(&sprite.value(), format("{}: {}", where, string_view(sprite.key())),
+                    &(*sprites)[string(sheet.key())][string(sprite.key())]))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static bool CompileAnimations(const json::value &source, const SpriteTable &sprites, ContentData *data)
+{
+  const json::object &clips = source.get_object();
+  if (clips.size() < 1 || clips.size() > (size_t)MAX_ANIM_CLIPS)
+  {
+    printf("animations.json should hold 1 to %d clips\n", MAX_ANIM_CLIPS);
+    return false;
+  }
+  data->animClipCount = 0;
+  data->animFrameCount = 0;
+  for (const json::key_value_pair &entry : clips)
+  {
+    string where = format("animations.json: {}", string_view(entry.key()));
+    if (entry.key().size() >= (size_t)CONTENT_NAME_LENGTH)
+    {
+      printf("%s: names are at most %d characters\n", where.c_str(), CONTENT_NAME_LENGTH - 1);
+      return false;
+    }
+    AnimClip &clip = data->animClips[data->animClipCount++];
+    entry.key().copy(clip.name, CONTENT_NAME_LENGTH - 1);
+    string sheet;
+    if (!ReadName(Member(entry.value(), "sheet", where), where + ": sheet", &sheet))
+    {
+      return false;
+    }
+    const json::value *frames = Member(entry.value(), "frames", where);
+    if (frames == NULL || !frames->is_array() || frames->get_array().size() < 1 ||
+        frames->get_array().size() > (size_t)(MAX_ANIM_FRAMES - data->animFrameCount))
+    {
+      printf("%s: frames should list 1 or more frames, and %d at most over all clips\n", where.c_str(),
+             MAX_ANIM_FRAMES);
+      return false;
+    }
+    clip.firstFrame = data->animFrameCount;
+    clip.frameCount = (int)frames->get_array().size();
+    for (int i = 0; i < clip.frameCount; i++)
+    {
+      string frameWhere = format("{}: frames[{}]", where, i);
+      const json::array *frame = frames->get_array()[i].if_array();
+      if (frame == NULL || frame->size() != 2)
+      {
+        printf("%s should be [sprite, ticks]\n", frameWhere.c_str());
+        return false;
+      }
+      int index = data->animFrameCount++;
+      if (!ReadSprite(sprites, sheet.c_str(), &(*frame)[0], frameWhere, &data->animFrameRects[index]) ||
+          !ReadInt(&(*frame)[1], frameWhere + ": ticks", 1, 60 * 60, &data->animFrameTicks[index]))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static bool CompileEnemies(const json::value &source, ContentData *data)
+{
+  const json::object &enemies = source.get_object();
+  if (enemies.size() < 1 || enemies.size() > (size_t)MAX_ENEMY_KINDS)
+  {
+    printf("enemies.json should hold 1 to %d enemies\n", MAX_ENEMY_KINDS);
+    return false;
+  }
+  data->enemyKindCount = 0;
+  for (const json::key_value_pair &enemy : enemies)
+  {
+    string where = format("enemies.json: {}", string_view(enemy.key()));
+    if (enemy.key().size() >= (size_t)CONTENT_NAME_LENGTH)
+    {
+      printf("%s: names are at most %d characters\n", where.c_str(), CONTENT_NAME_LENGTH - 1);
+      return false;
+    }
+    EnemyKind &kind = data->enemyKinds[data->enemyKindCount++];
+    enemy.key().copy(kind.name, CONTENT_NAME_LENGTH - 1);
+    if (!ReadInt(Member(enemy.value(), "hp", where), where + ": hp", 1, 9999, &kind.hp))
+    {
+      return false;
+    }
+    if (!ReadClip(*data, Member(enemy.value(), "idle", where), where + ": idle", &kind.idleClip))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool CompileFormations(const json::value &source, const SpriteTable &sprites, ContentData *data)
+{
+  const json::object &formations = source.get_object();
+  if (formations.size() < 1 || formations.size() > (size_t)MAX_FORMATIONS)
+  {
+    printf("formations.json should hold 1 to %d formations\n", MAX_FORMATIONS);
+    return false;
+  }
+  data->formationCount = 0;
+  for (const json::key_value_pair &entry : formations)
+  {
+    string where = format("formations.json: {}", string_view(entry.key()));
+    if (entry.key().size() >= (size_t)CONTENT_NAME_LENGTH)
+    {
+      printf("%s: names are at most %d characters\n", where.c_str(), CONTENT_NAME_LENGTH - 1);
+      return false;
+    }
+    Formation &formation = data->formations[data->formationCount++];
+    entry.key().copy(formation.name, CONTENT_NAME_LENGTH - 1);
+    if (!ReadSprite(sprites, "battleBGs.png", Member(entry.value(), "background", where), where + ": background",
+                    &formation.background))
+    {
+      return false;
+    }
+    const json::value *enemies = Member(entry.value(), "enemies", where);
+    if (enemies == NULL || !enemies->is_array() || enemies->get_array().size() < 1 ||
+        enemies->get_array().size() > (size_t)MAX_BATTLE_ENEMIES)
+    {
+      printf("%s: enemies should list 1 to %d enemies\n", where.c_str(), MAX_BATTLE_ENEMIES);
+      return false;
+    }
+    formation.slotCount = (int)enemies->get_array().size();
+    for (int i = 0; i < formation.slotCount; i++)
+    {
+      const json::value &enemy = enemies->get_array()[i];
+      string slotWhere = format("{}: enemies[{}]", where, i);
+      FormationSlot &slot = formation.slots[i];
+      int at[2];
+      if (!ReadEnemyKind(*data, Member(enemy, "enemy", slotWhere), slotWhere + ": enemy", &slot.enemyKind) ||
+          !ReadInts(Member(enemy, "at", slotWhere), slotWhere + ": at", at, 2))
+      {
+        return false;
+      }
+      const AnimClip &idle = data->animClips[data->enemyKinds[slot.enemyKind].idleClip];
+      slot.startFrame = 0;
+      const json::value *startFrame = enemy.get_object().if_contains("startFrame");
+      if (startFrame != NULL &&
+          !ReadInt(startFrame, slotWhere + ": startFrame", 0, idle.frameCount - 1, &slot.startFrame))
+      {
+        return false;
+      }
+      const SDL_Rect &sprite = data->animFrameRects[idle.firstFrame];
+      slot.position = {x : at[0], y : at[1], w : sprite.w, h : sprite.h};
+    }
+  }
+  return true;
+}
+
+static bool CompileLayouts(const json::value &source, const SpriteTable &sprites, ContentData *data)
+{
+  const json::value *battle = Member(source, "battle", "layouts.json");
+  if (battle == NULL)
+  {
+    return false;
+  }
+  BattleLayout &layout = data->battle;
+  for (int action = 0; action < BATTLE_ACTION_COUNT; action++)
+  {
+    const char *key = BATTLE_ACTION_KEYS[action];
+    if (!FindSprite(sprites, "battle.png", key, "layouts.json: battle", &layout.actionLabels[action]) ||
+        !ReadRect(Member(*battle, key, "layouts.json: battle"), format("layouts.json: battle: {}", key),
+                  &layout.actionLabelPositions[action]))
+    {
+      return false;
+    }
+  }
+  for (int corner = 0; corner < 4; corner++)
+  {
+    if (!FindSprite(sprites, "battle.png", HIGHLIGHT_CORNER_KEYS[corner], "layouts.json: battle",
+                    &layout.highlightCorners[corner]))
+    {
+      return false;
+    }
+  }
+  int selectOffset[2];
+  if (!FindSprite(sprites, "battle.png", "select", "layouts.json: battle", &layout.select) ||
+      !ReadInts(Member(*battle, "cursorOffset", "layouts.json: battle"), "layouts.json: battle: cursorOffset",
+                selectOffset, 2) ||
+      !ReadRect(Member(*battle, "descriptionBox", "layouts.json: battle"), "layouts.json: battle: descriptionBox",
+                &layout.descriptionBox) ||
+      !ReadRect(Member(*battle, "background", "layouts.json: battle"), "layouts.json: battle: background",
+                &layout.backgroundPosition))
+  {
+    return false;
+  }
+  layout.selectOffset = {x : selectOffset[0], y : selectOffset[1]};
+
+  const json::value *map = Member(source, "map", "layouts.json");
+  if (map == NULL ||
+      !ReadClip(*data, Member(*map, "monster", "layouts.json: map"), "layouts.json: map: monster", &data->map.monster) ||
+      !ReadClip(*data, Member(*map, "object", "layouts.json: map"), "layouts.json: map: object", &data->map.object) ||
+      !ReadClip(*data, Member(*map, "villager", "layouts.json: map"), "layouts.json: map: villager",
+                &data->map.villager))
+  {
+    return false;
+  }
+  const json::value *playerStand = Member(*map, "playerStand", "layouts.json: map");
+  const json::value *playerWalk = Member(*map, "playerWalk", "layouts.json: map");
+  if (playerStand == NULL || playerWalk == NULL)
+  {
+    return false;
+  }
+  for (int direction = 0; direction < 4; direction++)
+  {
+    const char *key = DIRECTION_KEYS[direction];
+    if (!ReadClip(*data, Member(*playerStand, key, "layouts.json: map: playerStand"),
+                  format("layouts.json: map: playerStand: {}", key), &data->map.playerStand[direction]) ||
+        !ReadClip(*data, Member(*playerWalk, key, "layouts.json: map: playerWalk"),
+                  format("layouts.json: map: playerWalk: {}", key), &data->map.playerWalk[direction]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// In the order of CONTENT_FILES, so everything is defined before it is
+// referred to by name.
+static bool CompileContent(const string &sourceDir, ContentData *data)
+{
+  json::value sources[size(CONTENT_FILES)];
+  for (size_t i = 0; i < size(CONTENT_FILES); i++)
+  {
+    if (!ParseFile(sourceDir, CONTENT_FILES[i], &sources[i]))
+    {
+      return false;
+    }
+  }
+  SpriteTable sprites;
+  *data = {};
+  return CompileSprites(sources[0], &sprites) &&
+         CompileAnimations(sources[1], sprites, data) &&
+         CompileEnemies(sources[2], data) &&
+         CompileFormations(sources[3], sprites, data) &&
+         CompileLayouts(sources[4], sprites, data);
+}
+
+Content *Content::Load(const string &sourceDir, const string &cachePath)
+{
+  Content *content = new Content();
+  uint64_t sourceStamp = StampSources(sourceDir);
+  if (ReadCache(cachePath, sourceStamp, &content->data))
+  {
+    return content;
+  }
+  if (sourceStamp == 0)
+  {
+    printf("No content in %s or %s\n", sourceDir.c_str(), cachePath.c_str());
+    delete content;
+    return NULL;
+  }
+
+  auto compileStart = chrono::steady_clock::now();
+  if (!CompileContent(sourceDir, &content->data))
+  {
+    delete content;
+    return NULL;
+  }
+  WriteCache(cachePath, sourceStamp, content->data);
+  printf("Compiled content from %s in %.1f ms\n", sourceDir.c_str(),
+         chrono::duration<double, milli>(chrono::steady_clock::now() - compileStart).count());
+  return content;
+}
+
+const BattleLayout &Content::GetBattleLayout() const
+{
+  return data.battle;
+}
+
+const MapClips &Content::GetMapClips() const
+{
+  return data.map;
+}
+
+const AnimClip &Content::GetAnimClip(int clip) const
+{
+  return data.animClips[clip];
+}
+
+int Content::GetAnimClipCount() const
+{
+  return data.animClipCount;
+}
+
+const SDL_Rect *Content::GetAnimFrameRects() const
+{
+  return data.animFrameRects;
+}
+
+const int *Content::GetAnimFrameTicks() const
+{
+  return data.animFrameTicks;
+}
+
+const EnemyKind &Content::GetEnemyKind(int kind) const
+{
+  return data.enemyKinds[kind];
+}
+
+const Formation &Content::GetFormation(int formation) const
+{
+  return data.formations[formation];
+}
+
+int Content::GetFormationCount() const
+{
+  return data.formationCount;
+}
+
+int Content::FindFormation(const string &name) const
+{
+  for (int i = 0; i < data.formationCount; i++)
+  {
+    if (name == data.formations[i].name)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void StartBattle(BattleState *state, const Content *content, const Formation &formation)
+{
+  int enemyHp[MAX_BATTLE_ENEMIES];
+  for (int i = 0; i < formation.slotCount; i++)
+  {
+    enemyHp[i] = content->GetEnemyKind(formation.slots[i].enemyKind).hp;
+  }
+  StartBattle(state, enemyHp, formation.slotCount);
+}
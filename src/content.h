@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <SDL.h>
+#include "battle.h"
+
+using namespace std;
+
+// Game content is authored as JSON in assets/content/:
+//   sprites.json     sheet file -> sprite name -> [x, y, w, h]
+//   animations.json  clip name -> {"sheet", "frames": [[sprite, ticks], ...]}
+//   enemies.json     enemy name -> {"hp", "idle": clip}
+//   formations.json  formation name -> {"background": sprite from battleBGs.png,
+//                                       "enemies": [{"enemy", "at": [x, y], "startFrame"}]}
+//   layouts.json     screen -> element -> [x, y, w, h], plus which clips the map plays
+//
+// Parsing and checking that is only done when those files change: the
+// result is a ContentData written to a cache file behind a
+// ContentCacheHeader, which later launches read back in one go.
+const char CONTENT_CACHE_MAGIC[4] = {'T', 'B', 'R', 'C'};
+const uint32_t CONTENT_CACHE_VERSION = 2;
+const int CONTENT_NAME_LENGTH = 32;
+const int MAX_ANIM_CLIPS = 128;
+const int MAX_ANIM_FRAMES = 1024; // over all clips
+const int MAX_ENEMY_KINDS = 32;
+const int MAX_FORMATIONS = 16;
+
+struct ContentCacheHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t sourceStamp; // hash of the source files' names, sizes and modification times
+  uint64_t dataSize;    // sizeof(ContentData), which changes with the layout
+};
+
+// A looping run of frames. The frames of every clip are stored back to back
+// in ContentData, so an animator can step any clip with the same two
+// lookups.
+struct AnimClip
+{
+  char name[CONTENT_NAME_LENGTH];
+  int firstFrame;
+  int frameCount;
+};
+
+struct EnemyKind
+{
+  char name[CONTENT_NAME_LENGTH];
+  int hp;
+  int idleClip; // enemies.png
+};
+
+struct FormationSlot
+{
+  int enemyKind;
+  // Which frame of the idle clip the slot starts on, so neighbours of the
+  // same kind don't move in lockstep.
+  int startFrame;
+  SDL_Rect position; // the size of the idle clip's first frame
+};
+
+struct Formation
+{
+  char name[CONTENT_NAME_LENGTH];
+  SDL_Rect background; // battleBGs.png
+  int slotCount;
+  FormationSlot slots[MAX_BATTLE_ENEMIES];
+};
+
+// Where the battle screen puts things, and the battle.png sprites it uses.
+struct BattleLayout
+{
+  SDL_Rect actionLabels[BATTLE_ACTION_COUNT];
+  SDL_Rect actionLabelPositions[BATTLE_ACTION_COUNT];
+  SDL_Rect select;
+  SDL_Point selectOffset; // from the chosen action's label
+  SDL_Rect highlightCorners[4]; // top left, top right, bottom right, bottom left
+  SDL_Rect descriptionBox;
+  SDL_Rect backgroundPosition;
+};
+
+// The clips the map plays. Player clips are indexed by Direction; side-on
+// frames face left and are flipped for RIGHT.
+struct MapClips
+{
+  int monster;  // enemies.png
+  int object;   // enemies.png
+  int villager; // characters.png
+  int playerStand[4];
+  int playerWalk[4];
+};
+
+// Plain data throughout, so it is written and read as is.
+struct ContentData
+{
+  BattleLayout battle;
+  MapClips map;
+  int animClipCount;
+  AnimClip animClips[MAX_ANIM_CLIPS];
+  int animFrameCount;
+  SDL_Rect animFrameRects[MAX_ANIM_FRAMES];
+  int animFrameTicks[MAX_ANIM_FRAMES]; // at least 1
+  int enemyKindCount;
+  EnemyKind enemyKinds[MAX_ENEMY_KINDS];
+  int formationCount;
+  Formation formations[MAX_FORMATIONS];
+};
+
+class Content
+{
+public:
+  // Reads the cache at cachePath if it was built from the files now in
+  // sourceDir, otherwise compiles those and rewrites the cache. Without
+  // any sources the cache is used as is. NULL, after printing what is
+  // wrong, if the sources have errors or there is nothing to load.
+  static Content *Load(const string &sourceDir, const string &cachePath);
+
+  const BattleLayout &GetBattleLayout() const;
+  const MapClips &GetMapClips() const;
+  const AnimClip &GetAnimClip(int clip) const;
+  int GetAnimClipCount() const;
+  // Indexed by AnimClip::firstFrame and the frames after it.
+  const SDL_Rect *GetAnimFrameRects() const;
+  const int *GetAnimFrameTicks() const;
+  const EnemyKind &GetEnemyKind(int kind) const;
+  // The first formation is the one battles use until there are encounters.
+  const Formation &GetFormation(int formation) const;
+  int GetFormationCount() const;
+  // -1 if there is none by that name.
+  int FindFormation(const string &name) const;
+
+private:
+  ContentData data;
+};
+
+// Starting hit points for every slot of formation, in slot order.
+void StartBattle(BattleState *state, const Content *content, const Formation &formation);
@@ -0,0 +1,125 @@
+#include <vector>
+#include <SDL.h>
+#include "profiler.h"
+#include "draw_list.h"
+
+using namespace std;
+
+const int INITIAL_QUAD_CAPACITY = 1024;
+
+DrawList::DrawList()
+{
+  commands.reserve(INITIAL_QUAD_CAPACITY);
+  vertices.reserve(INITIAL_QUAD_CAPACITY * 4);
+  indices.reserve(INITIAL_QUAD_CAPACITY * 6);
+}
+
+void DrawList::Push(const DrawCommand &command)
+{
+  commands.push_back(command);
+}
+
+void DrawList::Clear()
+{
+  commands.clear();
+}
+
+SpriteBatchStats DrawList::Play(SDL_Renderer *renderer)
+{
+  SpriteBatchStats stats = {0, 0};
+  SDL_Texture *previousTarget = NULL;
+  Uint8 r, g, b, a;
+  int textureW = 1, textureH = 1;
+  // Textures can be destroyed or edited between frames, so never carry the
+  // current one over.
+  currentTexture = NULL;
+
+  for (const DrawCommand &command : commands)
+  {
+    switch (command.op)
+    {
+    case DrawOp::BeginTarget:
+      Flush(renderer, &stats);
+      previousTarget = SDL_GetRenderTarget(renderer);
+      SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+      SDL_SetRenderTarget(renderer, command.texture);
+      SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+      SDL_RenderClear(renderer);
+      break;
+    case DrawOp::EndTarget:
+      Flush(renderer, &stats);
+      SDL_SetRenderTarget(renderer, previousTarget);
+      SDL_SetRenderDrawColor(renderer, r, g, b, a);
+      break;
+    case DrawOp::Sprite:
+    case DrawOp::TextureSprite:
+    {
+      if (command.texture != currentTexture)
+      {
+        Flush(renderer, &stats);
+        currentTexture = command.texture;
+        SDL_QueryTexture(currentTexture, NULL, NULL, &textureW, &textureH);
+      }
+
+      SDL_Rect src = command.src;
+      SDL_Color color = command.color;
+      if (command.op == DrawOp::TextureSprite)
+      {
+        if (src.w == 0)
+        {
+          src = {x : 0, y : 0, w : textureW, h : textureH};
+        }
+        SDL_GetTextureColorMod(currentTexture, &color.r, &color.g, &color.b);
+        SDL_GetTextureAlphaMod(currentTexture, &color.a);
+      }
+
+      float u0 = (float)src.x / textureW, u1 = (float)(src.x + src.w) / textureW;
+      float v0 = (float)src.y / textureH, v1 = (float)(src.y + src.h) / textureH;
+      if (command.flip & SDL_FLIP_HORIZONTAL)
+      {
+        swap(u0, u1);
+      }
+      if (command.flip & SDL_FLIP_VERTICAL)
+      {
+        swap(v0, v1);
+      }
+
+      float x0 = command.dst.x, x1 = command.dst.x + command.dst.w;
+      float y0 = command.dst.y, y1 = command.dst.y + command.dst.h;
+
+      int base = vertices.size();
+      vertices.push_back({position : {x0, y0}, color : color, tex_coord : {u0, v0}});
+      vertices.push_back({position : {x1, y0}, color : color, tex_coord : {u1, v0}});
+      vertices.push_back({position : {x1, y1}, color : color, tex_coord : {u1, v1}});
+      vertices.push_back({position : {x0, y1}, color : color, tex_coord : {u0, v1}});
+
+      // The index pattern never changes, so it only has to be written once
+      // per quad slot and is then reused by every later frame.
+      if (indices.size() < (vertices.size() / 4) * 6)
+      {
+        indices.insert(indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+      }
+      stats.sprites++;
+      break;
+    }
+    }
+  }
+  Flush(renderer, &stats);
+
+  g_profiler.Count(ProfileCounter::SpriteDraws, stats.sprites);
+  g_profiler.Count(ProfileCounter::DrawCalls, stats.drawCalls);
+  return stats;
+}
+
+void DrawList::Flush(SDL_Renderer *renderer, SpriteBatchStats *stats)
+{
+  if (vertices.empty())
+  {
+    return;
+  }
+
+  int quadCount = vertices.size() / 4;
+  SDL_RenderGeometry(renderer, currentTexture, vertices.data(), vertices.size(), indices.data(), quadCount * 6);
+  stats->drawCalls++;
+  vertices.clear();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <SDL.h>
+
+using namespace std;
+
+struct SpriteBatchStats
+{
+  int sprites;   // quads played, i.e. what used to be one SDL_RenderCopy each
+  int drawCalls; // SDL_RenderGeometry submissions actually made
+};
+
+enum class DrawOp : uint8_t
+{
+  Sprite,        // with the color recorded
+  TextureSprite, // with the texture's own color mod, and all of it if src.w is 0
+  BeginTarget,   // draw into texture, cleared first, until EndTarget
+  EndTarget,
+};
+
+struct DrawCommand
+{
+  DrawOp op;
+  SDL_RendererFlip flip;
+  SDL_Color color;
+  SDL_Texture *texture;
+  SDL_Rect src; // in texture pixels
+  SDL_Rect dst;
+};
+
+// One frame's drawing as plain data. Recording never touches the renderer,
+// so it can happen on any thread; Play() is the only part that needs the
+// renderer's thread.
+class DrawList
+{
+public:
+  DrawList();
+
+  void Push(const DrawCommand &command);
+  void Clear();
+
+  // Submits every run of sprites sharing a texture with a single
+  // SDL_RenderGeometry call, in recorded order. Targets don't nest.
+  SpriteBatchStats Play(SDL_Renderer *renderer);
+
+private:
+  void Flush(SDL_Renderer *renderer, SpriteBatchStats *stats);
+
+  vector<DrawCommand> commands;
+
+  // Only used while playing; kept between frames so they stop growing.
+  vector<SDL_Vertex> vertices;
+  vector<int> indices;
+  SDL_Texture *currentTexture = NULL;
+};
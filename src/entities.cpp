@@ -0,0 +1,407 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <SDL.h>
+#include "constants.h"
+#include "world.h"
+#include "rng.h"
+#include "pathfinder.h"
+#include "save_state.h"
+#include "entities.h"
+
+using namespace std;
+
+const int ENTITY_CELL_SHIFT = __builtin_ctz(ENTITY_CELL_TILES);
+const int MIN_ENTITY_BUCKETS = 1024;
+const int SPAWN_ATTEMPTS_PER_ENTITY = 4;
+// Room every route buffer starts with, and never grows past: a route of the
+// longest radius crosses a handful of chunks, and routes with more waypoints
+// than this are given up on.
+const int ROUTE_RESERVED_WAYPOINTS = 16;
+const int ROUTE_RESERVED_STEPS = PATH_MAX_STEPS;
+
+// Ticks an entity waits between steps, by kind. Kinds with a route radius
+// walk to a random tile that far away at most, waiting only once there;
+// the rest take one step in a random direction at a time.
+struct WanderRule
+{
+  int minWait, maxWait;
+  int routeRadius;
+};
+const WanderRule WANDER_RULES[] = {
+    {minWait : 60, maxWait : 300, routeRadius : 24}, // Npc
+    {minWait : 20, maxWait : 120, routeRadius : 0},  // Monster
+    {minWait : 0, maxWait : 0, routeRadius : 0},     // Interactable, never moves
+};
+
+// Outside the world counts as water.
+static bool IsWalkable(const World *world, int x, int y)
+{
+  return TILE_MOVE_COSTS[world->Get(x, y)] > 0;
+}
+
+static void ReserveRoute(Path *route)
+{
+  route->waypoints.reserve(ROUTE_RESERVED_WAYPOINTS);
+  route->steps.reserve(ROUTE_RESERVED_STEPS);
+}
+
+EntityTable::EntityTable(int capacity)
+{
+  // About two entities per bucket when full.
+  int buckets = MIN_ENTITY_BUCKETS;
+  while (buckets < capacity / 2)
+  {
+    buckets *= 2;
+  }
+  bucketHeads.assign(buckets, -1);
+  bucketMask = buckets - 1;
+
+  positions.reserve(capacity);
+  nextInBucket.reserve(capacity);
+  previousInBucket.reserve(capacity);
+  previousPositions.reserve(capacity);
+  moveStarts.reserve(capacity);
+  nextMoveTicks.reserve(capacity);
+  kinds.reserve(capacity);
+  routes.reserve(capacity);
+  freeRoutes.reserve(capacity);
+}
+
+EntityTable *EntityTable::Spawn(const World *world, const SDL_Rect &area, int count, uint64_t seed)
+{
+  Rng rng(seed, RNG_STREAM_ENTITIES);
+  EntityTable *table = new EntityTable(count);
+  for (int attempt = 0; attempt < count * SPAWN_ATTEMPTS_PER_ENTITY && table->GetCount() < count; attempt++)
+  {
+    int x = rng.Range(area.x, area.x + area.w - 1);
+    int y = rng.Range(area.y, area.y + area.h - 1);
+    // Mostly monsters, with the odd villager and sign post.
+    int roll = rng.Range(0, 9);
+    EntityKind kind = roll < 7 ? EntityKind::Monster : roll < 9 ? EntityKind::Npc
+                                                                 : EntityKind::Interactable;
+    if (IsWalkable(world, x, y) && !table->IsOccupied(x, y))
+    {
+      table->Add(kind, x, y);
+    }
+  }
+  if (table->GetCount() < count)
+  {
+    printf("Only found room for %d of %d entities\n", table->GetCount(), count);
+  }
+  return table;
+}
+
+int EntityTable::Add(EntityKind kind, int x, int y)
+{
+  int entity = positions.size();
+  positions.push_back({x : x, y : y});
+  nextInBucket.push_back(-1);
+  previousInBucket.push_back(-1);
+  previousPositions.push_back({x : x, y : y});
+  moveStarts.push_back(0);
+  nextMoveTicks.push_back(0);
+  kinds.push_back(kind);
+  routes.push_back(-1);
+  Link(entity);
+  // Every entity that can follow a route brings one to the pool, and room
+  // for asking for one, so walking around never allocates.
+  if (WANDER_RULES[static_cast<int>(kind)].routeRadius > 0)
+  {
+    freeRoutes.push_back(routePool.size());
+    ReserveRoute(&routePool.emplace_back());
+    ReserveRoute(&routeResults.emplace_back());
+    routeRequests.reserve(routeResults.size());
+    routeRequesters.reserve(routeResults.size());
+  }
+  return entity;
+}
+
+int EntityTable::GetCount() const
+{
+  return positions.size();
+}
+
+EntityKind EntityTable::GetKind(int entity) const
+{
+  return kinds[entity];
+}
+
+SDL_Point EntityTable::GetPosition(int entity) const
+{
+  return positions[entity];
+}
+
+SDL_Point EntityTable::GetPixelPosition(int entity, double time) const
+{
+  double progress = min(1.0, max(0.0, (time - moveStarts[entity]) / WALK_TICKS));
+  SDL_Point from = previousPositions[entity], to = positions[entity];
+  return {
+    x : (int)lround((from.x + (to.x - from.x) * progress) * TILE_W),
+    y : (int)lround((from.y + (to.y - from.y) * progress) * TILE_H)};
+}
+
+int EntityTable::BucketFor(int x, int y) const
+{
+  uint32_t cellX = (uint32_t)(x >> ENTITY_CELL_SHIFT), cellY = (uint32_t)(y >> ENTITY_CELL_SHIFT);
+  return (int)((cellX * 73856093u ^ cellY * 19349663u) & bucketMask);
+}
+
+void EntityTable::Link(int entity)
+{
+  int bucket = BucketFor(positions[entity].x, positions[entity].y);
+  int head = bucketHeads[bucket];
+  nextInBucket[entity] = head;
+  previousInBucket[entity] = -1;
+  if (head >= 0)
+  {
+    previousInBucket[head] = entity;
+  }
+  bucketHeads[bucket] = entity;
+}
+
+void EntityTable::Unlink(int entity)
+{
+  int next = nextInBucket[entity], previous = previousInBucket[entity];
+  if (previous >= 0)
+  {
+    nextInBucket[previous] = next;
+  }
+  else
+  {
+    bucketHeads[BucketFor(positions[entity].x, positions[entity].y)] = next;
+  }
+  if (next >= 0)
+  {
+    previousInBucket[next] = previous;
+  }
+}
+
+bool EntityTable::IsOccupied(int x, int y) const
+{
+  for (int entity = bucketHeads[BucketFor(x, y)]; entity >= 0; entity = nextInBucket[entity])
+  {
+    if (positions[entity].x == x && positions[entity].y == y)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void EntityTable::Query(const SDL_Rect &area, vector<int> *out) const
+{
+  // Distant cells can share a bucket, so collect each bucket once.
+  queryBuckets.clear();
+  int maxX = area.x + area.w - 1, maxY = area.y + area.h - 1;
+  for (int cellY = area.y >> ENTITY_CELL_SHIFT; cellY <= maxY >> ENTITY_CELL_SHIFT; cellY++)
+  {
+    for (int cellX = area.x >> ENTITY_CELL_SHIFT; cellX <= maxX >> ENTITY_CELL_SHIFT; cellX++)
+    {
+      queryBuckets.push_back(BucketFor(cellX << ENTITY_CELL_SHIFT, cellY << ENTITY_CELL_SHIFT));
+    }
+  }
+  sort(queryBuckets.begin(), queryBuckets.end());
+  queryBuckets.erase(unique(queryBuckets.begin(), queryBuckets.end()), queryBuckets.end());
+
+  for (int bucket : queryBuckets)
+  {
+    for (int entity = bucketHeads[bucket]; entity >= 0; entity = nextInBucket[entity])
+    {
+      SDL_Point position = positions[entity];
+      if (position.x >= area.x && position.x <= maxX && position.y >= area.y && position.y <= maxY)
+      {
+        out->push_back(entity);
+      }
+    }
+  }
+}
+
+void EntityTable::Update(const World *world, Pathfinder *pathfinder, const SDL_Rect &area, const SDL_Rect &blocked,
+                         unsigned long long tick, Rng *rng)
+{
+  // Moving relinks entities, so pick who is due before anyone moves. The
+  // buckets' order depends on how entities moved in and out of them, so go
+  // by entity instead, which a loaded save reproduces.
+  updateScratch.clear();
+  Query(area, &updateScratch);
+  sort(updateScratch.begin(), updateScratch.end());
+
+  routeRequests.clear();
+  routeRequesters.clear();
+  for (int entity : updateScratch)
+  {
+    const WanderRule &rule = WANDER_RULES[static_cast<int>(kinds[entity])];
+    if (rule.maxWait == 0 || tick < nextMoveTicks[entity])
+    {
+      continue;
+    }
+
+    SDL_Point to = positions[entity];
+    if (rule.routeRadius > 0)
+    {
+      if (routes[entity] < 0)
+      {
+        // Routed all at once below. With a route the first step is taken
+        // next tick; without one the entity rests and tries again.
+        SDL_Point destination = {x : to.x + rng->Range(-rule.routeRadius, rule.routeRadius),
+                                 y : to.y + rng->Range(-rule.routeRadius, rule.routeRadius)};
+        routeRequests.push_back({from : to, to : destination, maxWaypoints : ROUTE_RESERVED_WAYPOINTS});
+        routeRequesters.push_back(entity);
+        nextMoveTicks[entity] = tick + WALK_TICKS + rng->Range(rule.minWait, rule.maxWait);
+        continue;
+      }
+      Path *route = &routePool[routes[entity]];
+      bool stepped = pathfinder->NextStep(route, &to);
+      if (!stepped || IsOccupied(to.x, to.y) || SDL_PointInRect(&to, &blocked))
+      {
+        // Arrived, or something is in the way: look for somewhere else to
+        // go after a rest.
+        FreeRoute(entity);
+        nextMoveTicks[entity] = tick + WALK_TICKS + rng->Range(rule.minWait, rule.maxWait);
+        continue;
+      }
+      nextMoveTicks[entity] = tick + WALK_TICKS;
+    }
+    else
+    {
+      nextMoveTicks[entity] = tick + WALK_TICKS + rng->Range(rule.minWait, rule.maxWait);
+      switch (rng->Range(LEFT, DOWN))
+      {
+      case LEFT:
+        to.x--;
+        break;
+      case RIGHT:
+        to.x++;
+        break;
+      case UP:
+        to.y--;
+        break;
+      case DOWN:
+        to.y++;
+        break;
+      }
+      if (!IsWalkable(world, to.x, to.y) || IsOccupied(to.x, to.y) || SDL_PointInRect(&to, &blocked))
+      {
+        continue;
+      }
+    }
+
+    Unlink(entity);
+    previousPositions[entity] = positions[entity];
+    positions[entity] = to;
+    moveStarts[entity] = tick;
+    Link(entity);
+  }
+
+  if (routeRequests.empty())
+  {
+    return;
+  }
+  // One batch for everyone who needs a route this tick.
+  pathfinder->FindPaths(routeRequests.data(), routeRequests.size(), routeResults.data());
+  for (int i = 0; i < (int)routeRequesters.size(); i++)
+  {
+    if (routeResults[i].IsEmpty())
+    {
+      continue;
+    }
+    int entity = routeRequesters[i];
+    routes[entity] = freeRoutes.back();
+    freeRoutes.pop_back();
+    // Swapping hands the pool's old buffers back to the scratch paths.
+    swap(routePool[routes[entity]], routeResults[i]);
+    routeResults[i].Clear();
+    nextMoveTicks[entity] = tick + 1;
+  }
+}
+
+void EntityTable::FreeRoute(int entity)
+{
+  routePool[routes[entity]].Clear();
+  freeRoutes.push_back(routes[entity]);
+  routes[entity] = -1;
+}
+
+void EntityTable::Snapshot(vector<SaveEntity> *out, vector<SDL_Point> *routePoints) const
+{
+  for (int entity = 0; entity < GetCount(); entity++)
+  {
+    SaveEntity saved = {
+      position : positions[entity],
+      previousPosition : previousPositions[entity],
+      moveStart : moveStarts[entity],
+      nextMoveTick : nextMoveTicks[entity],
+      route : {},
+      kind : static_cast<uint8_t>(kinds[entity]),
+      reserved : {}};
+    if (routes[entity] >= 0)
+    {
+      saved.route = routePool[routes[entity]].Save(routePoints);
+    }
+    out->push_back(saved);
+  }
+}
+
+bool EntityTable::Restore(const SaveEntity *saved, int count, const SDL_Point **routePoints,
+                          const SDL_Point *routePointsEnd)
+{
+  if (count != GetCount())
+  {
+    return false;
+  }
+  uint64_t pointCount = 0;
+  for (int entity = 0; entity < count; entity++)
+  {
+    const SaveEntity &entry = saved[entity];
+    // Kinds are settled by spawning, so a table spawned the same way has
+    // the same ones. Only kinds that route have room for one in the pool.
+    if (entry.kind != static_cast<uint8_t>(kinds[entity]) || !IsValidSaveRoute(entry.route) ||
+        (entry.route.waypointCount > 0 && WANDER_RULES[entry.kind].routeRadius == 0))
+    {
+      return false;
+    }
+    pointCount += (uint64_t)entry.route.waypointCount + entry.route.stepCount;
+  }
+  if (pointCount > (uint64_t)(routePointsEnd - *routePoints))
+  {
+    return false;
+  }
+
+  // Updates go in entity order, so the buckets can be rebuilt in any order.
+  bucketHeads.assign(bucketHeads.size(), -1);
+  for (int entity = 0; entity < count; entity++)
+  {
+    const SaveEntity &entry = saved[entity];
+    positions[entity] = entry.position;
+    previousPositions[entity] = entry.previousPosition;
+    moveStarts[entity] = entry.moveStart;
+    nextMoveTicks[entity] = entry.nextMoveTick;
+    Link(entity);
+
+    if (routes[entity] >= 0)
+    {
+      FreeRoute(entity);
+    }
+    if (entry.route.waypointCount > 0)
+    {
+      routes[entity] = freeRoutes.back();
+      freeRoutes.pop_back();
+      routePool[routes[entity]].Load(entry.route, routePoints);
+    }
+  }
+  return true;
+}
+
+size_t EntityTable::MemoryUsage() const
+{
+  return positions.capacity() * sizeof(SDL_Point) +
+         (nextInBucket.capacity() + previousInBucket.capacity()) * sizeof(int) +
+         previousPositions.capacity() * sizeof(SDL_Point) +
+         (moveStarts.capacity() + nextMoveTicks.capacity()) * sizeof(unsigned long long) +
+         kinds.capacity() * sizeof(EntityKind) +
+         bucketHeads.capacity() * sizeof(int) +
+         (routes.capacity() + freeRoutes.capacity()) * sizeof(int) +
+         routePool.capacity() * sizeof(Path);
+}
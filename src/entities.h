@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <SDL.h>
+#include "constants.h"
+#include "world.h"
+#include "rng.h"
+#include "pathfinder.h"
+#include "save_state.h"
+
+using namespace std;
+
+enum class EntityKind : uint8_t
+{
+  Npc,
+  Monster,
+  Interactable
+};
+
+// Entities are bucketed by ENTITY_CELL_TILES x ENTITY_CELL_TILES cells of
+// tiles, so a screen-sized query looks at a dozen or so buckets.
+const int ENTITY_CELL_TILES = 8;
+static_assert((ENTITY_CELL_TILES & (ENTITY_CELL_TILES - 1)) == 0, "Entity cells need a power-of-two size");
+// Entities this many tiles past the view window keep wandering; the rest of
+// the world stands still until the player comes near.
+const int ENTITY_UPDATE_MARGIN = 8;
+
+// Everything on the world map besides the player, one tile each, stored as
+// parallel arrays indexed by entity. A uniform spatial hash over tile cells
+// links entities into per-bucket lists, so finding what is on screen costs
+// the same with fifty entities or fifty thousand.
+class EntityTable
+{
+public:
+  EntityTable(int capacity);
+  // Spreads count entities over free land tiles inside area, from the
+  // entity stream of seed. May place fewer on a crowded map.
+  static EntityTable *Spawn(const World *world, const SDL_Rect &area, int count, uint64_t seed);
+
+  int Add(EntityKind kind, int x, int y);
+  int GetCount() const;
+
+  EntityKind GetKind(int entity) const;
+  SDL_Point GetPosition(int entity) const;
+  // Where the entity is drawn at time (in ticks, fractions blending between
+  // them), in world pixels. Steps take WALK_TICKS, the same as the player's.
+  SDL_Point GetPixelPosition(int entity, double time) const;
+
+  bool IsOccupied(int x, int y) const;
+  // Appends the entities on tiles inside area (in tiles) to out. Each
+  // entity appears once, in a deterministic order.
+  void Query(const SDL_Rect &area, vector<int> *out) const;
+
+  // Lets the entities inside area take a step when they are due, in entity
+  // order, onto land not occupied by another entity or by the tiles in
+  // blocked. Villagers follow routes from pathfinder, all found in one batch
+  // per call.
+  void Update(const World *world, Pathfinder *pathfinder, const SDL_Rect &area, const SDL_Rect &blocked,
+              unsigned long long tick, Rng *rng);
+
+  size_t MemoryUsage() const;
+
+  // For save files: appends every entity in order to out, and the points
+  // of their routes to routePoints.
+  void Snapshot(vector<SaveEntity> *out, vector<SDL_Point> *routePoints) const;
+  // Puts back what Snapshot() saved, over a table spawned the same way.
+  // The routes' points are read from *routePoints, which is moved past
+  // them. False, changing nothing, if the save doesn't fit.
+  bool Restore(const SaveEntity *saved, int count, const SDL_Point **routePoints, const SDL_Point *routePointsEnd);
+
+private:
+  int BucketFor(int x, int y) const;
+  void Link(int entity);
+  void Unlink(int entity);
+  void FreeRoute(int entity);
+
+  // Hot: read for every entity a query looks at.
+  vector<SDL_Point> positions;
+  vector<int> nextInBucket;
+  // Only read for entities that are updated or drawn.
+  vector<int> previousInBucket;
+  vector<SDL_Point> previousPositions;
+  vector<unsigned long long> moveStarts;
+  vector<unsigned long long> nextMoveTicks;
+  vector<EntityKind> kinds;
+  // Index into routePool, or -1 when not following a route. Pool entries
+  // are recycled through freeRoutes so their step buffers are kept.
+  vector<int> routes;
+  vector<Path> routePool;
+  vector<int> freeRoutes;
+
+  vector<int> bucketHeads;
+  int bucketMask;
+  mutable vector<int> queryBuckets;
+  vector<int> updateScratch;
+  vector<PathRequest> routeRequests;
+  vector<int> routeRequesters;
+  vector<Path> routeResults;
+};
@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include "frame_arena.h"
+
+using namespace std;
+
+FrameArena::FrameArena(size_t capacity)
+    : buffer((char *)malloc(capacity)), capacity(capacity)
+{
+}
+
+FrameArena::~FrameArena()
+{
+  free(buffer);
+}
+
+void *FrameArena::Allocate(size_t size, size_t alignment)
+{
+  size_t start = (used + alignment - 1) & ~(alignment - 1);
+  if (start + size > capacity)
+  {
+    failedCount++;
+    return NULL;
+  }
+  used = start;
+  Bump(size);
+  return buffer + start;
+}
+
+void FrameArena::Bump(size_t size)
+{
+  used += size;
+  highWater = max(highWater, used);
+}
+
+void FrameArena::Reset()
+{
+  used = 0;
+}
+
+size_t FrameArena::GetCapacity() const
+{
+  return capacity;
+}
+
+size_t FrameArena::GetHighWater() const
+{
+  return highWater;
+}
+
+int FrameArena::GetFailedCount() const
+{
+  return failedCount;
+}
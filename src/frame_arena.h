@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <string_view>
+#include <utility>
+
+using namespace std;
+
+// Memory for things that only live until the end of the frame, handed out
+// by bumping an offset into one block and taken back all at once by
+// Reset(), so a frame's transient text never touches the heap.
+class FrameArena
+{
+public:
+  FrameArena(size_t capacity);
+  ~FrameArena();
+
+  // NULL, and counted in GetFailedCount(), when the arena is full.
+  void *Allocate(size_t size, size_t alignment = alignof(max_align_t));
+
+  // Formats into the arena. Text that doesn't fit is cut short and counted
+  // as a failure.
+  template <typename... Args>
+  string_view Format(format_string<Args...> fmt, Args &&...args)
+  {
+    return Append(string_view(buffer + used, 0), fmt, forward<Args>(args)...);
+  }
+
+  // Formats onto the end of text, which must be the last thing formatted,
+  // and returns the whole of it.
+  template <typename... Args>
+  string_view Append(string_view text, format_string<Args...> fmt, Args &&...args)
+  {
+    char *out = buffer + used;
+    auto result = format_to_n(out, capacity - used, fmt, forward<Args>(args)...);
+    size_t length = result.out - out;
+    if ((size_t)result.size > length)
+    {
+      failedCount++;
+    }
+    Bump(length);
+    return string_view(text.data(), text.size() + length);
+  }
+
+  // Frees everything at once; nothing handed out before may be used after.
+  void Reset();
+
+  size_t GetCapacity() const;
+  // The most any frame has used so far.
+  size_t GetHighWater() const;
+  int GetFailedCount() const;
+
+private:
+  void Bump(size_t size);
+
+  char *buffer;
+  size_t capacity;
+  size_t used = 0;
+  size_t highWater = 0;
+  int failedCount = 0;
+};
+
+// Text stored inline with a fixed capacity, for short strings that change
+// every so often and outlive a frame, like battle messages. Text past the
+// capacity is cut off.
+template <size_t Capacity>
+class SmallString
+{
+public:
+  SmallString(string_view text = "")
+  {
+    *this = text;
+  }
+
+  SmallString &operator=(string_view text)
+  {
+    length = min(text.size(), Capacity);
+    text.copy(buffer, length);
+    return *this;
+  }
+
+  template <typename... Args>
+  void Format(format_string<Args...> fmt, Args &&...args)
+  {
+    length = format_to_n(buffer, Capacity, fmt, forward<Args>(args)...).out - buffer;
+  }
+
+  operator string_view() const
+  {
+    return string_view(buffer, length);
+  }
+
+private:
+  char buffer[Capacity];
+  size_t length;
+};
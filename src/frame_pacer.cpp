@@ -0,0 +1,155 @@
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <ctime>
+#include <SDL.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "frame_pacer.h"
+
+using namespace std;
+
+// Sleeps wake up late by up to a scheduler quantum, so stop sleeping this
+// long before the deadline and spin the rest of the way.
+const chrono::microseconds SPIN_MARGIN{1500};
+const chrono::seconds STATS_WINDOW{1};
+
+double ProcessCpuSeconds()
+{
+#ifdef _WIN32
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime);
+  auto toSeconds = [](FILETIME time)
+  {
+    return (((unsigned long long)time.dwHighDateTime << 32) | time.dwLowDateTime) * 100e-9;
+  };
+  return toSeconds(kernelTime) + toSeconds(userTime);
+#else
+  timespec cpuTime;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuTime);
+  return cpuTime.tv_sec + cpuTime.tv_nsec * 1e-9;
+#endif
+}
+
+PacingMode ParsePacingMode(const string &name, PacingMode fallback)
+{
+  if (name == "vsync")
+    return PacingMode::VSync;
+  if (name == "hybrid")
+    return PacingMode::Hybrid;
+  if (name == "uncapped")
+    return PacingMode::Uncapped;
+  printf("Unknown pacing mode %s, expected vsync, hybrid or uncapped\n", name.c_str());
+  return fallback;
+}
+
+const char *PacingModeName(PacingMode mode)
+{
+  switch (mode)
+  {
+  case PacingMode::VSync:
+    return "vsync";
+  case PacingMode::Hybrid:
+    return "hybrid";
+  case PacingMode::Uncapped:
+    return "uncapped";
+  }
+  return "unknown";
+}
+
+FramePacer::FramePacer(SDL_Renderer *renderer, PacingMode mode, double targetFps)
+    : renderer(renderer),
+      frameLength((long long)(1e9 / targetFps))
+{
+  nextFrameTime = lastPresentTime = windowStart = chrono::steady_clock::now();
+  windowStartCpuSeconds = ProcessCpuSeconds();
+  SetMode(mode);
+}
+
+void FramePacer::SetMode(PacingMode newMode)
+{
+  mode = newMode;
+  if (SDL_RenderSetVSync(renderer, mode == PacingMode::VSync) != 0 && mode == PacingMode::VSync)
+  {
+    printf("Unable to enable vsync, falling back to hybrid pacing! SDL Error: %s\n", SDL_GetError());
+    mode = PacingMode::Hybrid;
+  }
+  nextFrameTime = chrono::steady_clock::now();
+}
+
+PacingMode FramePacer::GetMode() const
+{
+  return mode;
+}
+
+void FramePacer::FramePresented()
+{
+  auto now = chrono::steady_clock::now();
+  double frameMs = chrono::duration<double, milli>(now - lastPresentTime).count();
+  lastPresentTime = now;
+
+  windowFrames++;
+  windowSumMs += frameMs;
+  windowSumSquaresMs += frameMs * frameMs;
+  windowWorstMs = max(windowWorstMs, frameMs);
+
+  if (now - windowStart >= STATS_WINDOW)
+  {
+    double wallSeconds = chrono::duration<double>(now - windowStart).count();
+    double cpuSeconds = ProcessCpuSeconds();
+    double mean = windowSumMs / windowFrames;
+    stats = {
+      frames : windowFrames,
+      averageFrameMs : mean,
+      jitterMs : sqrt(max(0.0, windowSumSquaresMs / windowFrames - mean * mean)),
+      worstFrameMs : windowWorstMs,
+      cpuPercent : (cpuSeconds - windowStartCpuSeconds) / wallSeconds * 100.0};
+    newStats = true;
+
+    windowStart = now;
+    windowStartCpuSeconds = cpuSeconds;
+    windowFrames = 0;
+    windowSumMs = windowSumSquaresMs = windowWorstMs = 0;
+  }
+}
+
+void FramePacer::WaitForNextFrame()
+{
+  if (mode != PacingMode::Hybrid)
+  {
+    return;
+  }
+
+  nextFrameTime += frameLength;
+  auto now = chrono::steady_clock::now();
+  if (nextFrameTime < now)
+  {
+    // Already late: start the next frame right away and don't try to make
+    // up for lost frames by running several short ones.
+    nextFrameTime = now;
+    return;
+  }
+
+  if (nextFrameTime - now > SPIN_MARGIN)
+  {
+    this_thread::sleep_for(nextFrameTime - now - SPIN_MARGIN);
+  }
+  while (chrono::steady_clock::now() < nextFrameTime)
+  {
+    this_thread::yield();
+  }
+}
+
+bool FramePacer::HasNewStats()
+{
+  bool hadNewStats = newStats;
+  newStats = false;
+  return hadNewStats;
+}
+
+FramePacerStats FramePacer::GetStats() const
+{
+  return stats;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <SDL.h>
+
+using namespace std;
+
+enum class PacingMode
+{
+  VSync,    // SDL_RenderPresent blocks on the display's refresh
+  Hybrid,   // sleep most of the frame, then spin for the last stretch
+  Uncapped, // no waiting at all, for benchmarking
+};
+
+struct FramePacerStats
+{
+  int frames;
+  double averageFrameMs;
+  double jitterMs;   // standard deviation of the frame time
+  double worstFrameMs;
+  double cpuPercent; // process CPU time over wall time, 100 = one full core
+};
+
+// Decides when the next frame starts so the main loop no longer spins a core
+// while waiting. Collects frame-time and CPU statistics over one second
+// windows so modes can be compared.
+class FramePacer
+{
+public:
+  FramePacer(SDL_Renderer *renderer, PacingMode mode, double targetFps);
+
+  void SetMode(PacingMode mode);
+  PacingMode GetMode() const;
+
+  // Call once per frame right after SDL_RenderPresent.
+  void FramePresented();
+  // Blocks until the next frame is due (only in Hybrid mode).
+  void WaitForNextFrame();
+
+  // True once per stats window, after which GetStats() holds the new window.
+  bool HasNewStats();
+  FramePacerStats GetStats() const;
+
+private:
+  SDL_Renderer *renderer;
+  PacingMode mode;
+  chrono::nanoseconds frameLength;
+  chrono::steady_clock::time_point nextFrameTime;
+  chrono::steady_clock::time_point lastPresentTime;
+
+  chrono::steady_clock::time_point windowStart;
+  double windowStartCpuSeconds;
+  int windowFrames = 0;
+  double windowSumMs = 0, windowSumSquaresMs = 0, windowWorstMs = 0;
+  bool newStats = false;
+  FramePacerStats stats = {};
+};
+
+PacingMode ParsePacingMode(const string &name, PacingMode fallback);
+const char *PacingModeName(PacingMode mode);
@@ -0,0 +1,100 @@
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "frame_pipeline.h"
+
+using namespace std;
+
+const chrono::seconds PIPELINE_STATS_WINDOW{1};
+
+FramePipeline::FramePipeline(function<void()> update)
+    : update(move(update))
+{
+  doneTime = windowStart = chrono::steady_clock::now();
+  updateThread = thread(&FramePipeline::UpdateLoop, this);
+}
+
+FramePipeline::~FramePipeline()
+{
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  frameStarted.notify_one();
+  updateThread.join();
+}
+
+void FramePipeline::Start()
+{
+  auto now = chrono::steady_clock::now();
+  {
+    lock_guard<mutex> guard(lock);
+    windowUpdateIdleMs += chrono::duration<double, milli>(now - doneTime).count();
+    started = true;
+    done = false;
+  }
+  frameStarted.notify_one();
+}
+
+void FramePipeline::Wait()
+{
+  auto waitStart = chrono::steady_clock::now();
+  {
+    unique_lock<mutex> guard(lock);
+    if (!done)
+    {
+      windowRenderWaits++;
+      frameDone.wait(guard, [this]
+                     { return done; });
+    }
+  }
+  auto now = chrono::steady_clock::now();
+  windowRenderWaitMs += chrono::duration<double, milli>(now - waitStart).count();
+  windowFrames++;
+
+  if (now - windowStart >= PIPELINE_STATS_WINDOW)
+  {
+    stats = {
+      frames : windowFrames,
+      renderWaits : windowRenderWaits,
+      averageRenderWaitMs : windowRenderWaitMs / windowFrames,
+      averageUpdateIdleMs : windowUpdateIdleMs / windowFrames};
+
+    windowStart = now;
+    windowFrames = windowRenderWaits = 0;
+    windowRenderWaitMs = windowUpdateIdleMs = 0;
+  }
+}
+
+FramePipelineStats FramePipeline::GetStats() const
+{
+  return stats;
+}
+
+void FramePipeline::UpdateLoop()
+{
+  while (true)
+  {
+    {
+      unique_lock<mutex> guard(lock);
+      frameStarted.wait(guard, [this]
+                        { return stopping || started; });
+      if (stopping)
+      {
+        return;
+      }
+      started = false;
+    }
+
+    update();
+
+    {
+      lock_guard<mutex> guard(lock);
+      done = true;
+      doneTime = chrono::steady_clock::now();
+    }
+    frameDone.notify_one();
+  }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+struct FramePipelineStats
+{
+  int frames;
+  int renderWaits;            // frames where the main thread had to wait for the update
+  double averageRenderWaitMs; // over all frames
+  double averageUpdateIdleMs; // time the update thread sat with nothing to do
+};
+
+// Runs the game's update for one frame at a time on its own thread, so it
+// overlaps whatever the main thread does between Start() and Wait(). The
+// update gets no frame until the last one is collected, so it is never more
+// than one frame ahead of what is on screen.
+//
+// Waits are collected over one second windows, like FramePacer's stats.
+class FramePipeline
+{
+public:
+  FramePipeline(function<void()> update);
+  ~FramePipeline();
+
+  // Hands the update thread the next frame.
+  void Start();
+  // Blocks until that frame's update is done.
+  void Wait();
+
+  // The last full stats window.
+  FramePipelineStats GetStats() const;
+
+private:
+  void UpdateLoop();
+
+  function<void()> update;
+  thread updateThread;
+  mutex lock;
+  condition_variable frameStarted;
+  condition_variable frameDone;
+  bool started = false;
+  bool done = true;
+  bool stopping = false;
+  chrono::steady_clock::time_point doneTime;
+
+  chrono::steady_clock::time_point windowStart;
+  int windowFrames = 0, windowRenderWaits = 0;
+  double windowRenderWaitMs = 0, windowUpdateIdleMs = 0;
+  FramePipelineStats stats = {};
+};
@@ -0,0 +1,818 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "constants.h"
+#include "atlas.h"
+#include "sprite_batch.h"
+#include "text_renderer.h"
+#include "world.h"
+#include "entities.h"
+#include "pathfinder.h"
+#include "tile_map_renderer.h"
+#include "gui.h"
+#include "battle_ui.h"
+#include "battle.h"
+#include "content.h"
+#include "animator.h"
+#include "rng.h"
+#include "profiler.h"
+#include "frame_arena.h"
+#include "save_state.h"
+#include "game.h"
+
+using namespace std;
+
+// How far to look for land when the middle of the world is at sea.
+const int START_SEARCH_CHUNKS = 64;
+
+int RevealedChars(int revealTicks)
+{
+  return (long long)revealTicks * TEXT_CHARS_PER_SECOND / TICKS_PER_SECOND;
+}
+
+// FNV-1a
+uint64_t HashBytes(uint64_t hash, const void *data, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    hash = (hash ^ ((const unsigned char *)data)[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+template <typename T>
+uint64_t HashValue(uint64_t hash, const T &value)
+{
+  return HashBytes(hash, &value, sizeof(value));
+}
+
+// Games start in the middle of the world, or if that is at sea, on the
+// nearest stretch of land.
+static SDL_Point GetStartPoint(const World *world)
+{
+  SDL_Point start = {x : world->GetWidth() / 2, y : world->GetHeight() / 2};
+  world->FindLand(&start.x, &start.y, START_SEARCH_CHUNKS);
+  return start;
+}
+
+// The nearest free land tile to the start point, searching outwards in
+// growing squares inside the chunks generated around it; the start point
+// itself if there is none.
+static SDL_Point FindStartTile(const World *world, const EntityTable *entities)
+{
+  SDL_Point middle = GetStartPoint(world);
+  for (int radius = 0; radius < WORLD_GENERATE_RADIUS * CHUNK_TILES; radius++)
+  {
+    for (int y = -radius; y <= radius; y++)
+    {
+      for (int x = -radius; x <= radius; x++)
+      {
+        SDL_Point tile = {x : middle.x + x, y : middle.y + y};
+        if (max(abs(x), abs(y)) == radius && TILE_MOVE_COSTS[world->Get(tile.x, tile.y)] > 0 &&
+            !entities->IsOccupied(tile.x, tile.y))
+        {
+          return tile;
+        }
+      }
+    }
+  }
+  return middle;
+}
+
+int RevealTicksFor(int chars)
+{
+  return ((long long)chars * TICKS_PER_SECOND + TEXT_CHARS_PER_SECOND - 1) / TEXT_CHARS_PER_SECOND;
+}
+
+Game::Game(SpriteBatch *batch, TextRenderer *textRenderer, Atlas *atlas, const Content *content, World *world,
+           TileMapRenderer *tileMapRenderer, EntityTable *entities, Pathfinder *pathfinder, uint64_t seed)
+    : batch(batch), textRenderer(textRenderer), content(content), world(world), tileMapRenderer(tileMapRenderer), entities(entities),
+      pathfinder(pathfinder), seed(seed), rng(seed, RNG_STREAM_BATTLE), entityRng(seed, RNG_STREAM_WANDER)
+{
+  characters = atlas->GetSheet("characters.png");
+  gui = atlas->GetSheet("gui.png");
+  battle = atlas->GetSheet("battle.png");
+  battleBGs = atlas->GetSheet("battleBGs.png");
+  enemies = atlas->GetSheet("enemies.png");
+  SetSheetColor(battle, 230, 230, 230);
+  formation = &content->GetFormation(0);
+  battleUi = new BattleUi(batch, atlas, &content->GetBattleLayout(), formation->background);
+  StartBattle(&battleState, content, *formation);
+
+  animator = new Animator(content);
+  const MapClips &mapClips = content->GetMapClips();
+  playerSprite = animator->Add(mapClips.playerStand[facing]);
+  for (int i = 0; i < formation->slotCount; i++)
+  {
+    const FormationSlot &slot = formation->slots[i];
+    battleSprites[i] = animator->Add(content->GetEnemyKind(slot.enemyKind).idleClip, slot.startFrame);
+  }
+  // Monsters start on different frames so a crowd doesn't bob in unison.
+  entitySprites.assign(entities->GetCount(), -1);
+  for (int entity = 0; entity < entities->GetCount(); entity++)
+  {
+    if (entities->GetKind(entity) == EntityKind::Monster)
+    {
+      entitySprites[entity] = animator->Add(mapClips.monster, entity);
+    }
+  }
+
+  bottomText = string("This is some text in a text box! Go forth, wizard, and cast spells! Huzzah! You will win!\n") +
+               string("Furthermore, you may even get to ponder an orb at some point!");
+
+  PrepareStartArea(world);
+  SDL_Point start = FindStartTile(world, entities);
+  playerPosX = start.x;
+  playerPosY = start.y;
+  world->UpdateResidency(playerPosX, playerPosY, facing);
+  UpdateCamera();
+  previousCameraX = cameraX;
+  previousCameraY = cameraY;
+}
+
+Game::~Game()
+{
+  delete animator;
+  delete battleUi;
+}
+
+SDL_Rect Game::PrepareStartArea(World *world)
+{
+  SDL_Rect worldArea = {x : 0, y : 0, w : world->GetWidth(), h : world->GetHeight()};
+  if (!world->IsGeneratedOnDemand())
+  {
+    return worldArea;
+  }
+  SDL_Point start = GetStartPoint(world);
+  world->UpdateResidency(start.x, start.y, DOWN);
+  int chunkX = start.x / CHUNK_TILES, chunkY = start.y / CHUNK_TILES;
+  SDL_Rect area = {x : (chunkX - WORLD_GENERATE_RADIUS) * CHUNK_TILES, y : (chunkY - WORLD_GENERATE_RADIUS) * CHUNK_TILES,
+                   w : (WORLD_GENERATE_RADIUS * 2 + 1) * CHUNK_TILES, h : (WORLD_GENERATE_RADIUS * 2 + 1) * CHUNK_TILES};
+  SDL_IntersectRect(&area, &worldArea, &area);
+  return area;
+}
+
+void Game::InvalidateRenderTargets()
+{
+  tileMapRenderer->InvalidateAll();
+  battleUi->InvalidateAll();
+}
+
+void Game::SetAudio(Audio *audio)
+{
+  this->audio = audio;
+}
+
+void Game::PlaySound(Sfx sfx)
+{
+  if (audio != NULL)
+  {
+    audio->Play(sfx);
+  }
+}
+
+uint64_t Game::GetStateHash() const
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  hash = HashValue(hash, tickCount);
+  hash = HashValue(hash, currentScreen);
+  hash = HashValue(hash, playerPosX);
+  hash = HashValue(hash, playerPosY);
+  hash = HashValue(hash, animator->GetClip(playerSprite));
+  hash = HashValue(hash, animator->GetFrame(playerSprite));
+  hash = HashValue(hash, isWalking);
+  hash = HashValue(hash, walkStart);
+  hash = HashValue(hash, walkDirection);
+  hash = HashValue(hash, facing);
+  hash = HashValue(hash, cameraX);
+  hash = HashValue(hash, cameraY);
+  hash = HashBytes(hash, autoWalk.waypoints.data(), autoWalk.waypoints.size() * sizeof(SDL_Point));
+  hash = HashValue(hash, autoWalk.leg);
+  hash = HashValue(hash, autoWalk.step);
+  hash = HashValue(hash, showText);
+  hash = HashValue(hash, textRevealTicks);
+  hash = HashValue(hash, battleRevealTicks);
+  hash = HashValue(hash, battleStep);
+  hash = HashValue(hash, battleAction);
+  hash = HashValue(hash, battleHighlightIndex);
+  hash = HashValue(hash, battleState.turns);
+  hash = HashBytes(hash, battleState.enemyHp, battleState.enemyCount * sizeof(int));
+  string_view text = actionText;
+  hash = HashBytes(hash, text.data(), text.size());
+  // The next roll stands in for the generator's state.
+  Rng nextRng = rng;
+  hash = HashValue(hash, nextRng.Next());
+  for (int entity = 0; entity < entities->GetCount(); entity++)
+  {
+    hash = HashValue(hash, entities->GetPosition(entity));
+  }
+  Rng nextEntityRng = entityRng;
+  hash = HashValue(hash, nextEntityRng.Next());
+  return hash;
+}
+
+void Game::SaveSnapshot(GameSnapshot *snapshot) const
+{
+  snapshot->entities.clear();
+  snapshot->routePoints.clear();
+  snapshot->chunks.clear();
+  snapshot->sprites.clear();
+  snapshot->chunkTiles.clear();
+
+  // The writer fills in the counts.
+  SaveFileHeader &header = snapshot->header;
+  header = {};
+  memcpy(header.magic, SAVE_FILE_MAGIC, sizeof(header.magic));
+  header.version = SAVE_FILE_VERSION;
+  header.seed = seed;
+  header.worldW = world->GetWidth();
+  header.worldH = world->GetHeight();
+  header.worldOnDemand = world->IsGeneratedOnDemand();
+
+  SaveGameState &state = snapshot->state;
+  state = {};
+  state.tickCount = tickCount;
+  state.walkStart = walkStart;
+  state.rngState = rng.GetState();
+  state.rngIncrement = rng.GetIncrement();
+  state.entityRngState = entityRng.GetState();
+  state.entityRngIncrement = entityRng.GetIncrement();
+  state.currentScreen = static_cast<int32_t>(currentScreen);
+  state.playerX = playerPosX;
+  state.playerY = playerPosY;
+  state.walkDirection = walkDirection;
+  state.facing = facing;
+  state.isWalking = isWalking;
+  state.showText = showText;
+  state.textRevealTicks = textRevealTicks;
+  state.autoWalk = autoWalk.Save(&snapshot->routePoints);
+  state.battleStep = static_cast<int32_t>(battleStep);
+  state.battleAction = static_cast<int32_t>(battleAction);
+  state.battleHighlightIndex = battleHighlightIndex;
+  state.battleRevealTicks = battleRevealTicks;
+  state.enemyCount = battleState.enemyCount;
+  state.turns = battleState.turns;
+  copy(begin(battleState.enemyHp), end(battleState.enemyHp), state.enemyHp);
+  copy(begin(battleState.enemyMaxHp), end(battleState.enemyMaxHp), state.enemyMaxHp);
+  string_view text = actionText;
+  state.actionTextLength = text.copy(state.actionText, sizeof(state.actionText));
+
+  entities->Snapshot(&snapshot->entities, &snapshot->routePoints);
+  world->SnapshotChunks(&snapshot->chunks, &snapshot->chunkTiles);
+  for (int sprite = 0; sprite < animator->GetCount(); sprite++)
+  {
+    snapshot->sprites.push_back({clip : animator->GetClip(sprite), frame : animator->GetFrame(sprite),
+                                 ticksLeft : animator->GetTicksLeft(sprite)});
+  }
+}
+
+bool Game::LoadSnapshot(const SaveFile *save)
+{
+  const SaveFileHeader &header = save->GetHeader();
+  const SaveGameState &state = save->GetState();
+  if (header.worldW != (uint32_t)world->GetWidth() || header.worldH != (uint32_t)world->GetHeight() ||
+      header.worldOnDemand != (uint32_t)world->IsGeneratedOnDemand())
+  {
+    printf("The save is from a %ux%u %s world, not this %dx%d %s one\n", header.worldW, header.worldH,
+           header.worldOnDemand ? "generated" : "file", world->GetWidth(), world->GetHeight(),
+           world->IsGeneratedOnDemand() ? "generated" : "file");
+    return false;
+  }
+  if (header.entityCount != (uint32_t)entities->GetCount())
+  {
+    printf("The save has %u entities, this game has %d (see --entities)\n", header.entityCount, entities->GetCount());
+    return false;
+  }
+  if (header.spriteCount != (uint32_t)animator->GetCount() || state.enemyCount != battleState.enemyCount)
+  {
+    printf("The save has %u animated sprites and %d enemies, the content makes %d and %d\n", header.spriteCount,
+           state.enemyCount, animator->GetCount(), battleState.enemyCount);
+    return false;
+  }
+  // Everything that indexes something is checked, so a damaged save can't
+  // send the game reading out of bounds later.
+  auto isDirection = [](int32_t direction)
+  { return direction >= LEFT && direction <= DOWN; };
+  if (state.currentScreen < 0 || state.currentScreen > static_cast<int32_t>(GameScreen::Battle) ||
+      !isDirection(state.walkDirection) || !isDirection(state.facing) ||
+      state.battleStep < 0 || state.battleStep > static_cast<int32_t>(BattleStep::Result) ||
+      state.battleAction < 0 || state.battleAction >= BATTLE_ACTION_COUNT ||
+      state.battleHighlightIndex < 0 ||
+      state.battleHighlightIndex >= state.enemyCount || state.actionTextLength > sizeof(state.actionText) ||
+      !IsValidSaveRoute(state.autoWalk) ||
+      (uint64_t)state.autoWalk.waypointCount + state.autoWalk.stepCount > header.routePointCount)
+  {
+    printf("The save's player or battle state is damaged\n");
+    return false;
+  }
+
+  const SDL_Point *routePoints = save->GetRoutePoints();
+  const SDL_Point *routePointsEnd = routePoints + header.routePointCount;
+  autoWalk.Load(state.autoWalk, &routePoints);
+  if (!entities->Restore(save->GetEntities(), header.entityCount, &routePoints, routePointsEnd))
+  {
+    printf("The save's entities are damaged or were spawned differently\n");
+    return false;
+  }
+  if (!world->RestoreChunks(save))
+  {
+    printf("The save's world chunks are damaged\n");
+    return false;
+  }
+  const SaveSprite *sprites = save->GetSprites();
+  for (uint32_t sprite = 0; sprite < header.spriteCount; sprite++)
+  {
+    if (!animator->Restore(sprite, sprites[sprite].clip, sprites[sprite].frame, sprites[sprite].ticksLeft))
+    {
+      printf("The save's sprite %u plays a frame the content doesn't have\n", sprite);
+      return false;
+    }
+  }
+
+  tickCount = state.tickCount;
+  walkStart = state.walkStart;
+  rng.Restore(state.rngState, state.rngIncrement);
+  entityRng.Restore(state.entityRngState, state.entityRngIncrement);
+  currentScreen = static_cast<GameScreen>(state.currentScreen);
+  playerPosX = state.playerX;
+  playerPosY = state.playerY;
+  walkDirection = static_cast<Direction>(state.walkDirection);
+  facing = static_cast<Direction>(state.facing);
+  isWalking = state.isWalking;
+  showText = state.showText;
+  textRevealTicks = state.textRevealTicks;
+  battleStep = static_cast<BattleStep>(state.battleStep);
+  battleAction = static_cast<BattleAction>(state.battleAction);
+  battleHighlightIndex = state.battleHighlightIndex;
+  battleRevealTicks = state.battleRevealTicks;
+  battleState.turns = state.turns;
+  copy(state.enemyHp, state.enemyHp + MAX_BATTLE_ENEMIES, battleState.enemyHp);
+  copy(state.enemyMaxHp, state.enemyMaxHp + MAX_BATTLE_ENEMIES, battleState.enemyMaxHp);
+  actionText = string_view(state.actionText, state.actionTextLength);
+
+  world->UpdateResidency(playerPosX, playerPosY, walkDirection);
+  UpdateCamera();
+  previousCameraX = cameraX;
+  previousCameraY = cameraY;
+  return true;
+}
+
+void Game::Tick(const InputState &input)
+{
+  previousCameraX = cameraX;
+  previousCameraY = cameraY;
+
+  if (isWalking && tickCount >= walkStart + WALK_TICKS)
+  {
+    isWalking = false;
+    switch (walkDirection)
+    {
+    case LEFT:
+      playerPosX--;
+      break;
+    case RIGHT:
+      playerPosX++;
+      break;
+    case UP:
+      playerPosY--;
+      break;
+    case DOWN:
+      playerPosY++;
+      break;
+    }
+    world->UpdateResidency(playerPosX, playerPosY, walkDirection);
+  }
+
+  if (input.pressed[SDL_SCANCODE_B])
+  {
+    if (currentScreen == GameScreen::Battle)
+    {
+      currentScreen = GameScreen::Map;
+    }
+    else
+    {
+      currentScreen = GameScreen::Battle;
+    }
+  }
+
+  switch (currentScreen)
+  {
+  case GameScreen::Map:
+  {
+    PROFILE_ZONE("TickMap");
+    TickMap(input);
+    break;
+  }
+  case GameScreen::Battle:
+  {
+    PROFILE_ZONE("TickBattle");
+    TickBattle(input);
+    break;
+  }
+  }
+
+  {
+    PROFILE_ZONE("Animate");
+    animator->Tick();
+  }
+
+  tickCount++;
+  UpdateCamera();
+}
+
+void Game::TickMap(const InputState &input)
+{
+  if (input.click != NULL)
+  {
+    // Routes start where the current step ends.
+    SDL_Point tile = {x : (int)floor((input.click->x + cameraX) / TILE_W),
+                      y : (int)floor((input.click->y + cameraY) / TILE_H)};
+    pathfinder->FindPath(GetWalkTarget(), tile, &autoWalk);
+  }
+
+  if (!isWalking)
+  {
+    SDL_Point step;
+    if (input.held[SDL_SCANCODE_LEFT] || input.held[SDL_SCANCODE_RIGHT] ||
+        input.held[SDL_SCANCODE_UP] || input.held[SDL_SCANCODE_DOWN])
+    {
+      autoWalk.Clear();
+    }
+    else if (!autoWalk.IsEmpty() && !pathfinder->NextStep(&autoWalk, &step))
+    {
+      autoWalk.Clear();
+    }
+
+    if (input.held[SDL_SCANCODE_LEFT])
+    {
+      isWalking = true;
+      walkStart = tickCount;
+      walkDirection = LEFT;
+      facing = LEFT;
+    }
+    else if (input.held[SDL_SCANCODE_RIGHT])
+    {
+      isWalking = true;
+      walkStart = tickCount;
+      walkDirection = RIGHT;
+      facing = RIGHT;
+    }
+    else if (input.held[SDL_SCANCODE_UP])
+    {
+      isWalking = true;
+      walkStart = tickCount;
+      walkDirection = UP;
+      facing = UP;
+    }
+    else if (input.held[SDL_SCANCODE_DOWN])
+    {
+      isWalking = true;
+      walkStart = tickCount;
+      walkDirection = DOWN;
+      facing = DOWN;
+    }
+    else if (!autoWalk.IsEmpty())
+    {
+      isWalking = true;
+      walkStart = tickCount;
+      walkDirection = step.x < playerPosX ? LEFT : step.x > playerPosX ? RIGHT
+                                                : step.y < playerPosY ? UP
+                                                                      : DOWN;
+      facing = walkDirection;
+    }
+  }
+
+  // Bumping into an entity or a tile that cannot be entered turns the
+  // player without moving, and gives up on a clicked route.
+  if (isWalking && walkStart == tickCount)
+  {
+    SDL_Point target = GetWalkTarget();
+    if (entities->IsOccupied(target.x, target.y) || TILE_MOVE_COSTS[world->Get(target.x, target.y)] == 0)
+    {
+      isWalking = false;
+      autoWalk.Clear();
+    }
+  }
+
+  {
+    PROFILE_ZONE("UpdateEntities");
+    SDL_Point target = GetWalkTarget();
+    SDL_Rect blocked = {x : min(playerPosX, target.x), y : min(playerPosY, target.y),
+                        w : abs(target.x - playerPosX) + 1, h : abs(target.y - playerPosY) + 1};
+    entities->Update(world, pathfinder, GetViewTiles(ENTITY_UPDATE_MARGIN), blocked, tickCount, &entityRng);
+  }
+
+  if (input.pressed[SDL_SCANCODE_Z])
+  {
+    if (!showText)
+    {
+      showText = true;
+      textRevealTicks = 0;
+    }
+    else if (RevealedChars(textRevealTicks) < (int)bottomText.length())
+    {
+      textRevealTicks = RevealTicksFor(bottomText.length());
+    }
+    else
+    {
+      showText = false;
+    }
+  }
+
+  if (input.pressed[SDL_SCANCODE_R])
+  {
+    textRevealTicks = 0;
+  }
+
+  if (showText)
+  {
+    textRevealTicks++;
+  }
+
+  // Turning mid-walk keeps the stride going instead of restarting it.
+  const MapClips &mapClips = content->GetMapClips();
+  if (isWalking)
+  {
+    int clip = animator->GetClip(playerSprite);
+    bool wasWalking = find(begin(mapClips.playerWalk), end(mapClips.playerWalk), clip) != end(mapClips.playerWalk);
+    animator->Play(playerSprite, mapClips.playerWalk[walkDirection], wasWalking);
+  }
+  else
+  {
+    animator->Play(playerSprite, mapClips.playerStand[facing]);
+  }
+}
+
+void Game::TickBattle(const InputState &input)
+{
+  if (input.pressed[SDL_SCANCODE_UP] || input.pressed[SDL_SCANCODE_RIGHT])
+  {
+    if (battleStep == BattleStep::Action)
+    {
+      int newAction = static_cast<int>(battleAction) - 1;
+      if (newAction < 0)
+        newAction += 4;
+      battleAction = static_cast<BattleAction>(newAction);
+      PlaySound(Sfx::MenuMove);
+    }
+    else if (battleStep == BattleStep::Target)
+    {
+      battleHighlightIndex--;
+      battleHighlightIndex = (battleHighlightIndex + battleState.enemyCount) % battleState.enemyCount;
+      PlaySound(Sfx::MenuMove);
+    }
+  }
+  if (input.pressed[SDL_SCANCODE_DOWN] || input.pressed[SDL_SCANCODE_LEFT])
+  {
+    if (battleStep == BattleStep::Action)
+    {
+      int newAction = static_cast<int>(battleAction) + 1;
+      if (newAction >= 4)
+        newAction -= 4;
+      battleAction = static_cast<BattleAction>(newAction);
+      PlaySound(Sfx::MenuMove);
+    }
+    else if (battleStep == BattleStep::Target)
+    {
+      battleHighlightIndex++;
+      battleHighlightIndex %= battleState.enemyCount;
+      PlaySound(Sfx::MenuMove);
+    }
+  }
+  if (input.pressed[SDL_SCANCODE_Z])
+  {
+    battleRevealTicks = 0;
+    switch (battleStep)
+    {
+    case BattleStep::Action:
+    {
+      if (IsBattleWon(&battleState))
+      {
+        currentScreen = GameScreen::Map;
+        break;
+      }
+
+      switch (battleAction)
+      {
+      case BattleAction::Attack:
+      case BattleAction::Magic:
+      {
+        actionText = "Select a target";
+        battleStep = BattleStep::Target;
+        break;
+      }
+      case BattleAction::Item:
+      {
+        BattleResult result = PerformAction(&battleState, BattleAction::Item, 0, &rng);
+        actionText.Format("Used an item!\n\nHealed {} health!", result.amount);
+        battleStep = BattleStep::Result;
+        break;
+      }
+      case BattleAction::Run:
+      {
+        PerformAction(&battleState, BattleAction::Run, 0, &rng);
+        actionText = "Attempted to run away!";
+        battleStep = BattleStep::Result;
+        break;
+      }
+      }
+      break;
+    }
+    case BattleStep::Target:
+    {
+      BattleResult result = PerformAction(&battleState, battleAction, battleHighlightIndex, &rng);
+      int hpLeft = battleState.enemyHp[battleHighlightIndex];
+      PlaySound(battleAction == BattleAction::Attack ? Sfx::Attack : Sfx::Magic);
+      if (battleAction == BattleAction::Attack)
+      {
+        actionText.Format("Swung with staff!\n\nDid {} damage!\n\nEnemy has {} health left.", result.amount, hpLeft);
+      }
+      else
+      {
+        actionText.Format("Cast a mighty spell!\n\nDid {} damage!\n\nEnemy has {} health left.", result.amount, hpLeft);
+      }
+      battleStep = BattleStep::Result;
+      break;
+    }
+    case BattleStep::Result:
+    {
+      if (IsBattleWon(&battleState))
+      {
+        actionText = "You win!";
+      }
+      else
+      {
+        actionText = "What would you like to do?";
+      }
+
+      battleStep = BattleStep::Action;
+      break;
+    }
+    }
+  }
+
+  battleRevealTicks++;
+}
+
+double Game::GetWalkPercentDone() const
+{
+  if (!isWalking)
+  {
+    return 0;
+  }
+  return min(1.0, (double)(tickCount - walkStart) / (double)WALK_TICKS);
+}
+
+SDL_Point Game::GetWalkTarget() const
+{
+  SDL_Point target = {x : playerPosX, y : playerPosY};
+  if (isWalking)
+  {
+    switch (walkDirection)
+    {
+    case LEFT:
+      target.x--;
+      break;
+    case RIGHT:
+      target.x++;
+      break;
+    case UP:
+      target.y--;
+      break;
+    case DOWN:
+      target.y++;
+      break;
+    }
+  }
+  return target;
+}
+
+SDL_Rect Game::GetViewTiles(int margin) const
+{
+  return {x : playerPosX - TILES_L - margin, y : playerPosY - TILES_U - margin,
+          w : TILES_L + TILES_R + 1 + margin * 2, h : TILES_U + TILES_D + 1 + margin * 2};
+}
+
+void Game::UpdateCamera()
+{
+  cameraX = playerPosX * TILE_W - playerPosition.x;
+  cameraY = playerPosY * TILE_H - playerPosition.y;
+  if (isWalking)
+  {
+    double walkPercentDone = GetWalkPercentDone();
+    switch (walkDirection)
+    {
+    case LEFT:
+      cameraX -= TILE_W * walkPercentDone;
+      break;
+    case RIGHT:
+      cameraX += TILE_W * walkPercentDone;
+      break;
+    case UP:
+      cameraY -= TILE_H * walkPercentDone;
+      break;
+    case DOWN:
+      cameraY += TILE_H * walkPercentDone;
+      break;
+    }
+  }
+}
+
+void Game::Render(double alpha)
+{
+  switch (currentScreen)
+  {
+  case GameScreen::Map:
+  {
+    PROFILE_ZONE("RenderMap");
+    RenderMap(alpha);
+    break;
+  }
+  case GameScreen::Battle:
+  {
+    PROFILE_ZONE("RenderBattle");
+    RenderBattle();
+    break;
+  }
+  }
+}
+
+void Game::RenderMap(double alpha)
+{
+  int renderCameraX = (int)floor(previousCameraX + (cameraX - previousCameraX) * alpha);
+  int renderCameraY = (int)floor(previousCameraY + (cameraY - previousCameraY) * alpha);
+  tileMapRenderer->Draw(renderCameraX, renderCameraY);
+
+  {
+    PROFILE_ZONE("DrawEntities");
+    visibleEntities.clear();
+    entities->Query(GetViewTiles(0), &visibleEntities);
+    // Lower entities overlap the ones above them.
+    sort(visibleEntities.begin(), visibleEntities.end(), [this](int a, int b)
+         { return entities->GetPosition(a).y < entities->GetPosition(b).y; });
+
+    const MapClips &mapClips = content->GetMapClips();
+    const SDL_Rect *frameRects = content->GetAnimFrameRects();
+    double time = (double)tickCount - 1 + alpha;
+    for (int entity : visibleEntities)
+    {
+      SpriteSheet *sheet = entities->GetKind(entity) == EntityKind::Npc ? characters : enemies;
+      const SDL_Rect *sprite;
+      if (entity < (int)entitySprites.size() && entitySprites[entity] >= 0)
+      {
+        sprite = &animator->GetRect(entitySprites[entity]);
+      }
+      else
+      {
+        int clip = entities->GetKind(entity) == EntityKind::Npc ? mapClips.villager : mapClips.object;
+        sprite = &frameRects[content->GetAnimClip(clip).firstFrame];
+      }
+      // Sprites stand on the bottom middle of their tile.
+      SDL_Point position = entities->GetPixelPosition(entity, time);
+      SDL_Rect dstRect = {x : position.x - renderCameraX + (TILE_W - sprite->w) / 2,
+                          y : position.y - renderCameraY + TILE_H - sprite->h, w : sprite->w, h : sprite->h};
+      batch->Draw(sheet, sprite, &dstRect);
+    }
+  }
+
+  SDL_RendererFlip flip = facing == RIGHT ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE;
+  batch->Draw(characters, &animator->GetRect(playerSprite), &playerPosition, flip);
+
+  textRenderer->SetTextColor(230, 230, 230);
+  SDL_Rect guiRect = {x : 20, y : 130, w : 280, h : 40};
+
+  if (showText)
+  {
+    DrawTextBox(textRenderer, bottomText, batch, gui, &guiRect, 75, 75, 105, RevealedChars(textRevealTicks));
+  }
+}
+
+void Game::RenderBattle()
+{
+  battleUi->DrawStatic();
+
+  const BattleLayout &layout = content->GetBattleLayout();
+  const SDL_Rect &label = layout.actionLabelPositions[static_cast<int>(battleAction)];
+  SDL_Rect guiRect = {x : label.x + layout.selectOffset.x, y : label.y + layout.selectOffset.y, w : layout.select.w,
+                      h : layout.select.h};
+  batch->Draw(battle, &layout.select, &guiRect);
+
+  textRenderer->SetTextColor(230, 230, 230);
+  textRenderer->DrawTextWrapped(actionText, &layout.descriptionBox, RevealedChars(battleRevealTicks));
+
+  for (int i = 0; i < formation->slotCount; i++)
+  {
+    if (battleState.enemyHp[i] > 0)
+    {
+      batch->Draw(enemies, &animator->GetRect(battleSprites[i]), &formation->slots[i].position);
+    }
+  }
+
+  if (battleStep == BattleStep::Target)
+  {
+    HighlightSlot(batch, battle, layout.highlightCorners, &formation->slots[battleHighlightIndex].position);
+  }
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "constants.h"
+#include "atlas.h"
+#include "sprite_batch.h"
+#include "text_renderer.h"
+#include "world.h"
+#include "entities.h"
+#include "pathfinder.h"
+#include "tile_map_renderer.h"
+#include "battle_ui.h"
+#include "battle.h"
+#include "content.h"
+#include "animator.h"
+#include "rng.h"
+#include "audio.h"
+#include "frame_arena.h"
+#include "save_state.h"
+
+using namespace std;
+
+enum class GameScreen
+{
+  Map,
+  Battle
+};
+
+enum class BattleStep
+{
+  Action,
+  Target,
+  Result
+};
+
+// Input for one simulation tick. Keys are indexed by SDL_Scancode.
+struct InputState
+{
+  const Uint8 *held;       // keys down at the time of the tick
+  const Uint8 *pressed;    // keys that went down since the previous tick
+  const SDL_Point *click;  // last left click since the previous tick, in game pixels; NULL if none
+};
+
+// The game simulation and how to draw it. Tick() advances the world by one
+// fixed step of 1 / TICKS_PER_SECOND; Render() can be called any number of
+// times in between and blends the last two ticks by alpha, so the simulation
+// speed no longer depends on the frame rate.
+class Game
+{
+public:
+  // Battle rolls and wandering come from their own streams of seed, so the
+  // same seed, entities and input ticks always play out the same way.
+  // pathfinder must be built over world.
+  Game(SpriteBatch *batch, TextRenderer *textRenderer, Atlas *atlas, const Content *content, World *world,
+       TileMapRenderer *tileMapRenderer, EntityTable *entities, Pathfinder *pathfinder, uint64_t seed);
+  ~Game();
+
+  // Makes sure the tiles around where a game on world starts exist, and
+  // returns the area to spawn entities in: those tiles for a world generated
+  // on demand, otherwise all of it. Games start near the middle of the
+  // world, on the nearest land.
+  static SDL_Rect PrepareStartArea(World *world);
+
+  void Tick(const InputState &input);
+  // alpha in [0, 1] is how far real time has moved past the last tick.
+  void Render(double alpha);
+
+  // Hash of everything Tick() reads or writes, to check that a replay
+  // reproduced a session exactly.
+  uint64_t GetStateHash() const;
+
+  // Cached render-target textures are rebaked on next use. Needed after
+  // SDL_RENDER_TARGETS_RESET, when the renderer drops target contents.
+  void InvalidateRenderTargets();
+
+  // Copies everything a save needs into snapshot, reusing its memory. Only
+  // between ticks; it takes a fraction of a millisecond.
+  void SaveSnapshot(GameSnapshot *snapshot) const;
+  // Picks the game up where save left off. The game has to be new, made
+  // with the save's seed over a world and entities made the same way.
+  // False, saying why, if the save doesn't fit, after which the game is
+  // only fit to be deleted.
+  bool LoadSnapshot(const SaveFile *save);
+
+  // Sound effects are optional and have no effect on the simulation, so
+  // headless runs like the benchmark just leave this unset.
+  void SetAudio(Audio *audio);
+
+private:
+  void TickMap(const InputState &input);
+  void TickBattle(const InputState &input);
+  void RenderMap(double alpha);
+  void RenderBattle();
+  double GetWalkPercentDone() const;
+  SDL_Point GetWalkTarget() const;
+  // The tiles around the player, plus margin on every side.
+  SDL_Rect GetViewTiles(int margin) const;
+  void UpdateCamera();
+  void PlaySound(Sfx sfx);
+
+  SpriteBatch *batch;
+  TextRenderer *textRenderer;
+  const Content *content;
+  World *world;
+  TileMapRenderer *tileMapRenderer;
+  EntityTable *entities;
+  Pathfinder *pathfinder;
+  BattleUi *battleUi;
+  // Every animated sprite on both screens, stepped once per tick.
+  Animator *animator;
+  Audio *audio = NULL;
+
+  SpriteSheet *characters;
+  SpriteSheet *gui;
+  SpriteSheet *battle;
+  SpriteSheet *battleBGs;
+  SpriteSheet *enemies;
+
+  uint64_t seed;
+  unsigned long long tickCount = 0;
+  Rng rng;
+  Rng entityRng;
+  GameScreen currentScreen = GameScreen::Battle;
+
+  // Map
+  SDL_Rect playerPosition = {x : PLAYER_X, y : PLAYER_Y, w : TILE_W, h : TILE_H};
+  int playerPosX, playerPosY;
+  int playerSprite;
+  bool isWalking = false;
+  unsigned long long walkStart = 0;
+  Direction walkDirection = DOWN;
+  Direction facing = DOWN;
+  // World pixel at the top left of the screen after the last two ticks.
+  double previousCameraX, previousCameraY;
+  double cameraX, cameraY;
+  // Where a click sent the player; empty when walking with the keys.
+  Path autoWalk;
+
+  // Animator sprite of each entity, or -1 for those that hold still on
+  // their clip's first frame.
+  vector<int> entitySprites;
+  // Reused every frame for the entities on screen.
+  vector<int> visibleEntities;
+
+  bool showText = false;
+  int textRevealTicks = 0;
+  string bottomText;
+
+  // Battle
+  const Formation *formation;
+  int battleSprites[MAX_BATTLE_ENEMIES];
+  int battleRevealTicks = 0;
+  BattleStep battleStep = BattleStep::Action;
+  BattleAction battleAction = BattleAction::Attack;
+  int battleHighlightIndex = 0;
+  BattleState battleState;
+  SmallString<ACTION_TEXT_CAPACITY> actionText{"What would you like to do?"};
+};
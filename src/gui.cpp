@@ -0,0 +1,105 @@
+#include <string>
+#include <string_view>
+#include <SDL.h>
+#include "atlas.h"
+#include "sprite_batch.h"
+#include "text_renderer.h"
+#include "gui.h"
+
+using namespace std;
+
+SDL_Rect borderVertical = {x : 0, y : GUI_Y, w : 5, h : 1};
+SDL_Rect borderHorizontal = {x : 8, y : GUI_Y, w : 1, h : 5};
+SDL_Rect cornerTL = {x : 16, y : GUI_Y, w : 5, h : 5};
+SDL_Rect cornerTR = {x : 24, y : GUI_Y, w : 5, h : 5};
+SDL_Rect cornerBR = {x : 32, y : GUI_Y, w : 5, h : 5};
+SDL_Rect cornerBL = {x : 40, y : GUI_Y, w : 5, h : 5};
+SDL_Rect junctionR = {x : 48, y : GUI_Y, w : 5, h : 5};
+SDL_Rect junctionB = {x : 56, y : GUI_Y, w : 5, h : 5};
+SDL_Rect junctionL = {x : 64, y : GUI_Y, w : 5, h : 5};
+SDL_Rect junctionT = {x : 72, y : GUI_Y, w : 5, h : 5};
+SDL_Rect guiFill = {x : 80, y : GUI_Y, w : 1, h : 1};
+
+void DrawGuiLineH(SpriteBatch *batch, SpriteSheet *gui, SDL_Rect *lineRect, SDL_Rect *endpointL, SDL_Rect *endpointR)
+{
+  SetSheetColor(gui, 255, 255, 255);
+  SDL_Rect guiRect;
+  int marginX = (endpointL != NULL) * GUI_BORDER_W;
+  int marginW = (endpointR != NULL) * GUI_BORDER_W + marginX;
+  guiRect = {x : lineRect->x + marginX, y : lineRect->y, w : lineRect->w - marginW, h : GUI_BORDER_H};
+  batch->Draw(gui, &borderHorizontal, &guiRect);
+
+  if (endpointL != NULL)
+  {
+    guiRect = {x : lineRect->x, y : lineRect->y, w : GUI_BORDER_W, h : GUI_BORDER_H};
+    batch->Draw(gui, endpointL, &guiRect);
+  }
+  if (endpointR != NULL)
+  {
+    guiRect = {x : lineRect->x + lineRect->w - GUI_BORDER_W, y : lineRect->y, w : GUI_BORDER_W, h : GUI_BORDER_H};
+    batch->Draw(gui, endpointR, &guiRect);
+  }
+}
+
+void DrawGuiLineV(SpriteBatch *batch, SpriteSheet *gui, SDL_Rect *lineRect, SDL_Rect *endpointT, SDL_Rect *endpointB)
+{
+  SetSheetColor(gui, 255, 255, 255);
+  SDL_Rect guiRect;
+  int marginY = (endpointT != NULL) * GUI_BORDER_W;
+  int marginH = (endpointB != NULL) * GUI_BORDER_W + marginY;
+  guiRect = {x : lineRect->x, y : lineRect->y + marginY, w : GUI_BORDER_W, h : lineRect->h - marginH};
+  batch->Draw(gui, &borderVertical, &guiRect);
+
+  if (endpointT != NULL)
+  {
+    guiRect = {x : lineRect->x, y : lineRect->y, w : GUI_BORDER_W, h : GUI_BORDER_H};
+    batch->Draw(gui, endpointT, &guiRect);
+  }
+  if (endpointB != NULL)
+  {
+    guiRect = {x : lineRect->x, y : lineRect->y + lineRect->h - GUI_BORDER_H, w : GUI_BORDER_W, h : GUI_BORDER_H};
+    batch->Draw(gui, endpointB, &guiRect);
+  }
+}
+
+void DrawGuiBox(SpriteBatch *batch, SpriteSheet *gui, SDL_Rect *boxRect, bool fill, int r, int g, int b)
+{
+  SetSheetColor(gui, 255, 255, 255);
+  SDL_Rect guiRect;
+  guiRect = {x : boxRect->x + GUI_BORDER_W, y : boxRect->y, w : boxRect->w - GUI_BORDER_W * 2, h : GUI_BORDER_H};
+  DrawGuiLineH(batch, gui, &guiRect);
+  guiRect = {x : boxRect->x + GUI_BORDER_W, y : boxRect->y + boxRect->h - GUI_BORDER_H, w : boxRect->w - GUI_BORDER_W * 2, h : GUI_BORDER_H};
+  DrawGuiLineH(batch, gui, &guiRect);
+
+  guiRect = {x : boxRect->x, y : boxRect->y, w : GUI_BORDER_W, h : boxRect->h};
+  DrawGuiLineV(batch, gui, &guiRect, &cornerTL, &cornerBL);
+  guiRect = {x : boxRect->x + boxRect->w - GUI_BORDER_W, y : boxRect->y, w : GUI_BORDER_W, h : boxRect->h};
+  DrawGuiLineV(batch, gui, &guiRect, &cornerTR, &cornerBR);
+
+  if (fill)
+  {
+    SetSheetColor(gui, r, g, b);
+    guiRect = {x : boxRect->x + GUI_BORDER_W, y : boxRect->y + GUI_BORDER_H, w : boxRect->w - GUI_BORDER_W * 2, h : boxRect->h - GUI_BORDER_H * 2};
+    batch->Draw(gui, &guiFill, &guiRect);
+  }
+}
+
+void DrawTextBox(TextRenderer *textRenderer, string_view text, SpriteBatch *batch, SpriteSheet *gui, SDL_Rect *textArea, int r, int g, int b, int charsToRender)
+{
+  SDL_Rect borderRect = {x : textArea->x - GUI_BORDER_W - 1, y : textArea->y - GUI_BORDER_H - 1, w : textArea->w + GUI_BORDER_W * 2 + 2, h : textArea->h + GUI_BORDER_H * 2 + 2};
+  DrawGuiBox(batch, gui, &borderRect, true, r, g, b);
+  textRenderer->DrawTextWrapped(text, textArea, charsToRender);
+}
+
+SDL_Rect highlightRect;
+void HighlightSlot(SpriteBatch *batch, SpriteSheet *battle, const SDL_Rect *corners, const SDL_Rect *slotRect)
+{
+  highlightRect = {x : slotRect->x - 1, y : slotRect->y - 1, w : 3, h : 3};
+  batch->Draw(battle, &corners[0], &highlightRect);
+  highlightRect = {x : slotRect->x + slotRect->w + 1 - 3, y : slotRect->y - 1, w : 3, h : 3};
+  batch->Draw(battle, &corners[1], &highlightRect);
+  highlightRect = {x : slotRect->x - 1, y : slotRect->y + slotRect->h + 1 - 3, w : 3, h : 3};
+  batch->Draw(battle, &corners[3], &highlightRect);
+  highlightRect = {x : slotRect->x + slotRect->w + 1 - 3, y : slotRect->y + slotRect->h + 1 - 3, w : 3, h : 3};
+  batch->Draw(battle, &corners[2], &highlightRect);
+}
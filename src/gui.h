@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <SDL.h>
+#include "atlas.h"
+#include "sprite_batch.h"
+#include "text_renderer.h"
+
+using namespace std;
+
+// gui.png
+const int GUI_Y = 24;
+extern SDL_Rect borderVertical;
+extern SDL_Rect borderHorizontal;
+extern SDL_Rect cornerTL;
+extern SDL_Rect cornerTR;
+extern SDL_Rect cornerBR;
+extern SDL_Rect cornerBL;
+extern SDL_Rect junctionR;
+extern SDL_Rect junctionB;
+extern SDL_Rect junctionL;
+extern SDL_Rect junctionT;
+extern SDL_Rect guiFill;
+const int GUI_BORDER_W = 5, GUI_BORDER_H = 5;
+
+void DrawGuiLineH(SpriteBatch *batch, SpriteSheet *gui, SDL_Rect *lineRect, SDL_Rect *endpointL = NULL, SDL_Rect *endpointR = NULL);
+void DrawGuiLineV(SpriteBatch *batch, SpriteSheet *gui, SDL_Rect *lineRect, SDL_Rect *endpointT = NULL, SDL_Rect *endpointB = NULL);
+void DrawGuiBox(SpriteBatch *batch, SpriteSheet *gui, SDL_Rect *boxRect, bool fill = true, int r = 0, int g = 0, int b = 0);
+void DrawTextBox(TextRenderer *textRenderer, string_view text, SpriteBatch *batch, SpriteSheet *gui, SDL_Rect *textArea, int r = 0, int g = 0, int b = 0, int charsToRender = -1);
+// corners are the four battle.png sprites from the top left, clockwise.
+void HighlightSlot(SpriteBatch *batch, SpriteSheet *battle, const SDL_Rect *corners, const SDL_Rect *slotRect);
@@ -0,0 +1,224 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "game.h"
+#include "input_log.h"
+
+using namespace std;
+
+InputRecorder *InputRecorder::Create(const string &path, uint64_t seed)
+{
+  FILE *file = fopen(path.c_str(), "wb");
+  if (file == NULL)
+  {
+    printf("Unable to create input log %s\n", path.c_str());
+    return NULL;
+  }
+
+  InputLogHeader header = {};
+  memcpy(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic));
+  header.version = INPUT_LOG_VERSION;
+  header.seed = seed;
+  header.keyCount = SDL_NUM_SCANCODES;
+  fwrite(&header, sizeof(header), 1, file);
+  return new InputRecorder(file);
+}
+
+InputRecorder::InputRecorder(FILE *file) : file(file)
+{
+}
+
+InputRecorder::~InputRecorder()
+{
+  if (file != NULL)
+  {
+    fclose(file);
+  }
+}
+
+void InputRecorder::RecordTick(const InputState &input)
+{
+  for (int scancode = 0; scancode < SDL_NUM_SCANCODES; scancode++)
+  {
+    if (input.held[scancode] != held[scancode])
+    {
+      held[scancode] = input.held[scancode];
+      WriteEvent(tick, scancode << 2 | (held[scancode] ? INPUT_KEY_DOWN : INPUT_KEY_UP));
+    }
+    if (input.pressed[scancode])
+    {
+      WriteEvent(tick, scancode << 2 | INPUT_KEY_PRESS);
+    }
+  }
+  if (input.click != NULL)
+  {
+    WriteEvent(tick, INPUT_CLICK_CODE << 2 | INPUT_KEY_PRESS);
+    WriteVarint(input.click->x);
+    WriteVarint(input.click->y);
+  }
+  tick++;
+}
+
+void InputRecorder::Finish(uint64_t stateHash)
+{
+  if (file == NULL)
+  {
+    return;
+  }
+  WriteEvent(tick, INPUT_END);
+  fwrite(&stateHash, sizeof(stateHash), 1, file);
+  fclose(file);
+  file = NULL;
+}
+
+void InputRecorder::WriteEvent(unsigned long long eventTick, unsigned int code)
+{
+  WriteVarint(eventTick - lastEventTick);
+  WriteVarint(code);
+  lastEventTick = eventTick;
+}
+
+void InputRecorder::WriteVarint(unsigned long long value)
+{
+  while (value >= 0x80)
+  {
+    fputc((int)(value & 0x7f) | 0x80, file);
+    value >>= 7;
+  }
+  fputc((int)value, file);
+}
+
+static bool ReadVarint(const vector<char> &data, size_t *position, unsigned long long *value)
+{
+  *value = 0;
+  for (int shift = 0; shift < 64 && *position < data.size(); shift += 7)
+  {
+    unsigned char byte = data[(*position)++];
+    *value |= (unsigned long long)(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+InputPlayer *InputPlayer::Open(const string &path)
+{
+  ifstream in(path, ios::binary);
+  if (!in)
+  {
+    printf("Unable to open input log %s\n", path.c_str());
+    return NULL;
+  }
+  vector<char> data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+  InputLogHeader header;
+  if (data.size() < sizeof(header))
+  {
+    printf("%s is too small to be an input log\n", path.c_str());
+    return NULL;
+  }
+  memcpy(&header, data.data(), sizeof(header));
+  if (memcmp(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != INPUT_LOG_VERSION ||
+      header.keyCount != SDL_NUM_SCANCODES)
+  {
+    printf("%s is not a version %u input log\n", path.c_str(), INPUT_LOG_VERSION);
+    return NULL;
+  }
+
+  InputPlayer *player = new InputPlayer();
+  player->seed = header.seed;
+  size_t position = sizeof(header);
+  unsigned long long tick = 0;
+  while (true)
+  {
+    unsigned long long delta, code, x = 0, y = 0;
+    bool valid = ReadVarint(data, &position, &delta) && ReadVarint(data, &position, &code);
+    if (valid && (code >> 2) == INPUT_CLICK_CODE)
+    {
+      valid = (code & 3) == INPUT_KEY_PRESS && ReadVarint(data, &position, &x) && ReadVarint(data, &position, &y);
+    }
+    if (!valid || (code >> 2) > INPUT_CLICK_CODE)
+    {
+      printf("%s is damaged or was not finished\n", path.c_str());
+      delete player;
+      return NULL;
+    }
+    tick += delta;
+    if ((code & 3) == INPUT_END)
+    {
+      break;
+    }
+    player->events.push_back({tick : tick, scancode : (unsigned short)(code >> 2), kind : (unsigned char)(code & 3),
+                              click : {x : (int)x, y : (int)y}});
+  }
+
+  if (data.size() - position < sizeof(player->finalStateHash))
+  {
+    printf("%s is missing its final state hash\n", path.c_str());
+    delete player;
+    return NULL;
+  }
+  memcpy(&player->finalStateHash, data.data() + position, sizeof(player->finalStateHash));
+  player->tickCount = tick;
+  return player;
+}
+
+uint64_t InputPlayer::GetSeed() const
+{
+  return seed;
+}
+
+unsigned long long InputPlayer::GetTickCount() const
+{
+  return tickCount;
+}
+
+uint64_t InputPlayer::GetFinalStateHash() const
+{
+  return finalStateHash;
+}
+
+bool InputPlayer::NextTick(InputState *input)
+{
+  if (tick >= tickCount)
+  {
+    return false;
+  }
+
+  memset(pressed, 0, sizeof(pressed));
+  bool clicked = false;
+  for (; nextEvent < events.size() && events[nextEvent].tick == tick; nextEvent++)
+  {
+    const Event &event = events[nextEvent];
+    if (event.scancode == INPUT_CLICK_CODE)
+    {
+      click = event.click;
+      clicked = true;
+      continue;
+    }
+    switch (event.kind)
+    {
+    case INPUT_KEY_DOWN:
+      held[event.scancode] = 1;
+      break;
+    case INPUT_KEY_UP:
+      held[event.scancode] = 0;
+      break;
+    case INPUT_KEY_PRESS:
+      pressed[event.scancode] = 1;
+      break;
+    }
+  }
+  tick++;
+
+  *input = {held : held, pressed : pressed, click : clicked ? &click : NULL};
+  return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "game.h"
+
+using namespace std;
+
+// Input log (.tbi), little-endian:
+//   InputLogHeader
+//   events, each a varint tick delta (ticks since the previous event) then a
+//   varint (scancode << 2 | InputEventKind); a left click is a press of
+//   INPUT_CLICK_CODE followed by varints x and y in game pixels
+//   an End event, whose tick delta brings the total to the number of ticks
+//   played, followed by the uint64_t Game::GetStateHash() after the last tick
+//
+// Only changes are stored: a key going down or up between ticks, and presses
+// that started and ended between two ticks. Idle ticks cost nothing.
+const char INPUT_LOG_MAGIC[4] = {'T', 'B', 'R', 'I'};
+// Version 2 added clicks, and came with terrain blocking the player, so
+// version 1 logs would not replay the same anyway.
+const uint32_t INPUT_LOG_VERSION = 2;
+// Stands in for a scancode; one past the last real one.
+const unsigned int INPUT_CLICK_CODE = SDL_NUM_SCANCODES;
+
+struct InputLogHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t seed;
+  uint32_t keyCount;
+  uint32_t reserved;
+};
+
+enum InputEventKind
+{
+  INPUT_KEY_DOWN = 0, // now held
+  INPUT_KEY_UP = 1,   // no longer held
+  INPUT_KEY_PRESS = 2,
+  INPUT_END = 3,
+};
+
+// Writes the InputState of every tick of a session.
+class InputRecorder
+{
+public:
+  // NULL if the file cannot be created.
+  static InputRecorder *Create(const string &path, uint64_t seed);
+  ~InputRecorder();
+
+  void RecordTick(const InputState &input);
+  // Ends the log; the recorder is unusable afterwards.
+  void Finish(uint64_t stateHash);
+
+private:
+  InputRecorder(FILE *file);
+  void WriteEvent(unsigned long long tick, unsigned int code);
+  void WriteVarint(unsigned long long value);
+
+  FILE *file;
+  unsigned long long tick = 0;
+  unsigned long long lastEventTick = 0;
+  Uint8 held[SDL_NUM_SCANCODES] = {};
+};
+
+// Plays a log back one tick at a time.
+class InputPlayer
+{
+public:
+  // NULL if the file is missing, damaged or from another version.
+  static InputPlayer *Open(const string &path);
+
+  uint64_t GetSeed() const;
+  unsigned long long GetTickCount() const;
+  uint64_t GetFinalStateHash() const;
+
+  // Input for the next tick, or false once every recorded tick is played.
+  // The returned arrays stay valid until the next call.
+  bool NextTick(InputState *input);
+
+private:
+  struct Event
+  {
+    unsigned long long tick;
+    unsigned short scancode;
+    unsigned char kind;
+    SDL_Point click; // for INPUT_CLICK_CODE
+  };
+
+  uint64_t seed;
+  unsigned long long tickCount;
+  uint64_t finalStateHash;
+  vector<Event> events;
+  size_t nextEvent = 0;
+  unsigned long long tick = 0;
+  Uint8 held[SDL_NUM_SCANCODES] = {};
+  Uint8 pressed[SDL_NUM_SCANCODES] = {};
+  SDL_Point click;
+};
@@ -1,7 +1,35 @@
 #include "./constants.h"
+#include "./asset_loader.cpp"
+#include "./alloc_counter.cpp"
+#include "./profiler.cpp"
+#include "./frame_arena.cpp"
+#include "./atlas.cpp"
+#include "./draw_list.cpp"
+#include "./sprite_batch.cpp"
+#include "./screen.cpp"
 #include "./text_renderer.cpp"
+#include "./mapped_file.cpp"
+#include "./asset_pack.cpp"
+#include "./paths.cpp"
+#include "./terrain.cpp"
+#include "./save_state.cpp"
+#include "./world.cpp"
+#include "./entities.cpp"
+#include "./pathfinder.cpp"
+#include "./tile_map_renderer.cpp"
+#include "./battle_ui.cpp"
+#include "./gui.cpp"
+#include "./rng.cpp"
+#include "./battle.cpp"
+#include "./content.cpp"
+#include "./animator.cpp"
+#include "./game.cpp"
+#include "./input_log.cpp"
+#include "./frame_pacer.cpp"
+#include "./frame_pipeline.cpp"
+#include "./profiler_overlay.cpp"
+#include "./audio.cpp"
 #include <iostream>
-#include <list>
 #include <queue>
 #include <vector>
 #include <chrono>
@@ -9,230 +37,106 @@
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_mixer.h>
-// #include <boost/json/parse.hpp> // TODO(json): Uncomment for JSON support
-// #include <boost/json/value.hpp> // TODO(json): Uncomment for JSON support
 
 using namespace std;
 
 /**
  * To do:
- * Recalculate biggest integer scaling factor based on window size
  * Find a better way to get relative path to assets
  */
 
-list<SDL_Texture *> g_textures;
-SDL_Texture *LoadTexture(string path, SDL_Renderer *renderer)
+// Drawn with plain rects, since no texture exists yet.
+void DrawLoadingScreen(SDL_Renderer *renderer, double progress)
 {
-  SDL_Texture *newTexture = IMG_LoadTexture(renderer, path.c_str());
-  if (newTexture == NULL)
-  {
-    printf("Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
-  }
-  else
-  {
-    g_textures.push_back(newTexture);
-  }
-
-  return newTexture;
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+  SDL_RenderClear(renderer);
+  SDL_Rect barRect = {x : GAME_W / 2 - 60, y : GAME_H / 2 - 3, w : 120, h : 6};
+  SDL_SetRenderDrawColor(renderer, 230, 230, 230, 255);
+  SDL_RenderDrawRect(renderer, &barRect);
+  barRect = {x : barRect.x + 1, y : barRect.y + 1, w : (int)((barRect.w - 2) * progress), h : barRect.h - 2};
+  SDL_RenderFillRect(renderer, &barRect);
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
 }
 
-const int GUI_Y = 24;
-SDL_Rect borderVertical = {x : 0, y : GUI_Y, w : 5, h : 1};
-SDL_Rect borderHorizontal = {x : 8, y : GUI_Y, w : 1, h : 5};
-SDL_Rect cornerTL = {x : 16, y : GUI_Y, w : 5, h : 5};
-SDL_Rect cornerTR = {x : 24, y : GUI_Y, w : 5, h : 5};
-SDL_Rect cornerBR = {x : 32, y : GUI_Y, w : 5, h : 5};
-SDL_Rect cornerBL = {x : 40, y : GUI_Y, w : 5, h : 5};
-SDL_Rect junctionR = {x : 48, y : GUI_Y, w : 5, h : 5};
-SDL_Rect junctionB = {x : 56, y : GUI_Y, w : 5, h : 5};
-SDL_Rect junctionL = {x : 64, y : GUI_Y, w : 5, h : 5};
-SDL_Rect junctionT = {x : 72, y : GUI_Y, w : 5, h : 5};
-SDL_Rect guiFill = {x : 80, y : GUI_Y, w : 1, h : 1};
-const int GUI_BORDER_W = 5, GUI_BORDER_H = 5;
-
-void DrawGuiLineH(SDL_Renderer *renderer, SDL_Texture *gui, SDL_Rect *lineRect, SDL_Rect *endpointL = NULL, SDL_Rect *endpointR = NULL)
+int main(int argc, char **argv)
 {
-  SDL_SetTextureColorMod(gui, 255, 255, 255);
-  SDL_Rect guiRect;
-  int marginX = (endpointL != NULL) * GUI_BORDER_W;
-  int marginW = (endpointR != NULL) * GUI_BORDER_W + marginX;
-  guiRect = {x : lineRect->x + marginX, y : lineRect->y, w : lineRect->w - marginW, h : GUI_BORDER_H};
-  SDL_RenderCopy(renderer, gui, &borderHorizontal, &guiRect);
-
-  if (endpointL != NULL)
-  {
-    guiRect = {x : lineRect->x, y : lineRect->y, w : GUI_BORDER_W, h : GUI_BORDER_H};
-    SDL_RenderCopy(renderer, gui, endpointL, &guiRect);
-  }
-  if (endpointR != NULL)
+  auto startTime = chrono::steady_clock::now();
+  PacingMode pacingMode = PacingMode::Hybrid;
+  uint64_t seed = chrono::system_clock::now().time_since_epoch().count();
+  int audioBufferSamples = DEFAULT_AUDIO_BUFFER_SAMPLES;
+  int entityCount = DEFAULT_ENTITIES;
+  string recordPath, replayPath, loadPath;
+  for (int i = 1; i + 1 < argc; i++)
   {
-    guiRect = {x : lineRect->x + lineRect->w - GUI_BORDER_W, y : lineRect->y, w : GUI_BORDER_W, h : GUI_BORDER_H};
-    SDL_RenderCopy(renderer, gui, endpointR, &guiRect);
+    if (string(argv[i]) == "--pacing")
+    {
+      pacingMode = ParsePacingMode(argv[i + 1], pacingMode);
+    }
+    else if (string(argv[i]) == "--seed")
+    {
+      seed = strtoull(argv[i + 1], NULL, 10);
+    }
+    else if (string(argv[i]) == "--entities")
+    {
+      entityCount = max(0, atoi(argv[i + 1]));
+    }
+    else if (string(argv[i]) == "--audio-buffer")
+    {
+      audioBufferSamples = atoi(argv[i + 1]);
+    }
+    else if (string(argv[i]) == "--record")
+    {
+      recordPath = argv[i + 1];
+    }
+    else if (string(argv[i]) == "--replay")
+    {
+      replayPath = argv[i + 1];
+    }
+    else if (string(argv[i]) == "--load")
+    {
+      loadPath = argv[i + 1];
+    }
   }
-}
 
-void DrawGuiLineV(SDL_Renderer *renderer, SDL_Texture *gui, SDL_Rect *lineRect, SDL_Rect *endpointT = NULL, SDL_Rect *endpointB = NULL)
-{
-  SDL_SetTextureColorMod(gui, 255, 255, 255);
-  SDL_Rect guiRect;
-  int marginY = (endpointT != NULL) * GUI_BORDER_W;
-  int marginH = (endpointB != NULL) * GUI_BORDER_W + marginY;
-  guiRect = {x : lineRect->x, y : lineRect->y + marginY, w : GUI_BORDER_W, h : lineRect->h - marginH};
-  SDL_RenderCopy(renderer, gui, &borderVertical, &guiRect);
-
-  if (endpointT != NULL)
+  // A replay brings its own seed; recording keeps whatever seed was chosen.
+  InputPlayer *player = NULL;
+  InputRecorder *recorder = NULL;
+  if (!replayPath.empty())
   {
-    guiRect = {x : lineRect->x, y : lineRect->y, w : GUI_BORDER_W, h : GUI_BORDER_H};
-    SDL_RenderCopy(renderer, gui, endpointT, &guiRect);
-  }
-  if (endpointB != NULL)
-  {
-    guiRect = {x : lineRect->x, y : lineRect->y + lineRect->h - GUI_BORDER_H, w : GUI_BORDER_W, h : GUI_BORDER_H};
-    SDL_RenderCopy(renderer, gui, endpointB, &guiRect);
+    player = InputPlayer::Open(replayPath);
+    if (player == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+    seed = player->GetSeed();
+    printf("Replaying %llu ticks from %s\n", player->GetTickCount(), replayPath.c_str());
   }
-}
-
-void DrawGuiBox(SDL_Renderer *renderer, SDL_Texture *gui, SDL_Rect *boxRect, bool fill = true, int r = 0, int g = 0, int b = 0)
-{
-  SDL_SetTextureColorMod(gui, 255, 255, 255);
-  SDL_Rect guiRect;
-  guiRect = {x : boxRect->x + GUI_BORDER_W, y : boxRect->y, w : boxRect->w - GUI_BORDER_W * 2, h : GUI_BORDER_H};
-  DrawGuiLineH(renderer, gui, &guiRect);
-  guiRect = {x : boxRect->x + GUI_BORDER_W, y : boxRect->y + boxRect->h - GUI_BORDER_H, w : boxRect->w - GUI_BORDER_W * 2, h : GUI_BORDER_H};
-  DrawGuiLineH(renderer, gui, &guiRect);
-
-  guiRect = {x : boxRect->x, y : boxRect->y, w : GUI_BORDER_W, h : boxRect->h};
-  DrawGuiLineV(renderer, gui, &guiRect, &cornerTL, &cornerBL);
-  guiRect = {x : boxRect->x + boxRect->w - GUI_BORDER_W, y : boxRect->y, w : GUI_BORDER_W, h : boxRect->h};
-  DrawGuiLineV(renderer, gui, &guiRect, &cornerTR, &cornerBR);
-
-  if (fill)
+  else if (!recordPath.empty())
   {
-    SDL_SetTextureColorMod(gui, r, g, b);
-    guiRect = {x : boxRect->x + GUI_BORDER_W, y : boxRect->y + GUI_BORDER_H, w : boxRect->w - GUI_BORDER_W * 2, h : boxRect->h - GUI_BORDER_H * 2};
-    SDL_RenderCopy(renderer, gui, &guiFill, &guiRect);
+    recorder = InputRecorder::Create(recordPath, seed);
+    if (recorder == NULL)
+    {
+      return EXIT_FAILURE;
+    }
   }
-}
-
-void DrawTextBox(TextRenderer *textRenderer, const string &text, SDL_Renderer *renderer, SDL_Texture *gui, SDL_Rect *textArea, int r = 0, int g = 0, int b = 0, int charsToRender = -1)
-{
-  SDL_Rect borderRect = {x : textArea->x - GUI_BORDER_W - 1, y : textArea->y - GUI_BORDER_H - 1, w : textArea->w + GUI_BORDER_W * 2 + 2, h : textArea->h + GUI_BORDER_H * 2 + 2};
-  DrawGuiBox(renderer, gui, &borderRect, true, r, g, b);
-  textRenderer->DrawTextWrapped(text, textArea, charsToRender);
-}
-
-// srcRect
-const SDL_Rect battleAttack = {x : 0, y : 0, w : 48, h : 7};
-const SDL_Rect battleMagic = {x : 0, y : 7, w : 48, h : 7};
-const SDL_Rect battleItem = {x : 0, y : 14, w : 48, h : 7};
-const SDL_Rect battleRun = {x : 0, y : 21, w : 48, h : 7};
-const SDL_Rect battleSelect = {x : 0, y : 28, w : 4, h : 5};
-const SDL_Rect battleHighlightTL = {x : 0, y : 33, w : 3, h : 3};
-const SDL_Rect battleHighlightTR = {x : 3, y : 33, w : 3, h : 3};
-const SDL_Rect battleHighlightBR = {x : 6, y : 33, w : 3, h : 3};
-const SDL_Rect battleHighlightBL = {x : 9, y : 33, w : 3, h : 3};
-
-const SDL_Rect battleBGPlains = {x : 0, y : 0, w : 138, h : 26};
-
-const SDL_Rect enemyClamhead1 = {x : 0, y : 0, w : 24, h : 32};
-const SDL_Rect enemyClamhead2 = {x : 24, y : 0, w : 24, h : 32};
-const SDL_Rect enemyGoblin1 = {x : 0, y : 32, w : 24, h : 32};
-const SDL_Rect enemyGoblin2 = {x : 24, y : 32, w : 24, h : 32};
-const SDL_Rect enemyRat1 = {x : 0, y : 64, w : 24, h : 14};
-const SDL_Rect enemyRat2 = {x : 24, y : 64, w : 24, h : 14};
-
-// dstRect
-const SDL_Rect descriptionBoxPos = {x : 6, y : 110, w : 160, h : 64};
-const SDL_Rect battleAttackPos = {x : 182, y : 113, w : 48, h : 7};
-const SDL_Rect battleMagicPos = {x : 182, y : 124, w : 48, h : 7};
-const SDL_Rect battleItemPos = {x : 182, y : 135, w : 48, h : 7};
-const SDL_Rect battleRunPos = {x : 182, y : 146, w : 48, h : 7};
-const SDL_Rect battleBGPos = {x : 5, y : 5, w : 138, h : 26};
-
-const SDL_Rect enemySlot0 = {x : 116, y : 34, w : 24, h : 32};
-const SDL_Rect enemySlot1 = {x : 116, y : 69, w : 24, h : 32};
-const SDL_Rect enemySlot2 = {x : 89, y : 34, w : 24, h : 32};
-const SDL_Rect enemySlot3 = {x : 89, y : 69, w : 24, h : 32};
-const SDL_Rect enemySlot4 = {x : 62, y : 34, w : 24, h : 14};
-const SDL_Rect enemySlot5 = {x : 62, y : 51, w : 24, h : 14};
-const SDL_Rect enemySlot6 = {x : 62, y : 69, w : 24, h : 14};
-const SDL_Rect enemySlot7 = {x : 62, y : 86, w : 24, h : 14};
-
-void SetEnemySlot(int slotIndex, SDL_Rect &rect)
-{
-  switch (slotIndex)
+  // So does a save, which is only read in place once the game is set up.
+  SaveFile *save = NULL;
+  if (!loadPath.empty())
   {
-  case 0:
-    rect = enemySlot0;
-    break;
-  case 1:
-    rect = enemySlot1;
-    break;
-  case 2:
-    rect = enemySlot2;
-    break;
-  case 3:
-    rect = enemySlot3;
-    break;
-  case 4:
-    rect = enemySlot4;
-    break;
-  case 5:
-    rect = enemySlot5;
-    break;
-  case 6:
-    rect = enemySlot6;
-    break;
-  case 7:
-    rect = enemySlot7;
-    break;
+    if (player != NULL || recorder != NULL)
+    {
+      printf("Recordings and replays start from a new game, so --load can't go with them\n");
+      return EXIT_FAILURE;
+    }
+    save = SaveFile::Open(loadPath);
+    if (save == NULL)
+    {
+      printf("Unable to load %s\n", loadPath.c_str());
+      return EXIT_FAILURE;
+    }
+    seed = save->GetHeader().seed;
   }
-}
-
-SDL_Rect highlightRect;
-void HighlightSlot(SDL_Renderer *renderer, SDL_Texture *battle, const SDL_Rect *slotRect)
-{
-  highlightRect = {x : slotRect->x - 1, y : slotRect->y - 1, w : 3, h : 3};
-  SDL_RenderCopy(renderer, battle, &battleHighlightTL, &highlightRect);
-  highlightRect = {x : slotRect->x + slotRect->w + 1 - 3, y : slotRect->y - 1, w : 3, h : 3};
-  SDL_RenderCopy(renderer, battle, &battleHighlightTR, &highlightRect);
-  highlightRect = {x : slotRect->x - 1, y : slotRect->y + slotRect->h + 1 - 3, w : 3, h : 3};
-  SDL_RenderCopy(renderer, battle, &battleHighlightBL, &highlightRect);
-  highlightRect = {x : slotRect->x + slotRect->w + 1 - 3, y : slotRect->y + slotRect->h + 1 - 3, w : 3, h : 3};
-  SDL_RenderCopy(renderer, battle, &battleHighlightBR, &highlightRect);
-}
-
-enum class GameScreen
-{
-  Map,
-  Battle
-};
-
-enum class BattleStep
-{
-  Action,
-  Target,
-  Result
-};
-
-enum class BattleAction
-{
-  Attack = 0,
-  Magic = 1,
-  Item = 2,
-  Run = 3
-};
-
-bool isPositive(int num)
-{
-  return num > 0;
-}
-
-int main(int argc, char **argv)
-{
-  string exe_path = argv[0];
-  string build_dir_path = exe_path.substr(0, exe_path.find_last_of("\\"));
-  string project_dir_path = build_dir_path.substr(0, build_dir_path.find_last_of("\\"));
+  printf("Seed %llu\n", (unsigned long long)seed);
 
   // Setup
   if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_AUDIO) < 0)
@@ -247,541 +151,354 @@ int main(int argc, char **argv)
     return EXIT_FAILURE;
   }
 
-  if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
+  string project_dir_path = ProjectDirPath();
+  Content *content = Content::Load(project_dir_path + "/assets/content", project_dir_path + "/assets/content.tbc");
+  if (content == NULL)
   {
-    printf("SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError());
     return EXIT_FAILURE;
   }
 
-  Mix_Music *music = Mix_LoadMUS((project_dir_path + "/assets/wizardquest1.wav").c_str());
-  Mix_PlayMusic(music, -1);
-
   SDL_Window *window = SDL_CreateWindow("TBRPG", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_W, SCREEN_H, SDL_WINDOW_FULLSCREEN_DESKTOP);
   SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, 0);
-  SDL_RenderSetScale(renderer, SCALING_FACTOR, SCALING_FACTOR);
   SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
   if (NULL == window || NULL == renderer)
   {
     return EXIT_FAILURE;
   }
+  Screen *screen = new Screen(renderer);
+  printf("Scaling by %d\n", screen->GetScale());
 
   int keyboardSize;
   const Uint8 *keyboardState = SDL_GetKeyboardState(&keyboardSize);
   Uint8 newlyPressedKeys[keyboardSize];
   fill(newlyPressedKeys, newlyPressedKeys + keyboardSize, 0);
+  SDL_Point click;
+  bool clicked = false;
+
+  // Decoding starts here and runs while the mixer opens and the world maps
+  // in; textures are uploaded by loader->Update() below as they finish.
+  // Whatever tools/pack_assets put in the pack skips the loader entirely.
+  AssetPack *pack = AssetPack::Open(project_dir_path + "/assets/assets.tbp");
+  AssetLoader *loader = new AssetLoader();
+  SpriteBatch *batch = new SpriteBatch(renderer);
+  Atlas *atlas = new Atlas(renderer, project_dir_path + "/assets", loader, pack);
+
+  Audio *audio = Audio::Open(audioBufferSamples, DEFAULT_SFX_BUDGET_BYTES);
+  if (audio == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+  audio->PlayMusic(project_dir_path + "/assets", pack);
+  audio->LoadSoundEffects(project_dir_path + "/assets", pack, loader);
 
-  SDL_Texture *characters = LoadTexture(project_dir_path + "/assets/characters.png", renderer);
-  SDL_Rect wizardSprite = {x : 0, y : 0, w : TILE_W, h : TILE_H};
-  int playerAnimIndex = 0;
-  int playerAnimIndexOffset = 0;
-
-  SDL_Texture *worldMap = LoadTexture(project_dir_path + "/assets/worldmap.png", renderer);
-  SDL_Rect grassRect = {x : 0, y : 0, w : 16, h : 16};
-  SDL_Rect waterRect = {x : 16, y : 0, w : 16, h : 16};
-  SDL_Rect mountainRect = {x : 32, y : 0, w : 16, h : 16};
-  SDL_Rect hillsRect = {x : 48, y : 0, w : 16, h : 16};
-
-  SDL_Texture *font = LoadTexture(project_dir_path + "/assets/font.png", renderer);
-  TextRenderer *textRenderer = new TextRenderer(renderer, font);
-  SDL_Rect textRect;
-
-  SDL_Texture *gui = LoadTexture(project_dir_path + "/assets/gui.png", renderer);
-  SDL_Texture *battle = LoadTexture(project_dir_path + "/assets/battle.png", renderer);
-  SDL_Texture *battleBGs = LoadTexture(project_dir_path + "/assets/battleBGs.png", renderer);
-  SDL_Texture *enemies = LoadTexture(project_dir_path + "/assets/enemies.png", renderer);
-  SDL_SetTextureColorMod(battle, 230, 230, 230);
-  SDL_Rect guiRect;
-
-  SDL_Event windowEvent;
-
-  SDL_Rect playerPosition = {x : PLAYER_X, y : PLAYER_Y, w : TILE_W, h : TILE_H};
+  TextRenderer *textRenderer = new TextRenderer(batch, atlas->GetSheet("font.png"));
 
-  vector<vector<Tile>> tiles;
-  for (int y = 0; y < 100; y++)
+  World *world = World::Open(project_dir_path + "/assets/world.tbw");
+  if (world == NULL)
+  {
+    world = World::GenerateOnDemand(WORLD_W, WORLD_H, seed);
+  }
+  printf("World is %dx%d tiles, using %zu KB\n", world->GetWidth(), world->GetHeight(), world->MemoryUsage() / 1024);
+
+  TileMapRenderer *tileMapRenderer = new TileMapRenderer(batch, atlas->GetSheet("worldmap.png"), world);
+  EntityTable *entities = EntityTable::Spawn(world, Game::PrepareStartArea(world), entityCount, seed);
+  printf("%d entities, using %zu KB\n", entities->GetCount(), entities->MemoryUsage() / 1024);
+  auto pathfinderStart = chrono::steady_clock::now();
+  // Only used for a world opened from world.tbw.
+  Pathfinder *pathfinder = new Pathfinder(world, 0, project_dir_path + "/assets/world.tbg");
+  PathfinderStats pathStats = pathfinder->GetStats();
+  printf("Path graph: %d clusters, %d entrances, %d sectors, %d sector entrances, using %zu KB, %s in %.1f ms\n",
+         pathStats.clusters, pathStats.nodes, pathStats.sectors, pathStats.sectorEntrances, pathStats.memoryUsage / 1024,
+         pathStats.cached ? "read" : "built",
+         chrono::duration<double, milli>(chrono::steady_clock::now() - pathfinderStart).count());
+  Game *game = new Game(batch, textRenderer, atlas, content, world, tileMapRenderer, entities, pathfinder, seed);
+  game->SetAudio(audio);
+
+  // Everything from here on leaves through this, whether the game ran or a
+  // save failed to load.
+  auto shutDown = [&]()
   {
-    tiles.emplace_back();
-    for (int x = 0; x < 100; x++)
+    delete recorder;
+    delete player;
+    delete game;
+    delete textRenderer;
+    delete tileMapRenderer;
+    delete entities;
+    delete pathfinder;
+    delete world;
+    delete loader;
+    delete batch;
+    delete atlas;
+    delete content;
+    delete screen;
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    delete audio;
+    SDL_QuitSubSystem(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_AUDIO);
+    delete pack;
+    Mix_Quit();
+    IMG_Quit();
+    SDL_Quit();
+  };
+
+  if (save != NULL)
+  {
+    auto loadStart = chrono::steady_clock::now();
+    if (!game->LoadSnapshot(save))
     {
-      tiles.at(y).push_back((Tile)(rand() % 4));
+      printf("Unable to load %s\n", loadPath.c_str());
+      delete save;
+      shutDown();
+      return EXIT_FAILURE;
     }
+    printf("Loaded %s in %.2f ms\n", loadPath.c_str(),
+           chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count());
+    delete save;
   }
 
-  int playerPosX = 50, playerPosY = 50;
+  while (!loader->Update())
+  {
+    SDL_PumpEvents();
+    screen->BeginFrame();
+    DrawLoadingScreen(renderer, loader->GetProgress());
+    screen->Present();
+    SDL_Delay(1);
+  }
+  loader->PrintTimeline();
+  delete loader;
+  loader = NULL;
+  printf("Loaded in %.1f ms\n", chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count());
 
+  SDL_Event windowEvent;
   bool isRunning = true;
+  bool firstFramePresented = false;
   SDL_Event quitEvent = {type : SDL_QUIT};
 
-  SDL_Rect bgDrawRect = {x : 0, y : 0, w : TILE_W, h : TILE_H};
-
-  auto frameLength = chrono::nanoseconds{(int)(1.0 / MAX_FPS * 1000.0 * 1000.0 * 1000.0)};
-  auto currentTime = chrono::steady_clock::now() - frameLength;
-  unsigned long long int frameCount = 0;
-
-  bool isWalking = false;
-  unsigned long long int walkStart = frameCount;
-  double walkPercentDone;
-  Direction walkDirection;
-  Direction facing = DOWN;
-
-  bool showText = false;
-  int textCharsToShow = 0;
-  string bottomText = string("This is some text in a text box! Go forth, wizard, and cast spells! Huzzah! You will win!\n") +
-                      string("Furthermore, you may even get to ponder an orb at some point!");
-
-  int battleCharsToShow = 0;
-  int enemyHealth = 10;
-  int damageDealt = 0;
-  BattleStep battleStep = BattleStep::Action;
-  BattleAction battleAction = BattleAction::Attack;
-  int battleHighlightIndex = 0;
-  int enemyHp[8] = {10, 10, 8, 8, 5, 5, 5, 5};
-
-  string actionText = "What would you like to do?";
-
-  GameScreen currentScreen = GameScreen::Battle;
-
-  // Main loop
-  while (isRunning)
+  // The simulation runs in fixed ticks. Each loop renders once and the
+  // pacer decides when the next loop starts, so falling behind drops frames
+  // instead of presenting several back-to-back.
+  FramePacer *pacer = new FramePacer(renderer, pacingMode, MAX_FPS);
+  auto tickLength = chrono::nanoseconds{1000000000 / TICKS_PER_SECOND};
+  auto previousTime = chrono::steady_clock::now();
+  chrono::nanoseconds tickAccumulator{0};
+
+  bool showDrawStats = false;
+  bool showProfiler = false;
+  SpriteSheet *gui = atlas->GetSheet("gui.png");
+
+  // Frame N's ticks run and its drawing is recorded on the update thread
+  // while this thread plays frame N-1's draw list and presents it. SDL wants
+  // the renderer and the window's events on the thread that made them, so
+  // they stay here; the update only reads input gathered before it starts.
+  FrameArena *frameArena = new FrameArena(FRAME_ARENA_BYTES);
+  auto updateFrame = [&]()
   {
-    fill(newlyPressedKeys, newlyPressedKeys + keyboardSize, 0);
-
-    // Handle inputs
-    if (SDL_PollEvent(&windowEvent))
+    unsigned long long allocationsBefore = GetThreadAllocationCount();
+    frameArena->Reset();
+    auto now = chrono::steady_clock::now();
+    tickAccumulator += now - previousTime;
+    previousTime = now;
+
+    int ticksThisLoop = 0;
+    while (tickAccumulator >= tickLength && ticksThisLoop < MAX_TICKS_PER_FRAME)
     {
-      switch (windowEvent.type)
+      PROFILE_ZONE("Tick");
+      // Key presses count for the first tick after they happen and are then
+      // cleared; if no tick runs this loop they carry over to the next one.
+      InputState input = {held : keyboardState, pressed : newlyPressedKeys, click : clicked ? &click : NULL};
+      if (player != NULL && !player->NextTick(&input))
       {
-      case SDL_QUIT:
+        bool matched = game->GetStateHash() == player->GetFinalStateHash();
+        printf("Replay finished, %s the recording\n", matched ? "matching" : "DIVERGING FROM");
         isRunning = false;
         break;
-      case SDL_KEYDOWN:
-        switch (windowEvent.key.keysym.scancode)
-        {
-        case (SDL_SCANCODE_ESCAPE):
-          SDL_PushEvent(&quitEvent);
-          break;
-        default:
-          if (windowEvent.key.repeat == 0)
-          {
-            newlyPressedKeys[windowEvent.key.keysym.scancode] = 1;
-          }
-        }
-        break;
       }
-    }
-
-    if (isWalking && frameCount >= walkStart + WALK_FRAMES)
-    {
-      isWalking = false;
-      switch (walkDirection)
+      game->Tick(input);
+      if (recorder != NULL)
       {
-      case LEFT:
-        playerPosX--;
-        break;
-      case RIGHT:
-        playerPosX++;
-        break;
-      case UP:
-        playerPosY--;
-        break;
-      case DOWN:
-        playerPosY++;
-        break;
+        recorder->RecordTick(input);
       }
+      fill(newlyPressedKeys, newlyPressedKeys + keyboardSize, 0);
+      clicked = false;
+      tickAccumulator -= tickLength;
+      ticksThisLoop++;
     }
-
-    if (newlyPressedKeys[SDL_SCANCODE_B])
+    if (tickAccumulator >= tickLength)
     {
-      if (currentScreen == GameScreen::Battle)
-      {
-        currentScreen = GameScreen::Map;
-      }
-      else
-      {
-        currentScreen = GameScreen::Battle;
-      }
+      // Too far behind to catch up; let the game slow down instead.
+      tickAccumulator = tickAccumulator % tickLength;
     }
 
-    switch (currentScreen)
-    {
-    case GameScreen::Map:
     {
-      if (!isWalking)
+      PROFILE_ZONE("Record");
+      game->Render((double)tickAccumulator.count() / tickLength.count());
+      if (showProfiler)
       {
-        if (keyboardState[SDL_SCANCODE_LEFT])
-        {
-
-          isWalking = true;
-          walkStart = frameCount;
-          walkDirection = LEFT;
-          facing = LEFT;
-        }
-        else if (keyboardState[SDL_SCANCODE_RIGHT])
-        {
-
-          isWalking = true;
-          walkStart = frameCount;
-          walkDirection = RIGHT;
-          facing = RIGHT;
-        }
-        else if (keyboardState[SDL_SCANCODE_UP])
-        {
-
-          isWalking = true;
-          walkStart = frameCount;
-          walkDirection = UP;
-          facing = UP;
-        }
-        else if (keyboardState[SDL_SCANCODE_DOWN])
-        {
-
-          isWalking = true;
-          walkStart = frameCount;
-          walkDirection = DOWN;
-          facing = DOWN;
-        }
-      }
-
-      if (newlyPressedKeys[SDL_SCANCODE_Z])
-      {
-        if (!showText)
-        {
-          showText = true;
-          textCharsToShow = 0;
-        }
-        else if (textCharsToShow < bottomText.length())
-        {
-          textCharsToShow = bottomText.length();
-        }
-        else
-        {
-          showText = false;
-        }
+        PROFILE_ZONE("Overlay");
+        DrawProfilerOverlay(textRenderer, batch, gui, frameArena);
       }
+    }
+    g_profiler.Count(ProfileCounter::Allocations, GetThreadAllocationCount() - allocationsBefore);
+  };
+  FramePipeline *pipeline = new FramePipeline(updateFrame);
+
+  // Replays leave the autosave alone. Saves are copied while the update
+  // thread is parked between frames, then written on the writer's thread.
+  string autosavePath = project_dir_path + "/autosave.tbs";
+  SaveWriter *saveWriter = player == NULL ? new SaveWriter(autosavePath) : NULL;
+  auto autosaveInterval = chrono::seconds{AUTOSAVE_SECONDS};
+  auto lastAutosave = chrono::steady_clock::now();
+  double lastSnapshotMs = 0;
 
-      if (newlyPressedKeys[SDL_SCANCODE_R])
-      {
-        textCharsToShow = 0;
-      }
+  // Main loop
+  while (isRunning)
+  {
+    g_profiler.BeginFrame();
 
-      break;
-    }
-    case GameScreen::Battle:
+    // Handle inputs, all of them, so a burst of events is not spread out
+    // over several frames
     {
-      if (newlyPressedKeys[SDL_SCANCODE_UP] || newlyPressedKeys[SDL_SCANCODE_RIGHT])
-      {
-        if (battleStep == BattleStep::Action)
-        {
-          int newAction = static_cast<int>(battleAction) - 1;
-          if (newAction < 0)
-            newAction += 4;
-          battleAction = static_cast<BattleAction>(newAction);
-        }
-        else if (battleStep == BattleStep::Target)
-        {
-          battleHighlightIndex--;
-          battleHighlightIndex = (battleHighlightIndex + 8) % 8;
-        }
-      }
-      if (newlyPressedKeys[SDL_SCANCODE_DOWN] || newlyPressedKeys[SDL_SCANCODE_LEFT])
+      PROFILE_ZONE("Events");
+      while (SDL_PollEvent(&windowEvent))
       {
-        if (battleStep == BattleStep::Action)
-        {
-          int newAction = static_cast<int>(battleAction) + 1;
-          if (newAction >= 4)
-            newAction -= 4;
-          battleAction = static_cast<BattleAction>(newAction);
-        }
-        else if (battleStep == BattleStep::Target)
+        switch (windowEvent.type)
         {
-          battleHighlightIndex++;
-          battleHighlightIndex %= 8;
-        }
-      }
-      if (newlyPressedKeys[SDL_SCANCODE_Z])
-      {
-        battleCharsToShow = 0;
-        switch (battleStep)
-        {
-        case BattleStep::Action:
-        {
-          if (none_of(begin(enemyHp), end(enemyHp), isPositive))
-          {
-            currentScreen = GameScreen::Map;
-            break;
-          }
-
-          switch (battleAction)
-          {
-          case BattleAction::Attack:
-          case BattleAction::Magic:
+        case SDL_QUIT:
+          isRunning = false;
+          break;
+        case SDL_RENDER_TARGETS_RESET:
+          game->InvalidateRenderTargets();
+          break;
+        case SDL_KEYDOWN:
+          switch (windowEvent.key.keysym.scancode)
           {
-            actionText = "Select a target";
-            battleStep = BattleStep::Target;
+          case (SDL_SCANCODE_ESCAPE):
+            SDL_PushEvent(&quitEvent);
             break;
-          }
-          case BattleAction::Item:
-          {
-            int healing = rand() % 4 + 1;
-            actionText = format("Used an item!\n\nHealed {} health!", healing);
-            battleStep = BattleStep::Result;
+          case (SDL_SCANCODE_F2):
+            showProfiler = !showProfiler;
             break;
-          }
-          case BattleAction::Run:
-          {
-            actionText = "Attempted to run away!";
-            battleStep = BattleStep::Result;
+          case (SDL_SCANCODE_F3):
+            showDrawStats = !showDrawStats;
             break;
-          }
-          }
-          break;
-        }
-        case BattleStep::Target:
-        {
-          switch (battleAction)
-          {
-          case BattleAction::Attack:
-          {
-            damageDealt = rand() % 3 + 1;
-            enemyHp[battleHighlightIndex] -= damageDealt;
-            actionText = format("Swung with staff!\n\nDid {} damage!\n\nEnemy has {} health left.", damageDealt, enemyHp[battleHighlightIndex]);
+          case (SDL_SCANCODE_F4):
+            pacer->SetMode(static_cast<PacingMode>((static_cast<int>(pacer->GetMode()) + 1) % 3));
+            printf("Frame pacing: %s\n", PacingModeName(pacer->GetMode()));
             break;
-          }
-          case BattleAction::Magic:
-          {
-            damageDealt = rand() % 5 + 1;
-            enemyHp[battleHighlightIndex] -= damageDealt;
-            actionText = format("Cast a mighty spell!\n\nDid {} damage!\n\nEnemy has {} health left.", damageDealt, enemyHp[battleHighlightIndex]);
+          case (SDL_SCANCODE_F9):
+            if (!g_profiler.IsCapturing())
+            {
+              g_profiler.StartCapture(300, project_dir_path + "/trace.json");
+              printf("Capturing 300 frames to trace.json\n");
+            }
             break;
-          }
           default:
-          {
-            break;
-          }
+            if (windowEvent.key.repeat == 0)
+            {
+              newlyPressedKeys[windowEvent.key.keysym.scancode] = 1;
+            }
           }
-          battleStep = BattleStep::Result;
           break;
-        }
-        case BattleStep::Result:
-        {
-          if (none_of(begin(enemyHp), end(enemyHp), isPositive))
-          {
-            actionText = "You win!";
-          }
-          else
+        case SDL_MOUSEBUTTONDOWN:
+          // Clicks on the bars around the picture are ignored.
+          if (windowEvent.button.button == SDL_BUTTON_LEFT &&
+              screen->ToGamePoint(windowEvent.button.x, windowEvent.button.y, &click))
           {
-            actionText = "What would you like to do?";
+            clicked = true;
           }
-
-          battleStep = BattleStep::Action;
           break;
         }
-        }
-
-        break;
       }
     }
-    }
 
-    while (chrono::steady_clock::now() > currentTime + frameLength)
+    pipeline->Start();
     {
-      currentTime += frameLength;
-
-      // Render
-      SDL_RenderClear(renderer);
-
-      switch (currentScreen)
-      {
-      case GameScreen::Map:
+      PROFILE_ZONE("Submit");
+      screen->BeginFrame();
+      batch->Submit();
+    }
+    {
+      PROFILE_ZONE("Present");
+      screen->Present();
+    }
+    pacer->FramePresented();
+    {
+      PROFILE_ZONE("WaitUpdate");
+      pipeline->Wait();
+    }
+    if (saveWriter != NULL && chrono::steady_clock::now() - lastAutosave >= autosaveInterval)
+    {
+      PROFILE_ZONE("Autosave");
+      auto snapshotStart = chrono::steady_clock::now();
+      // Still writing the last one means skipping this one.
+      GameSnapshot *snapshot = saveWriter->BeginSave();
+      if (snapshot != NULL)
       {
-        if (isWalking)
-        {
-          walkPercentDone = (double)(frameCount - walkStart) / (double)WALK_FRAMES;
-          if (playerAnimIndex != (int)(walkPercentDone * 2 + 1) % 2)
-          {
-            playerAnimIndex = (int)(walkPercentDone * 2 + 1) % 2;
-            if (playerAnimIndex == 0)
-            {
-              playerAnimIndexOffset = (playerAnimIndexOffset + 1) % 2;
-            }
-          }
-        }
-        else
-        {
-          walkPercentDone = 0;
-          playerAnimIndex = 0;
-        }
-
-        for (int x = -TILES_L; x <= TILES_R; x++)
-        {
-          for (int y = -TILES_U; y <= TILES_D; y++)
-          {
-            bgDrawRect.x = x * TILE_W + playerPosition.x;
-            bgDrawRect.y = y * TILE_H + playerPosition.y;
-
-            if (isWalking)
-            {
-              int HORIZONTAL_ADJUST = (int)(TILE_W * walkPercentDone) + 1,
-                  VERTICAL_ADJUST = (int)(TILE_H * walkPercentDone) + 1;
-              switch (walkDirection)
-              {
-              case LEFT:
-                bgDrawRect.x += HORIZONTAL_ADJUST;
-                break;
-              case RIGHT:
-                bgDrawRect.x -= HORIZONTAL_ADJUST;
-                break;
-              case UP:
-                bgDrawRect.y += VERTICAL_ADJUST;
-                break;
-              case DOWN:
-                bgDrawRect.y -= VERTICAL_ADJUST;
-                break;
-              }
-            }
-
-            int relativeX = playerPosX + x, relativeY = playerPosY + y;
-
-            Tile i;
-            if (relativeX >= 0 && relativeX < 100 && relativeY >= 0 && relativeY < 100)
-            {
-              i = tiles.at(relativeY).at(relativeX);
-            }
-            else
-            {
-              i = W;
-            }
-            switch (i)
-            {
-            case G:
-              SDL_RenderCopy(renderer, worldMap, &grassRect, &bgDrawRect);
-              break;
-            case W:
-              SDL_RenderCopy(renderer, worldMap, &waterRect, &bgDrawRect);
-              break;
-            case M:
-              SDL_RenderCopy(renderer, worldMap, &mountainRect, &bgDrawRect);
-              break;
-            case H:
-              SDL_RenderCopy(renderer, worldMap, &hillsRect, &bgDrawRect);
-              break;
-            }
-          }
-        }
-
-        int facingOffset;
-        SDL_RendererFlip flip = SDL_FLIP_NONE;
-        if (facing == DOWN)
-        {
-          facingOffset = 0;
-        }
-        else if (facing == UP)
-        {
-          facingOffset = 128;
-        }
-        else
-        {
-          facingOffset = 64;
-          if (facing == RIGHT)
-          {
-            flip = SDL_FLIP_HORIZONTAL;
-          }
-        }
-        wizardSprite = {x : (playerAnimIndex + playerAnimIndexOffset * 2) * TILE_W + facingOffset, y : 0, w : TILE_W, h : TILE_H};
-        SDL_RenderCopyEx(renderer, characters, &wizardSprite, &playerPosition, 0, NULL, flip);
-
-        textRenderer->SetTextColor(230, 230, 230);
-        guiRect = {x : 20, y : 130, w : 280, h : 40};
-
-        if (showText)
-        {
-          if (frameCount % 3 == 0)
-          {
-            textCharsToShow++;
-          }
-          DrawTextBox(textRenderer, bottomText, renderer, gui, &guiRect, 75, 75, 105, textCharsToShow);
-        }
-
-        break;
+        game->SaveSnapshot(snapshot);
+        saveWriter->CommitSave();
+        lastSnapshotMs = chrono::duration<double, milli>(chrono::steady_clock::now() - snapshotStart).count();
       }
-      case GameScreen::Battle:
-      {
-        guiRect = {x : 0, y : 0, w : GAME_W, h : GAME_H};
-        DrawGuiBox(renderer, gui, &guiRect);
-        guiRect = {x : 0, y : 104, w : GAME_W, h : GUI_BORDER_H};
-        DrawGuiLineH(renderer, gui, &guiRect, &junctionR, &junctionL);
-        guiRect = {x : 143, y : 0, w : GUI_BORDER_W, h : 109};
-        DrawGuiLineV(renderer, gui, &guiRect, &junctionB, &junctionT);
-        guiRect = {x : 167, y : 104, w : GUI_BORDER_W, h : 76};
-        DrawGuiLineV(renderer, gui, &guiRect, &junctionB, &junctionT);
-
-        SDL_RenderCopy(renderer, battle, &battleAttack, &battleAttackPos);
-        SDL_RenderCopy(renderer, battle, &battleMagic, &battleMagicPos);
-        SDL_RenderCopy(renderer, battle, &battleItem, &battleItemPos);
-        SDL_RenderCopy(renderer, battle, &battleRun, &battleRunPos);
-
-        SDL_RenderCopy(renderer, battleBGs, &battleBGPlains, &battleBGPos);
-
-        guiRect = {x : 175, y : 114 + 11 * static_cast<int>(battleAction), w : 4, h : 5};
-        SDL_RenderCopy(renderer, battle, &battleSelect, &guiRect);
-
-        if (frameCount % 3 == 0)
-        {
-          battleCharsToShow++;
-        }
-        textRenderer->SetTextColor(230, 230, 230);
-        textRenderer->DrawTextWrapped(actionText, &descriptionBoxPos, battleCharsToShow);
-
-        bool enemyAnimPhase = frameCount / 180 % 2 == 0;
-
-        if (enemyHp[0] > 0)
-          SDL_RenderCopy(renderer, enemies, enemyAnimPhase ? &enemyClamhead1 : &enemyClamhead2, &enemySlot0);
-        if (enemyHp[1] > 0)
-          SDL_RenderCopy(renderer, enemies, enemyAnimPhase ? &enemyClamhead2 : &enemyClamhead1, &enemySlot1);
-
-        if (enemyHp[2] > 0)
-          SDL_RenderCopy(renderer, enemies, enemyAnimPhase ? &enemyGoblin1 : &enemyGoblin2, &enemySlot2);
-        if (enemyHp[3] > 0)
-          SDL_RenderCopy(renderer, enemies, enemyAnimPhase ? &enemyGoblin2 : &enemyGoblin1, &enemySlot3);
-
-        if (enemyHp[4] > 0)
-          SDL_RenderCopy(renderer, enemies, enemyAnimPhase ? &enemyRat1 : &enemyRat2, &enemySlot4);
-        if (enemyHp[5] > 0)
-          SDL_RenderCopy(renderer, enemies, enemyAnimPhase ? &enemyRat2 : &enemyRat1, &enemySlot5);
-        if (enemyHp[6] > 0)
-          SDL_RenderCopy(renderer, enemies, enemyAnimPhase ? &enemyRat1 : &enemyRat2, &enemySlot6);
-        if (enemyHp[7] > 0)
-          SDL_RenderCopy(renderer, enemies, enemyAnimPhase ? &enemyRat2 : &enemyRat1, &enemySlot7);
-
-        if (battleStep == BattleStep::Target)
-        {
-          SDL_Rect currentEnemySlot;
-          SetEnemySlot(battleHighlightIndex, currentEnemySlot);
-          HighlightSlot(renderer, battle, &currentEnemySlot);
-        }
+      lastAutosave = snapshotStart;
+    }
+    batch->EndFrame();
+    g_profiler.EndFrame();
+    if (!firstFramePresented)
+    {
+      printf("First frame after %.1f ms\n", chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count());
+      firstFramePresented = true;
+    }
 
-        break;
-      }
+    if (pacer->HasNewStats() && showDrawStats)
+    {
+      SpriteBatchStats drawStats = batch->GetLastFrameStats();
+      FramePacerStats frameStats = pacer->GetStats();
+      printf("Draw calls: %d sprites -> %d batches\n", drawStats.sprites, drawStats.drawCalls);
+      printf("Frames (%s): %d fps, %.2f ms avg, %.2f ms jitter, %.2f ms worst, %.0f%% CPU\n",
+             PacingModeName(pacer->GetMode()), frameStats.frames, frameStats.averageFrameMs,
+             frameStats.jitterMs, frameStats.worstFrameMs, frameStats.cpuPercent);
+      FramePipelineStats pipelineStats = pipeline->GetStats();
+      printf("Pipeline: waited on the update in %d/%d frames, %.2f ms avg wait, update idle %.2f ms avg\n",
+             pipelineStats.renderWaits, pipelineStats.frames, pipelineStats.averageRenderWaitMs,
+             pipelineStats.averageUpdateIdleMs);
+      if (saveWriter != NULL)
+      {
+        SaveWriterStats saveStats = saveWriter->GetStats();
+        printf("Autosave: %d written, %d skipped, %d failed, %.1f KB, copied in %.3f ms, written in %.2f ms\n",
+               saveStats.saves, saveStats.skipped, saveStats.failed, saveStats.lastFileSize / 1024.0,
+               lastSnapshotMs, saveStats.lastWriteMs);
       }
-
-      SDL_RenderPresent(renderer);
-
-      frameCount++;
+      AudioStats audioStats = audio->GetStats();
+      printf("Audio: %zu KB sound effects, %zu KB music streamed from %s, %d/%d voices, %d stolen\n",
+             audioStats.sfxBytes / 1024, audioStats.musicBytes / 1024, audioStats.musicInMemory ? "pack" : "disk",
+             audioStats.voicesPlaying, SFX_VOICES, audioStats.voicesStolen);
+      printf("Audio callbacks: %d, %.2f ms apart expected, %.2f ms avg, %.2f ms worst, %d late\n",
+             audioStats.callbacks, audioStats.expectedCallbackIntervalMs, audioStats.averageCallbackIntervalMs,
+             audioStats.worstCallbackIntervalMs, audioStats.lateCallbacks);
     }
+
+    pacer->WaitForNextFrame();
   }
 
   // Cleanup
-  delete textRenderer;
-  while (!g_textures.empty())
+  if (recorder != NULL)
+  {
+    recorder->Finish(game->GetStateHash());
+    printf("Recorded input to %s\n", recordPath.c_str());
+  }
+  if (saveWriter != NULL)
   {
-    SDL_DestroyTexture(g_textures.back());
-    g_textures.pop_back();
+    // The update thread is parked after the last Wait(), so the state is
+    // whole; deleting the writer waits for the file.
+    saveWriter->Wait();
+    game->SaveSnapshot(saveWriter->BeginSave());
+    saveWriter->CommitSave();
+    delete saveWriter;
+    printf("Saved to %s\n", autosavePath.c_str());
   }
-  SDL_DestroyRenderer(renderer);
-  SDL_DestroyWindow(window);
-  SDL_QuitSubSystem(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_AUDIO);
-  Mix_Quit();
-  IMG_Quit();
-  SDL_Quit();
+  delete pipeline;
+  delete frameArena;
+  delete pacer;
+  shutDown();
 
   return EXIT_SUCCESS;
 }
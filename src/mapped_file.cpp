@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <string>
+#include <cstddef>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "mapped_file.h"
+
+using namespace std;
+
+MappedFile::MappedFile()
+{
+#ifdef _WIN32
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+  pageSize = systemInfo.dwPageSize;
+#else
+  pageSize = sysconf(_SC_PAGESIZE);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+  Close();
+}
+
+bool MappedFile::Open(const string &path)
+{
+  Close();
+#ifdef _WIN32
+  fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (fileHandle == INVALID_HANDLE_VALUE)
+  {
+    fileHandle = NULL;
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  GetFileSizeEx(fileHandle, &fileSize);
+  size = fileSize.QuadPart;
+  mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mappingHandle == NULL)
+  {
+    Close();
+    return false;
+  }
+  data = (const unsigned char *)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+  fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat fileStat;
+  fstat(fd, &fileStat);
+  size = fileStat.st_size;
+  void *mapping = size > 0 ? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  data = mapping == MAP_FAILED ? NULL : (const unsigned char *)mapping;
+#endif
+  if (data == NULL)
+  {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+  if (data != NULL)
+    UnmapViewOfFile(data);
+  if (mappingHandle != NULL)
+    CloseHandle(mappingHandle);
+  if (fileHandle != NULL)
+    CloseHandle(fileHandle);
+  mappingHandle = NULL;
+  fileHandle = NULL;
+#else
+  if (data != NULL)
+    munmap((void *)data, size);
+  if (fd >= 0)
+    close(fd);
+  fd = -1;
+#endif
+  data = NULL;
+  size = 0;
+}
+
+const unsigned char *MappedFile::GetData() const
+{
+  return data;
+}
+
+size_t MappedFile::GetSize() const
+{
+  return size;
+}
+
+void MappedFile::Prefetch(size_t offset, size_t length) const
+{
+  // Round outwards: touching a little extra is harmless.
+  size_t start = offset / pageSize * pageSize;
+  size_t end = min(size, (offset + length + pageSize - 1) / pageSize * pageSize);
+  if (data == NULL || start >= end)
+  {
+    return;
+  }
+#ifdef _WIN32
+  WIN32_MEMORY_RANGE_ENTRY range = {(void *)(data + start), end - start};
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+  madvise((void *)(data + start), end - start, MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::Release(size_t offset, size_t length) const
+{
+  // Round inwards so a neighbour sharing the edge pages keeps them.
+  size_t start = (offset + pageSize - 1) / pageSize * pageSize;
+  size_t end = min(size, (offset + length) / pageSize * pageSize);
+  if (data == NULL || start >= end)
+  {
+    return;
+  }
+#ifdef _WIN32
+  // Unlocking pages that were never locked drops them from the working set.
+  VirtualUnlock((void *)(data + start), end - start);
+#else
+  madvise((void *)(data + start), end - start, MADV_DONTNEED);
+#endif
+}
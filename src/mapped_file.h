@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+// Read-only memory mapping of a whole file. Pages are only read from disk
+// when first touched, and Prefetch/Release give the OS residency hints for
+// ranges we are about to need or are done with.
+class MappedFile
+{
+public:
+  MappedFile();
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool Open(const string &path);
+  void Close();
+
+  const unsigned char *GetData() const;
+  size_t GetSize() const;
+
+  void Prefetch(size_t offset, size_t length) const;
+  void Release(size_t offset, size_t length) const;
+
+private:
+  const unsigned char *data = NULL;
+  size_t size = 0;
+  size_t pageSize = 4096;
+#ifdef _WIN32
+  void *fileHandle = NULL;
+  void *mappingHandle = NULL;
+#else
+  int fd = -1;
+#endif
+};
@@ -0,0 +1,1551 @@
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <SDL.h>
+#include "constants.h"
+#include "world.h"
+#include "save_state.h"
+#include "pathfinder.h"
+
+using namespace std;
+
+constexpr int MAX_TILE_MOVE_COST = *max_element(begin(TILE_MOVE_COSTS), end(TILE_MOVE_COSTS));
+const int CLUSTER_SHIFT = __builtin_ctz(CHUNK_TILES);
+const uint16_t UNREACHABLE_COST = UINT16_MAX;
+static_assert(CLUSTER_AREA * MAX_TILE_MOVE_COST < UNREACHABLE_COST, "Costs inside a cluster must fit in 16 bits");
+constexpr int COST_UNIT = [](){
+  int unit = 0;
+  for (int cost : TILE_MOVE_COSTS)
+  {
+    unit = gcd(unit, cost);
+  }
+  return unit;
+}();
+constexpr int COST_BUCKETS = MAX_TILE_MOVE_COST / COST_UNIT + 1;
+// Sectors are SECTOR_CHUNKS x SECTOR_CHUNKS clusters, so each of their four
+// sides has at most CHUNK_TILES / 2 crossings per cluster along it.
+const int SECTOR_CHUNKS = 4;
+const int SECTOR_AREA = SECTOR_CHUNKS * SECTOR_CHUNKS * CLUSTER_AREA;
+const int MAX_SECTOR_ENTRANCES = 4 * SECTOR_CHUNKS * CHUNK_TILES / 2;
+static_assert(SECTOR_AREA * MAX_TILE_MOVE_COST / COST_UNIT < UNREACHABLE_COST, "Costs inside a sector must fit in 16 bits");
+// Overestimating the remaining cost a little makes the search head for the
+// goal instead of fanning out around every detour, for routes at most that
+// much longer (in practice a few percent) and a fraction of the work.
+const int HEURISTIC_WEIGHT_PERCENT = 120;
+// Searches between nodes of nearby sectors give up after this many and go
+// over the sectors instead, which costs more up front but bounds a detour.
+const int MAX_NEAR_NODES = 512;
+// Entrances spread around the world's edges, with the cost of walking from
+// each to every other entrance worked out ahead of time. How much further
+// from a landmark the goal is than an entrance is a far better estimate
+// than the straight line when water is in the way: on a 4096 x 4096 map it
+// cuts the entrances a long query goes through several times over.
+const int LANDMARKS = 8;
+// Node ids stand for (cluster, node) or (sector, entrance) pairs; these two
+// stand for the ends of the route being searched.
+const int START_NODE = -1, GOAL_NODE = -2;
+
+bool Path::IsEmpty() const
+{
+  return waypoints.empty();
+}
+
+void Path::Clear()
+{
+  waypoints.clear();
+  steps.clear();
+  cost = 0;
+  leg = 0;
+  step = 0;
+}
+
+SaveRoute Path::Save(vector<SDL_Point> *points) const
+{
+  points->insert(points->end(), waypoints.begin(), waypoints.end());
+  points->insert(points->end(), steps.begin(), steps.end());
+  return {
+    waypointCount : (uint32_t)waypoints.size(),
+    stepCount : (uint32_t)steps.size(),
+    cost : cost,
+    leg : leg,
+    step : step,
+    reserved : 0};
+}
+
+void Path::Load(const SaveRoute &saved, const SDL_Point **points)
+{
+  waypoints.assign(*points, *points + saved.waypointCount);
+  *points += saved.waypointCount;
+  steps.assign(*points, *points + saved.stepCount);
+  *points += saved.stepCount;
+  cost = saved.cost;
+  leg = saved.leg;
+  step = saved.step;
+}
+
+struct AbstractNode
+{
+  int g;
+  int parent;
+  bool closed;
+};
+
+// Node state for one search at a time. Clusters (or sectors) get a block of
+// it the first time a search reaches them, tagged with the search's stamp,
+// so starting a search costs nothing however big the world is.
+struct NodeStates
+{
+  int blockSize;
+  vector<uint32_t> stamps;
+  vector<int> slots;
+  uint32_t stamp = 0;
+  vector<AbstractNode> nodes;
+  int slotCount = 0;
+
+  AbstractNode *Get(int id)
+  {
+    int block = id / blockSize;
+    if (stamps[block] != stamp)
+    {
+      stamps[block] = stamp;
+      slots[block] = slotCount++;
+      if ((size_t)slotCount * blockSize > nodes.size())
+      {
+        nodes.resize((size_t)slotCount * blockSize * 2);
+      }
+      fill_n(nodes.begin() + (size_t)slots[block] * blockSize, blockSize,
+             AbstractNode{g : INT_MAX, parent : START_NODE, closed : false});
+    }
+    return &nodes[(size_t)slots[block] * blockSize + id % blockSize];
+  }
+
+  void Begin(int blockCount)
+  {
+    if (stamps.size() != (size_t)blockCount || ++stamp == 0)
+    {
+      stamps.assign(blockCount, 0);
+      slots.resize(blockCount);
+      stamp = 1;
+    }
+    slotCount = 0;
+  }
+
+  size_t MemoryUsage() const
+  {
+    return nodes.capacity() * sizeof(AbstractNode) + stamps.capacity() * (sizeof(uint32_t) + sizeof(int));
+  }
+};
+
+// Scratch memory for one search at a time, so worker threads can search in
+// parallel and nothing is allocated once it has grown to fit.
+struct Pathfinder::SearchContext
+{
+  // Inside one cluster
+  int dist[CLUSTER_AREA];
+  int parent[CLUSTER_AREA];
+  // A tile is queued at most once per neighbour that improves it.
+  int buckets[COST_BUCKETS][CLUSTER_AREA * 4];
+  int bucketSizes[COST_BUCKETS];
+
+  // Over the graph: ids are cluster * MAX_CLUSTER_NODES + node, or sector *
+  // MAX_SECTOR_ENTRANCES + entrance.
+  NodeStates clusterNodes = {blockSize : MAX_CLUSTER_NODES};
+  NodeStates sectorNodes = {blockSize : MAX_SECTOR_ENTRANCES};
+  vector<pair<int, int>> heap;
+  int startDist[MAX_CLUSTER_NODES];
+  int goalDist[MAX_CLUSTER_NODES];
+  int goalEntranceDist[MAX_SECTOR_ENTRANCES];
+  vector<int> entrancePath;
+  vector<int> nodePath;
+
+  // Starts a search over nodes, with nothing queued.
+  void BeginSearch(NodeStates *nodes, int blockCount)
+  {
+    nodes->Begin(blockCount);
+    heap.clear();
+  }
+
+  // Offers node id a cost of g by way of parent, queued at f.
+  void Relax(NodeStates *nodes, int id, int g, int f, int parent)
+  {
+    AbstractNode *node = nodes->Get(id);
+    if (node->closed || g >= node->g)
+    {
+      return;
+    }
+    node->g = g;
+    node->parent = parent;
+    heap.push_back({f, id});
+    push_heap(heap.begin(), heap.end(), greater<>());
+  }
+
+  pair<int, int> Pop()
+  {
+    pop_heap(heap.begin(), heap.end(), greater<>());
+    pair<int, int> top = heap.back();
+    heap.pop_back();
+    return top;
+  }
+};
+
+Pathfinder::Pathfinder(const World *world, int threads, const string &cachePath)
+    : world(world),
+      clustersW(world->GetChunksW()),
+      clustersH(world->GetChunksH()),
+      clusters((size_t)clustersW * clustersH),
+      sectorsW((clustersW + SECTOR_CHUNKS - 1) / SECTOR_CHUNKS),
+      sectorsH((clustersH + SECTOR_CHUNKS - 1) / SECTOR_CHUNKS),
+      sectors((size_t)sectorsW * sectorsH),
+      worldRevision(world->GetRevision()),
+      dirty((size_t)clustersW * clustersH, false),
+      sectorDirty(sectors.size(), false)
+{
+  if (threads <= 0)
+  {
+    threads = max(1, (int)thread::hardware_concurrency());
+  }
+  for (int i = 0; i < threads; i++)
+  {
+    contexts.push_back(make_unique<SearchContext>());
+    // A nearby route goes through at most every node it searched, so the
+    // ones walkers ask for fit without growing this mid-game.
+    contexts.back()->nodePath.reserve(MAX_NEAR_NODES);
+  }
+  // The calling thread always does the first share itself.
+  for (int worker = 1; worker < threads; worker++)
+  {
+    workers.emplace_back(&Pathfinder::WorkerLoop, this, worker);
+  }
+
+  // Generated worlds have no file to tell whether a cache is theirs.
+  bool cacheable = !cachePath.empty() && world->GetFileStamp() != 0;
+  if (cacheable && ReadGraph(cachePath))
+  {
+    cached = true;
+    worldRevision = 0;
+    return;
+  }
+  vector<int> all(clusters.size());
+  for (int cluster = 0; cluster < (int)clusters.size(); cluster++)
+  {
+    all[cluster] = cluster;
+  }
+  RebuildClusters(all);
+  FindLandmarks();
+  if (cacheable && world->GetRevision() == 0)
+  {
+    WriteGraph(cachePath);
+  }
+}
+
+Pathfinder::~Pathfinder()
+{
+  {
+    lock_guard<mutex> guard(workLock);
+    workersStopping = true;
+  }
+  workAvailable.notify_all();
+  for (thread &worker : workers)
+  {
+    worker.join();
+  }
+}
+
+int Pathfinder::TileCost(int x, int y) const
+{
+  return TILE_MOVE_COSTS[world->Get(x, y)];
+}
+
+template <typename Work>
+void Pathfinder::ParallelFor(int count, int minPerThread, Work work)
+{
+  int threads = min((int)contexts.size(), count / max(1, minPerThread));
+  if (threads < 2)
+  {
+    work(contexts[0].get(), 0, count);
+    return;
+  }
+  {
+    lock_guard<mutex> guard(workLock);
+    job = {
+      run : [](const void *work, SearchContext *context, int first, int last)
+      { (*(const Work *)work)(context, first, last); },
+      work : &work,
+      count : count,
+      threads : threads};
+    jobNumber++;
+    workersBusy = threads - 1;
+  }
+  workAvailable.notify_all();
+  work(contexts[0].get(), 0, count / threads);
+  unique_lock<mutex> guard(workLock);
+  workFinished.wait(guard, [this]
+                    { return workersBusy == 0; });
+}
+
+void Pathfinder::WorkerLoop(int worker)
+{
+  // A job is only replaced once every worker it uses is done with it, so
+  // skipping ahead can only skip jobs this worker had no share in.
+  unsigned int lastJob = 0;
+  while (true)
+  {
+    Job current;
+    {
+      unique_lock<mutex> guard(workLock);
+      workAvailable.wait(guard, [this, lastJob]
+                         { return workersStopping || jobNumber != lastJob; });
+      if (workersStopping)
+      {
+        return;
+      }
+      lastJob = jobNumber;
+      current = job;
+    }
+    if (worker >= current.threads)
+    {
+      continue;
+    }
+
+    current.run(current.work, contexts[worker].get(), current.count * worker / current.threads,
+                current.count * (worker + 1) / current.threads);
+    lock_guard<mutex> guard(workLock);
+    if (--workersBusy == 0)
+    {
+      workFinished.notify_one();
+    }
+  }
+}
+
+void Pathfinder::Update()
+{
+  if (world->GetRevision() == worldRevision)
+  {
+    return;
+  }
+
+  changedChunks.clear();
+  if (world->GetChangedChunks(worldRevision, &changedChunks))
+  {
+    for (size_t chunk : changedChunks)
+    {
+      MarkDirty(chunk % clustersW, chunk / clustersW);
+    }
+  }
+  else
+  {
+    // Too much changed to list, so look at every chunk.
+    for (int cy = 0; cy < clustersH; cy++)
+    {
+      for (int cx = 0; cx < clustersW; cx++)
+      {
+        if (clusters[cy * clustersW + cx].revision != world->GetChunkRevision(cx, cy))
+        {
+          MarkDirty(cx, cy);
+        }
+      }
+    }
+  }
+  worldRevision = world->GetRevision();
+
+  RebuildClusters(rebuild);
+  for (int cluster : rebuild)
+  {
+    dirty[cluster] = false;
+  }
+  rebuild.clear();
+}
+
+void Pathfinder::MarkDirty(int cx, int cy)
+{
+  const SDL_Point around[5] = {{x : 0, y : 0}, {x : -1, y : 0}, {x : 1, y : 0}, {x : 0, y : -1}, {x : 0, y : 1}};
+  for (const SDL_Point &offset : around)
+  {
+    int x = cx + offset.x, y = cy + offset.y;
+    if (x >= 0 && y >= 0 && x < clustersW && y < clustersH && !dirty[y * clustersW + x])
+    {
+      dirty[y * clustersW + x] = true;
+      rebuild.push_back(y * clustersW + x);
+    }
+  }
+}
+
+void Pathfinder::RebuildClusters(const vector<int> &rebuild)
+{
+  auto start = chrono::steady_clock::now();
+  ParallelFor(rebuild.size(), 64, [this, &rebuild](SearchContext *context, int first, int last)
+              {
+    for (int i = first; i < last; i++)
+    {
+      BuildCluster(context, rebuild[i]);
+    } });
+  // A sector's entrances and costs only depend on its own clusters, and on
+  // which crossings open onto the neighbours' facing ones. A rebuilt cluster
+  // may number its nodes differently, and the sectors beside it hold those
+  // numbers for what their entrances face, so they are rebuilt too.
+  const SDL_Point around[5] = {{x : 0, y : 0}, {x : -1, y : 0}, {x : 1, y : 0}, {x : 0, y : -1}, {x : 0, y : 1}};
+  for (int cluster : rebuild)
+  {
+    for (const SDL_Point &offset : around)
+    {
+      int x = cluster % clustersW + offset.x, y = cluster / clustersW + offset.y;
+      if (x < 0 || y < 0 || x >= clustersW || y >= clustersH)
+      {
+        continue;
+      }
+      int sector = SectorOf(y * clustersW + x);
+      if (!sectorDirty[sector])
+      {
+        sectorDirty[sector] = true;
+        rebuildSectors.push_back(sector);
+      }
+    }
+  }
+  ParallelFor(rebuildSectors.size(), 16, [this](SearchContext *context, int first, int last)
+              {
+    for (int i = first; i < last; i++)
+    {
+      BuildSector(context, rebuildSectors[i]);
+    } });
+  for (int sector : rebuildSectors)
+  {
+    sectorDirty[sector] = false;
+  }
+  rebuildSectors.clear();
+  lastRebuiltClusters = rebuild.size();
+  componentsDirty = true;
+  lastRebuildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+void Pathfinder::BuildCluster(SearchContext *context, int index)
+{
+  Cluster &cluster = clusters[index];
+  int cx = index % clustersW, cy = index / clustersW;
+  int originX = cx * CHUNK_TILES, originY = cy * CHUNK_TILES;
+  cluster.revision = world->GetChunkRevision(cx, cy);
+
+  // Each run of tiles walkable on both sides of a border gets one crossing,
+  // in its middle. Both clusters pick the same spot, so their nodes face
+  // each other.
+  int localTiles[4 * CHUNK_TILES];
+  int localCount = 0;
+  const SDL_Point sides[4] = {{x : -1, y : 0}, {x : 1, y : 0}, {x : 0, y : -1}, {x : 0, y : 1}};
+  for (const SDL_Point &side : sides)
+  {
+    if (!world->IsChunkInWorld(cx + side.x, cy + side.y))
+    {
+      continue;
+    }
+    int runStart = -1;
+    for (int i = 0; i <= CHUNK_TILES; i++)
+    {
+      // The tile on this side of the border and the one across it.
+      int lx = side.x == 0 ? i : (side.x < 0 ? 0 : CHUNK_TILES - 1);
+      int ly = side.y == 0 ? i : (side.y < 0 ? 0 : CHUNK_TILES - 1);
+      bool open = i < CHUNK_TILES &&
+                  TileCost(originX + lx, originY + ly) > 0 &&
+                  TileCost(originX + lx + side.x, originY + ly + side.y) > 0;
+      if (open && runStart < 0)
+      {
+        runStart = i;
+      }
+      else if (!open && runStart >= 0)
+      {
+        int middle = runStart + (i - 1 - runStart) / 2;
+        localTiles[localCount++] = side.x == 0 ? (ly << CLUSTER_SHIFT) | middle : (middle << CLUSTER_SHIFT) | lx;
+        runStart = -1;
+      }
+    }
+  }
+  sort(localTiles, localTiles + localCount);
+  localCount = unique(localTiles, localTiles + localCount) - localTiles;
+  cluster.nodeCount = localCount;
+  for (int i = 0; i < localCount; i++)
+  {
+    cluster.nodes[i] = localTiles[i];
+  }
+
+  // A path walked backwards costs the same minus the tile it now starts on
+  // plus the one it now ends on, so searching from each node to the nodes
+  // after it is enough.
+  const Tile *tiles = world->GetChunk(cx, cy);
+  cluster.costs.assign(localCount * localCount, UNREACHABLE_COST);
+  bitset<CLUSTER_AREA> laterNodes;
+  for (int i = 0; i < localCount; i++)
+  {
+    laterNodes.set(cluster.nodes[i]);
+  }
+  for (int i = 0; i < localCount; i++)
+  {
+    laterNodes.reset(cluster.nodes[i]);
+    if (laterNodes.none())
+    {
+      break;
+    }
+    SearchCluster(context, index, cluster.nodes[i], false, laterNodes);
+    for (int j = i + 1; j < localCount; j++)
+    {
+      int dist = context->dist[cluster.nodes[j]];
+      if (dist != INT_MAX)
+      {
+        cluster.costs[i * localCount + j] = dist;
+        cluster.costs[j * localCount + i] = dist - TILE_MOVE_COSTS[tiles[cluster.nodes[j]] & TILE_MASK] + TILE_MOVE_COSTS[tiles[cluster.nodes[i]] & TILE_MASK];
+      }
+    }
+  }
+
+  // Nodes that can reach each other inside the cluster share a region.
+  cluster.regionCount = 0;
+  fill(cluster.regions, cluster.regions + localCount, UINT8_MAX);
+  for (int i = 0; i < localCount; i++)
+  {
+    if (cluster.regions[i] != UINT8_MAX)
+    {
+      continue;
+    }
+    for (int j = i; j < localCount; j++)
+    {
+      if (j == i || cluster.costs[i * localCount + j] != UNREACHABLE_COST)
+      {
+        cluster.regions[j] = cluster.regionCount;
+      }
+    }
+    cluster.regionCount++;
+  }
+}
+
+void Pathfinder::BuildSector(SearchContext *context, int index)
+{
+  Sector &sector = sectors[index];
+  int sx = index % sectorsW, sy = index / sectorsW;
+  sector.entrances.clear();
+  sector.tiles.clear();
+  sector.across.clear();
+  sector.acrossCosts.clear();
+  // Landmark costs are only worked out over the whole graph; a sector
+  // rebuilt since goes by the straight line.
+  sector.landmarkCosts.clear();
+  for (int cy = sy * SECTOR_CHUNKS; cy < min((sy + 1) * SECTOR_CHUNKS, clustersH); cy++)
+  {
+    for (int cx = sx * SECTOR_CHUNKS; cx < min((sx + 1) * SECTOR_CHUNKS, clustersW); cx++)
+    {
+      int cluster = cy * clustersW + cx;
+      for (int i = 0; i < clusters[cluster].nodeCount; i++)
+      {
+        int node = cluster * MAX_CLUSTER_NODES + i;
+        int faced = 0;
+        ForEachCrossing(node, [&](int across, int cost)
+                        {
+          if (SectorOf(across / MAX_CLUSTER_NODES) != index)
+          {
+            if (faced++ == 0)
+            {
+              sector.entrances.push_back(node);
+              sector.tiles.push_back(NodeTile(node));
+            }
+            sector.across.push_back(across);
+            sector.acrossCosts.push_back(cost);
+          } });
+        if (faced == 1)
+        {
+          sector.across.push_back(-1);
+          sector.acrossCosts.push_back(0);
+        }
+      }
+    }
+  }
+
+  int count = sector.entrances.size();
+  sector.costs.assign(count * count, UNREACHABLE_COST);
+  for (int i = 0; i < count; i++)
+  {
+    context->BeginSearch(&context->clusterNodes, clusters.size());
+    context->Relax(&context->clusterNodes, sector.entrances[i], 0, 0, START_NODE);
+    SearchSector(context, index, false, -1);
+    for (int j = 0; j < count; j++)
+    {
+      int g = context->clusterNodes.Get(sector.entrances[j])->g;
+      if (g != INT_MAX)
+      {
+        sector.costs[i * count + j] = g / COST_UNIT;
+      }
+    }
+  }
+}
+
+void Pathfinder::FindLandmarks()
+{
+  int right = clustersW * CHUNK_TILES - 1, bottom = clustersH * CHUNK_TILES - 1;
+  const SDL_Point spots[LANDMARKS] = {{x : 0, y : 0}, {x : right / 2, y : 0}, {x : right, y : 0},
+                                      {x : right, y : bottom / 2}, {x : right, y : bottom},
+                                      {x : right / 2, y : bottom}, {x : 0, y : bottom}, {x : 0, y : bottom / 2}};
+  int landmarks[LANDMARKS];
+  int closest[LANDMARKS];
+  fill_n(landmarks, LANDMARKS, -1);
+  fill_n(closest, LANDMARKS, INT_MAX);
+  for (int index = 0; index < (int)sectors.size(); index++)
+  {
+    const Sector &sector = sectors[index];
+    for (int k = 0; k < (int)sector.entrances.size(); k++)
+    {
+      for (int l = 0; l < LANDMARKS; l++)
+      {
+        int distance = abs(sector.tiles[k].x - spots[l].x) + abs(sector.tiles[k].y - spots[l].y);
+        if (distance < closest[l])
+        {
+          closest[l] = distance;
+          landmarks[l] = index * MAX_SECTOR_ENTRANCES + k;
+        }
+      }
+    }
+  }
+  // No entrances at all, as in a world still to be generated.
+  if (landmarks[0] < 0)
+  {
+    return;
+  }
+  for (Sector &sector : sectors)
+  {
+    sector.landmarkCosts.assign(sector.entrances.size() * LANDMARKS, INT_MAX);
+  }
+
+  // Dijkstra from each landmark, keeping the costs in the tables themselves.
+  ParallelFor(LANDMARKS, 1, [this, &landmarks](SearchContext *context, int first, int last)
+              {
+    for (int l = first; l < last; l++)
+    {
+      auto costOf = [this, l](int id) -> int &
+      {
+        return sectors[id / MAX_SECTOR_ENTRANCES].landmarkCosts[id % MAX_SECTOR_ENTRANCES * LANDMARKS + l];
+      };
+      context->heap.clear();
+      costOf(landmarks[l]) = 0;
+      context->heap.push_back({0, landmarks[l]});
+      while (!context->heap.empty())
+      {
+        auto [g, id] = context->Pop();
+        if (g > costOf(id))
+        {
+          continue;
+        }
+        ForEachSectorEdge(id, [&](int next, int cost)
+                          {
+          if (g + cost < costOf(next))
+          {
+            costOf(next) = g + cost;
+            context->heap.push_back({g + cost, next});
+            push_heap(context->heap.begin(), context->heap.end(), greater<>());
+          } });
+      }
+    } });
+}
+
+bool Pathfinder::ReadGraph(const string &path)
+{
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL)
+  {
+    return false;
+  }
+  PathGraphHeader header;
+  vector<char> data;
+  bool read = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, PATH_GRAPH_MAGIC, sizeof(header.magic)) == 0 &&
+              header.version == PATH_GRAPH_VERSION && header.worldStamp == world->GetFileStamp() &&
+              header.clustersW == (uint32_t)clustersW && header.clustersH == (uint32_t)clustersH &&
+              header.chunkTiles == CHUNK_TILES && header.sectorChunks == SECTOR_CHUNKS &&
+              header.landmarks == LANDMARKS && header.dataSize < ((uint64_t)1 << 32);
+  if (read)
+  {
+    data.resize(header.dataSize);
+    read = fread(data.data(), 1, data.size(), file) == data.size();
+  }
+  fclose(file);
+  if (!read)
+  {
+    return false;
+  }
+
+  // Cheap checks that everything the searches index with stays in range.
+  const char *at = data.data(), *end = data.data() + data.size();
+  auto take = [&at, end](void *out, size_t size)
+  {
+    if ((size_t)(end - at) < size)
+    {
+      return false;
+    }
+    // An empty vector's data() may be NULL.
+    if (size > 0)
+    {
+      memcpy(out, at, size);
+    }
+    at += size;
+    return true;
+  };
+  bool valid = true;
+  for (Cluster &cluster : clusters)
+  {
+    uint8_t counts[2];
+    valid = take(counts, sizeof(counts)) && counts[0] <= MAX_CLUSTER_NODES && counts[1] <= counts[0] &&
+            take(cluster.nodes, counts[0]) && take(cluster.regions, counts[0]);
+    if (!valid)
+    {
+      break;
+    }
+    cluster.revision = 0;
+    cluster.nodeCount = counts[0];
+    cluster.regionCount = counts[1];
+    cluster.costs.resize(counts[0] * counts[0]);
+    valid = take(cluster.costs.data(), cluster.costs.size() * sizeof(uint16_t));
+    for (int i = 0; i < cluster.nodeCount && valid; i++)
+    {
+      valid = cluster.regions[i] < cluster.regionCount && (i == 0 || cluster.nodes[i] > cluster.nodes[i - 1]);
+    }
+    if (!valid)
+    {
+      break;
+    }
+  }
+  auto isNode = [this](int node)
+  {
+    return node >= 0 && node / MAX_CLUSTER_NODES < (int)clusters.size() &&
+           node % MAX_CLUSTER_NODES < clusters[node / MAX_CLUSTER_NODES].nodeCount;
+  };
+  for (int index = 0; index < (int)sectors.size() && valid; index++)
+  {
+    Sector &sector = sectors[index];
+    uint32_t counts[2];
+    valid = take(counts, sizeof(counts)) && counts[0] <= MAX_SECTOR_ENTRANCES &&
+            (counts[1] == 0 || counts[1] == counts[0] * LANDMARKS);
+    if (!valid)
+    {
+      break;
+    }
+    sector.entrances.resize(counts[0]);
+    sector.across.resize(counts[0] * 2);
+    sector.acrossCosts.resize(counts[0] * 2);
+    sector.costs.resize(counts[0] * counts[0]);
+    sector.landmarkCosts.resize(counts[1]);
+    valid = take(sector.entrances.data(), sector.entrances.size() * sizeof(int)) &&
+            take(sector.across.data(), sector.across.size() * sizeof(int)) &&
+            take(sector.acrossCosts.data(), sector.acrossCosts.size()) &&
+            take(sector.costs.data(), sector.costs.size() * sizeof(uint16_t)) &&
+            take(sector.landmarkCosts.data(), sector.landmarkCosts.size() * sizeof(int)) &&
+            all_of(sector.landmarkCosts.begin(), sector.landmarkCosts.end(), [](int cost)
+                   { return cost >= 0; });
+    sector.tiles.clear();
+    for (int k = 0; k < (int)counts[0] && valid; k++)
+    {
+      int node = sector.entrances[k];
+      valid = isNode(node) && SectorOf(node / MAX_CLUSTER_NODES) == index &&
+              (k == 0 || node > sector.entrances[k - 1]) && isNode(sector.across[k * 2]) &&
+              (sector.across[k * 2 + 1] == -1 || isNode(sector.across[k * 2 + 1]));
+      if (valid)
+      {
+        sector.tiles.push_back(NodeTile(node));
+      }
+    }
+  }
+  // Only now can the entrances each one faces be looked up.
+  for (int index = 0; index < (int)sectors.size() && valid; index++)
+  {
+    for (int across : sectors[index].across)
+    {
+      int acrossSector = across >= 0 ? SectorOf(across / MAX_CLUSTER_NODES) : -1;
+      if (across >= 0 && (acrossSector == index || FindEntrance(acrossSector, across) < 0))
+      {
+        valid = false;
+        break;
+      }
+    }
+  }
+  if (!valid || at != end)
+  {
+    printf("%s is damaged, rebuilding the path graph\n", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void Pathfinder::WriteGraph(const string &path) const
+{
+  vector<char> data;
+  auto put = [&data](const void *from, size_t size)
+  { data.insert(data.end(), (const char *)from, (const char *)from + size); };
+  for (const Cluster &cluster : clusters)
+  {
+    uint8_t counts[2] = {(uint8_t)cluster.nodeCount, (uint8_t)cluster.regionCount};
+    put(counts, sizeof(counts));
+    put(cluster.nodes, cluster.nodeCount);
+    put(cluster.regions, cluster.nodeCount);
+    put(cluster.costs.data(), cluster.costs.size() * sizeof(uint16_t));
+  }
+  for (const Sector &sector : sectors)
+  {
+    uint32_t counts[2] = {(uint32_t)sector.entrances.size(), (uint32_t)sector.landmarkCosts.size()};
+    put(counts, sizeof(counts));
+    put(sector.entrances.data(), sector.entrances.size() * sizeof(int));
+    put(sector.across.data(), sector.across.size() * sizeof(int));
+    put(sector.acrossCosts.data(), sector.acrossCosts.size());
+    put(sector.costs.data(), sector.costs.size() * sizeof(uint16_t));
+    put(sector.landmarkCosts.data(), sector.landmarkCosts.size() * sizeof(int));
+  }
+
+  FILE *file = fopen(path.c_str(), "wb");
+  if (file == NULL)
+  {
+    printf("Unable to write path graph cache %s\n", path.c_str());
+    return;
+  }
+  PathGraphHeader header = {};
+  memcpy(header.magic, PATH_GRAPH_MAGIC, sizeof(header.magic));
+  header.version = PATH_GRAPH_VERSION;
+  header.worldStamp = world->GetFileStamp();
+  header.clustersW = clustersW;
+  header.clustersH = clustersH;
+  header.chunkTiles = CHUNK_TILES;
+  header.sectorChunks = SECTOR_CHUNKS;
+  header.landmarks = LANDMARKS;
+  header.dataSize = data.size();
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(data.data(), 1, data.size(), file);
+  fclose(file);
+}
+
+void Pathfinder::LabelComponents()
+{
+  regionBases.resize(clusters.size());
+  int regionCount = 0;
+  for (int index = 0; index < (int)clusters.size(); index++)
+  {
+    regionBases[index] = regionCount;
+    regionCount += clusters[index].regionCount;
+  }
+  components.resize(regionCount);
+  iota(components.begin(), components.end(), 0);
+  auto find = [this](int region)
+  {
+    while (components[region] != region)
+    {
+      components[region] = components[components[region]];
+      region = components[region];
+    }
+    return region;
+  };
+
+  // Join regions across every right and bottom border crossing.
+  for (int index = 0; index < (int)clusters.size(); index++)
+  {
+    const Cluster &cluster = clusters[index];
+    int cx = index % clustersW, cy = index / clustersW;
+    for (int i = 0; i < cluster.nodeCount; i++)
+    {
+      int lx = cluster.nodes[i] & (CHUNK_TILES - 1), ly = cluster.nodes[i] >> CLUSTER_SHIFT;
+      int across = -1, neighbour = -1;
+      if (lx == CHUNK_TILES - 1 && cx + 1 < clustersW)
+      {
+        neighbour = index + 1;
+        across = FindNode(neighbour, ly << CLUSTER_SHIFT);
+        if (across >= 0)
+        {
+          int a = find(regionBases[index] + cluster.regions[i]), b = find(regionBases[neighbour] + clusters[neighbour].regions[across]);
+          components[max(a, b)] = min(a, b);
+        }
+      }
+      if (ly == CHUNK_TILES - 1 && cy + 1 < clustersH)
+      {
+        neighbour = index + clustersW;
+        across = FindNode(neighbour, lx);
+        if (across >= 0)
+        {
+          int a = find(regionBases[index] + cluster.regions[i]), b = find(regionBases[neighbour] + clusters[neighbour].regions[across]);
+          components[max(a, b)] = min(a, b);
+        }
+      }
+    }
+  }
+  for (int region = 0; region < regionCount; region++)
+  {
+    components[region] = find(region);
+  }
+  componentsDirty = false;
+}
+
+void Pathfinder::SearchCluster(SearchContext *context, int index, int source, bool reverse, const bitset<CLUSTER_AREA> &targets) const
+{
+  int targetsLeft = targets.count();
+  const Tile *tiles = world->GetChunk(index % clustersW, index / clustersW);
+  fill(context->dist, context->dist + CLUSTER_AREA, INT_MAX);
+  fill(context->bucketSizes, context->bucketSizes + COST_BUCKETS, 0);
+  context->dist[source] = 0;
+  context->parent[source] = -1;
+  context->buckets[0][context->bucketSizes[0]++] = source;
+  int pending = 1;
+
+  // Every cost is a small multiple of COST_UNIT, so a ring of buckets, one
+  // per distance, replaces the priority queue.
+  for (int step = 0; pending > 0; step++)
+  {
+    int *bucket = context->buckets[step % COST_BUCKETS];
+    int &bucketSize = context->bucketSizes[step % COST_BUCKETS];
+    for (int i = 0; i < bucketSize; i++)
+    {
+      int tile = bucket[i];
+      int dist = context->dist[tile];
+      if (dist != step * COST_UNIT)
+      {
+        continue;
+      }
+      if (targets[tile] && --targetsLeft == 0)
+      {
+        return;
+      }
+      int x = tile & (CHUNK_TILES - 1), y = tile >> CLUSTER_SHIFT;
+      // Tiles past the world's edge are water padding, so the chunk's own
+      // tiles are enough.
+      const int neighbours[4] = {x > 0 ? tile - 1 : -1, x < CHUNK_TILES - 1 ? tile + 1 : -1,
+                                 y > 0 ? tile - CHUNK_TILES : -1, y < CHUNK_TILES - 1 ? tile + CHUNK_TILES : -1};
+      int leaveCost = TILE_MOVE_COSTS[tiles[tile] & TILE_MASK];
+      for (int next : neighbours)
+      {
+        if (next < 0 || TILE_MOVE_COSTS[tiles[next] & TILE_MASK] == 0)
+        {
+          continue;
+        }
+        int nextDist = dist + (reverse ? leaveCost : TILE_MOVE_COSTS[tiles[next] & TILE_MASK]);
+        if (nextDist < context->dist[next])
+        {
+          context->dist[next] = nextDist;
+          context->parent[next] = tile;
+          int nextBucket = nextDist / COST_UNIT % COST_BUCKETS;
+          context->buckets[nextBucket][context->bucketSizes[nextBucket]++] = next;
+          pending++;
+        }
+      }
+    }
+    pending -= bucketSize;
+    bucketSize = 0;
+  }
+}
+
+int Pathfinder::FindNode(int index, int localTile) const
+{
+  const Cluster &cluster = clusters[index];
+  for (int i = 0; i < cluster.nodeCount; i++)
+  {
+    if (cluster.nodes[i] == localTile)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int Pathfinder::FindEntrance(int sector, int node) const
+{
+  const vector<int> &entrances = sectors[sector].entrances;
+  auto found = lower_bound(entrances.begin(), entrances.end(), node);
+  return found != entrances.end() && *found == node ? found - entrances.begin() : -1;
+}
+
+int Pathfinder::SectorOf(int cluster) const
+{
+  return cluster / clustersW / SECTOR_CHUNKS * sectorsW + cluster % clustersW / SECTOR_CHUNKS;
+}
+
+SDL_Point Pathfinder::NodeTile(int node) const
+{
+  int index = node / MAX_CLUSTER_NODES;
+  int local = clusters[index].nodes[node % MAX_CLUSTER_NODES];
+  return {x : index % clustersW * CHUNK_TILES + (local & (CHUNK_TILES - 1)),
+          y : index / clustersW * CHUNK_TILES + (local >> CLUSTER_SHIFT)};
+}
+
+template <typename Visit>
+void Pathfinder::ForEachCrossing(int node, Visit visit) const
+{
+  const SDL_Point sides[4] = {{x : -1, y : 0}, {x : 1, y : 0}, {x : 0, y : -1}, {x : 0, y : 1}};
+  int index = node / MAX_CLUSTER_NODES;
+  SDL_Point tile = NodeTile(node);
+  int lx = tile.x & (CHUNK_TILES - 1), ly = tile.y & (CHUNK_TILES - 1);
+  for (const SDL_Point &side : sides)
+  {
+    int nx = lx + side.x, ny = ly + side.y;
+    if (nx >= 0 && nx < CHUNK_TILES && ny >= 0 && ny < CHUNK_TILES)
+    {
+      continue;
+    }
+    int ncx = index % clustersW + side.x, ncy = index / clustersW + side.y;
+    if (!world->IsChunkInWorld(ncx, ncy))
+    {
+      continue;
+    }
+    int neighbour = ncy * clustersW + ncx;
+    int across = FindNode(neighbour, ((ny & (CHUNK_TILES - 1)) << CLUSTER_SHIFT) | (nx & (CHUNK_TILES - 1)));
+    if (across >= 0)
+    {
+      visit(neighbour * MAX_CLUSTER_NODES + across, TileCost(tile.x + side.x, tile.y + side.y));
+    }
+  }
+}
+
+template <typename Visit>
+void Pathfinder::ForEachEdge(int node, int sector, bool reverse, Visit visit) const
+{
+  int index = node / MAX_CLUSTER_NODES, local = node % MAX_CLUSTER_NODES;
+  const Cluster &cluster = clusters[index];
+  for (int j = 0; j < cluster.nodeCount; j++)
+  {
+    uint16_t cost = reverse ? cluster.costs[j * cluster.nodeCount + local] : cluster.costs[local * cluster.nodeCount + j];
+    if (j != local && cost != UNREACHABLE_COST)
+    {
+      visit(index * MAX_CLUSTER_NODES + j, cost);
+    }
+  }
+  // Walked backwards, a crossing costs stepping onto this side instead.
+  int ownCost = 0;
+  if (reverse)
+  {
+    SDL_Point tile = NodeTile(node);
+    ownCost = TileCost(tile.x, tile.y);
+  }
+  ForEachCrossing(node, [&](int across, int cost)
+                  {
+    if (sector < 0 || SectorOf(across / MAX_CLUSTER_NODES) == sector)
+    {
+      visit(across, reverse ? ownCost : cost);
+    } });
+}
+
+template <typename Visit>
+void Pathfinder::ForEachSectorEdge(int id, Visit visit) const
+{
+  int index = id / MAX_SECTOR_ENTRANCES, local = id % MAX_SECTOR_ENTRANCES;
+  const Sector &sector = sectors[index];
+  int count = sector.entrances.size();
+  for (int j = 0; j < count; j++)
+  {
+    uint16_t cost = sector.costs[local * count + j];
+    if (j != local && cost != UNREACHABLE_COST)
+    {
+      visit(index * MAX_SECTOR_ENTRANCES + j, cost * COST_UNIT);
+    }
+  }
+  for (int side = local * 2; side < local * 2 + 2 && sector.across[side] >= 0; side++)
+  {
+    int across = sector.across[side], acrossSector = SectorOf(across / MAX_CLUSTER_NODES);
+    visit(acrossSector * MAX_SECTOR_ENTRANCES + FindEntrance(acrossSector, across), sector.acrossCosts[side]);
+  }
+}
+
+void Pathfinder::SeedCluster(SearchContext *context, int cluster, const int *dist, int parent, int target) const
+{
+  for (int i = 0; i < clusters[cluster].nodeCount; i++)
+  {
+    if (dist[i] != INT_MAX)
+    {
+      int node = cluster * MAX_CLUSTER_NODES + i;
+      context->Relax(&context->clusterNodes, node, dist[i], dist[i] + EstimateCost(node, target), parent);
+    }
+  }
+}
+
+int Pathfinder::EstimateCost(int node, int target) const
+{
+  if (target < 0)
+  {
+    return 0;
+  }
+  SDL_Point from = NodeTile(node), to = NodeTile(target);
+  return (abs(from.x - to.x) + abs(from.y - to.y)) * MIN_TILE_MOVE_COST;
+}
+
+void Pathfinder::SearchSector(SearchContext *context, int sector, bool reverse, int target) const
+{
+  while (!context->heap.empty())
+  {
+    int id = context->Pop().second;
+    AbstractNode *node = context->clusterNodes.Get(id);
+    if (node->closed)
+    {
+      continue;
+    }
+    node->closed = true;
+    if (id == target)
+    {
+      return;
+    }
+    int g = node->g;
+    ForEachEdge(id, sector, reverse, [this, context, g, id, target](int next, int cost)
+                { context->Relax(&context->clusterNodes, next, g + cost, g + cost + EstimateCost(next, target), id); });
+  }
+}
+
+void Pathfinder::AppendNodePath(SearchContext *context, int node, bool reverse, vector<int> *out) const
+{
+  // Searched forwards, parents lead back to a seed; reversed, on to one.
+  size_t first = out->size();
+  for (int id = node; id >= 0; id = context->clusterNodes.Get(id)->parent)
+  {
+    out->push_back(id);
+  }
+  if (!reverse)
+  {
+    std::reverse(out->begin() + first, out->end());
+  }
+  if (first > 0 && out->size() > first && (*out)[first] == (*out)[first - 1])
+  {
+    out->erase(out->begin() + first);
+  }
+}
+
+bool Pathfinder::FindPath(SDL_Point from, SDL_Point to, Path *path)
+{
+  Update();
+  if (componentsDirty)
+  {
+    LabelComponents();
+  }
+  return FindPathWith(contexts[0].get(), from, to, 0, path);
+}
+
+void Pathfinder::FindPaths(const PathRequest *requests, int count, Path *paths)
+{
+  Update();
+  if (componentsDirty)
+  {
+    LabelComponents();
+  }
+  ParallelFor(count, 16, [this, requests, paths](SearchContext *context, int first, int last)
+              {
+    for (int i = first; i < last; i++)
+    {
+      FindPathWith(context, requests[i].from, requests[i].to, requests[i].maxWaypoints, &paths[i]);
+    } });
+}
+
+bool Pathfinder::FindPathWith(SearchContext *context, SDL_Point from, SDL_Point to, int maxWaypoints, Path *path)
+{
+  path->Clear();
+  if (TileCost(from.x, from.y) == 0 || TileCost(to.x, to.y) == 0)
+  {
+    return false;
+  }
+  if (from.x == to.x && from.y == to.y)
+  {
+    path->waypoints.push_back(from);
+    return true;
+  }
+
+  int startCluster = (from.y >> CLUSTER_SHIFT) * clustersW + (from.x >> CLUSTER_SHIFT);
+  int goalCluster = (to.y >> CLUSTER_SHIFT) * clustersW + (to.x >> CLUSTER_SHIFT);
+  int startTile = ((from.y & (CHUNK_TILES - 1)) << CLUSTER_SHIFT) | (from.x & (CHUNK_TILES - 1));
+  int goalTile = ((to.y & (CHUNK_TILES - 1)) << CLUSTER_SHIFT) | (to.x & (CHUNK_TILES - 1));
+
+  // How far the goal is from each node of its cluster, and each node of the
+  // start's cluster from the start (and the goal, when both are in it).
+  const Cluster &goal = clusters[goalCluster];
+  SearchCluster(context, goalCluster, goalTile, true, {});
+  int goalComponent = -1, startComponent = -1;
+  for (int i = 0; i < goal.nodeCount; i++)
+  {
+    context->goalDist[i] = context->dist[goal.nodes[i]];
+    if (context->goalDist[i] != INT_MAX)
+    {
+      goalComponent = components[regionBases[goalCluster] + goal.regions[i]];
+    }
+  }
+  const Cluster &start = clusters[startCluster];
+  SearchCluster(context, startCluster, startTile, false, {});
+  for (int i = 0; i < start.nodeCount; i++)
+  {
+    context->startDist[i] = context->dist[start.nodes[i]];
+    if (context->startDist[i] != INT_MAX)
+    {
+      startComponent = components[regionBases[startCluster] + start.regions[i]];
+    }
+  }
+  int cost = INT_MAX;
+  if (startCluster == goalCluster && context->dist[goalTile] != INT_MAX)
+  {
+    cost = context->dist[goalTile];
+  }
+
+  // Without this, a goal on another island would only be ruled out after
+  // searching every node the start can reach.
+  context->nodePath.clear();
+  if (startComponent >= 0 && startComponent == goalComponent)
+  {
+    int startSector = SectorOf(startCluster), goalSector = SectorOf(goalCluster);
+    bool near = abs(startSector % sectorsW - goalSector % sectorsW) <= 1 &&
+                abs(startSector / sectorsW - goalSector / sectorsW) <= 1;
+    int found = near ? SearchNear(context, startCluster, goalCluster, to, cost) : -1;
+    cost = found >= 0 ? found : SearchFar(context, startCluster, goalCluster, to, cost);
+  }
+  if (cost == INT_MAX)
+  {
+    return false;
+  }
+
+  const vector<int> &nodes = context->nodePath;
+  if (maxWaypoints > 0 && (int)nodes.size() + 2 > maxWaypoints)
+  {
+    return false;
+  }
+  path->waypoints.push_back(from);
+  for (int id : nodes)
+  {
+    path->waypoints.push_back(NodeTile(id));
+  }
+  path->waypoints.push_back(to);
+  path->cost = cost;
+  return true;
+}
+
+int Pathfinder::SearchNear(SearchContext *context, int startCluster, int goalCluster, SDL_Point to, int directCost) const
+{
+  auto estimate = [this, to](int node)
+  {
+    SDL_Point tile = NodeTile(node);
+    return (abs(tile.x - to.x) + abs(tile.y - to.y)) * MIN_TILE_MOVE_COST * HEURISTIC_WEIGHT_PERCENT / 100;
+  };
+  int goalG = directCost, goalNode = START_NODE;
+  context->BeginSearch(&context->clusterNodes, clusters.size());
+  for (int i = 0; i < clusters[startCluster].nodeCount; i++)
+  {
+    if (context->startDist[i] != INT_MAX)
+    {
+      int id = startCluster * MAX_CLUSTER_NODES + i;
+      context->Relax(&context->clusterNodes, id, context->startDist[i], context->startDist[i] + estimate(id), START_NODE);
+    }
+  }
+  if (goalG != INT_MAX)
+  {
+    context->heap.push_back({goalG, GOAL_NODE});
+    push_heap(context->heap.begin(), context->heap.end(), greater<>());
+  }
+  for (int expanded = 0; !context->heap.empty();)
+  {
+    auto [f, id] = context->Pop();
+    if (id == GOAL_NODE)
+    {
+      if (f == goalG)
+      {
+        break;
+      }
+      continue;
+    }
+    AbstractNode *node = context->clusterNodes.Get(id);
+    if (node->closed)
+    {
+      continue;
+    }
+    if (++expanded > MAX_NEAR_NODES)
+    {
+      return -1;
+    }
+    node->closed = true;
+    int g = node->g;
+    int local = id % MAX_CLUSTER_NODES;
+    if (id / MAX_CLUSTER_NODES == goalCluster && context->goalDist[local] != INT_MAX &&
+        g + context->goalDist[local] < goalG)
+    {
+      goalG = g + context->goalDist[local];
+      goalNode = id;
+      context->heap.push_back({goalG, GOAL_NODE});
+      push_heap(context->heap.begin(), context->heap.end(), greater<>());
+    }
+    ForEachEdge(id, -1, false, [&](int next, int cost)
+                { context->Relax(&context->clusterNodes, next, g + cost, g + cost + estimate(next), id); });
+  }
+
+  if (goalNode != START_NODE)
+  {
+    AppendNodePath(context, goalNode, false, &context->nodePath);
+  }
+  return goalG;
+}
+
+int Pathfinder::SearchFar(SearchContext *context, int startCluster, int goalCluster, SDL_Point to, int directCost) const
+{
+  int startSector = SectorOf(startCluster), goalSector = SectorOf(goalCluster);
+  // The goal is reached through goalNode, the goal's sector through
+  // goalEntrance, or directly when both are START_NODE.
+  int goalG = directCost, goalNode = START_NODE, goalEntrance = START_NODE;
+
+  // From every entrance of the goal's sector to the goal, inside it.
+  const Sector &goalSide = sectors[goalSector];
+  context->BeginSearch(&context->clusterNodes, clusters.size());
+  SeedCluster(context, goalCluster, context->goalDist, GOAL_NODE, -1);
+  SearchSector(context, goalSector, true, -1);
+  for (int k = 0; k < (int)goalSide.entrances.size(); k++)
+  {
+    context->goalEntranceDist[k] = context->clusterNodes.Get(goalSide.entrances[k])->g;
+  }
+
+  // And from the start to every entrance of its own. Its parents are kept
+  // to walk back from whichever entrance the route leaves by.
+  context->BeginSearch(&context->clusterNodes, clusters.size());
+  SeedCluster(context, startCluster, context->startDist, START_NODE, -1);
+  SearchSector(context, startSector, false, -1);
+  if (startSector == goalSector)
+  {
+    for (int i = 0; i < clusters[goalCluster].nodeCount; i++)
+    {
+      int g = context->clusterNodes.Get(goalCluster * MAX_CLUSTER_NODES + i)->g;
+      if (g != INT_MAX && context->goalDist[i] != INT_MAX && g + context->goalDist[i] < goalG)
+      {
+        goalG = g + context->goalDist[i];
+        goalNode = goalCluster * MAX_CLUSTER_NODES + i;
+      }
+    }
+  }
+
+  // Then between the sectors, over their entrances. The goal is as far from
+  // each landmark as the cheapest way through an entrance of its sector.
+  int goalLandmarkCosts[LANDMARKS];
+  bool landmarks = !goalSide.landmarkCosts.empty();
+  for (int l = 0; l < LANDMARKS && landmarks; l++)
+  {
+    goalLandmarkCosts[l] = INT_MAX;
+    for (int k = 0; k < (int)goalSide.entrances.size(); k++)
+    {
+      int fromLandmark = goalSide.landmarkCosts[k * LANDMARKS + l];
+      if (fromLandmark != INT_MAX && context->goalEntranceDist[k] != INT_MAX)
+      {
+        goalLandmarkCosts[l] = min(goalLandmarkCosts[l], fromLandmark + context->goalEntranceDist[k]);
+      }
+    }
+  }
+  auto estimate = [&](int id)
+  {
+    const Sector &sector = sectors[id / MAX_SECTOR_ENTRANCES];
+    int local = id % MAX_SECTOR_ENTRANCES;
+    SDL_Point tile = sector.tiles[local];
+    int cost = (abs(tile.x - to.x) + abs(tile.y - to.y)) * MIN_TILE_MOVE_COST;
+    if (landmarks && !sector.landmarkCosts.empty())
+    {
+      // Walking back from a landmark costs what walking there does, give or
+      // take the difference between the two end tiles.
+      for (int l = 0; l < LANDMARKS; l++)
+      {
+        int fromLandmark = sector.landmarkCosts[local * LANDMARKS + l], goalFromLandmark = goalLandmarkCosts[l];
+        if (fromLandmark != INT_MAX && goalFromLandmark != INT_MAX)
+        {
+          cost = max({cost, goalFromLandmark - fromLandmark,
+                      fromLandmark - goalFromLandmark - (MAX_TILE_MOVE_COST - MIN_TILE_MOVE_COST)});
+        }
+      }
+    }
+    return cost * HEURISTIC_WEIGHT_PERCENT / 100;
+  };
+  const Sector &startSide = sectors[startSector];
+  context->BeginSearch(&context->sectorNodes, sectors.size());
+  for (int k = 0; k < (int)startSide.entrances.size(); k++)
+  {
+    int g = context->clusterNodes.Get(startSide.entrances[k])->g;
+    if (g != INT_MAX)
+    {
+      int id = startSector * MAX_SECTOR_ENTRANCES + k;
+      context->Relax(&context->sectorNodes, id, g, g + estimate(id), START_NODE);
+    }
+  }
+  if (goalG != INT_MAX)
+  {
+    context->heap.push_back({goalG, GOAL_NODE});
+    push_heap(context->heap.begin(), context->heap.end(), greater<>());
+  }
+  while (!context->heap.empty())
+  {
+    auto [f, id] = context->Pop();
+    if (id == GOAL_NODE)
+    {
+      if (f == goalG)
+      {
+        break;
+      }
+      continue;
+    }
+    AbstractNode *node = context->sectorNodes.Get(id);
+    if (node->closed)
+    {
+      continue;
+    }
+    node->closed = true;
+    int g = node->g;
+    int local = id % MAX_SECTOR_ENTRANCES;
+    if (id / MAX_SECTOR_ENTRANCES == goalSector && context->goalEntranceDist[local] != INT_MAX &&
+        g + context->goalEntranceDist[local] < goalG)
+    {
+      goalG = g + context->goalEntranceDist[local];
+      goalEntrance = id;
+      context->heap.push_back({goalG, GOAL_NODE});
+      push_heap(context->heap.begin(), context->heap.end(), greater<>());
+    }
+    ForEachSectorEdge(id, [&](int next, int cost)
+                      { context->Relax(&context->sectorNodes, next, g + cost, g + cost + estimate(next), id); });
+  }
+
+  // The nodes along the way, start to goal.
+  vector<int> &nodes = context->nodePath;
+  if (goalEntrance != START_NODE)
+  {
+    vector<int> &entrances = context->entrancePath;
+    entrances.clear();
+    for (int id = goalEntrance; id != START_NODE; id = context->sectorNodes.Get(id)->parent)
+    {
+      entrances.push_back(sectors[id / MAX_SECTOR_ENTRANCES].entrances[id % MAX_SECTOR_ENTRANCES]);
+    }
+    reverse(entrances.begin(), entrances.end());
+    // The start's search still has the way to the first entrance. Between
+    // two entrances of the same sector the way is searched again; between
+    // sectors it is one step.
+    AppendNodePath(context, entrances[0], false, &nodes);
+    for (size_t i = 1; i < entrances.size(); i++)
+    {
+      int sector = SectorOf(entrances[i] / MAX_CLUSTER_NODES);
+      if (sector != SectorOf(entrances[i - 1] / MAX_CLUSTER_NODES))
+      {
+        nodes.push_back(entrances[i]);
+        continue;
+      }
+      context->BeginSearch(&context->clusterNodes, clusters.size());
+      context->Relax(&context->clusterNodes, entrances[i - 1], 0, 0, START_NODE);
+      SearchSector(context, sector, false, entrances[i]);
+      AppendNodePath(context, entrances[i], false, &nodes);
+    }
+    // And the goal's search, run again, the rest of the way.
+    context->BeginSearch(&context->clusterNodes, clusters.size());
+    SeedCluster(context, goalCluster, context->goalDist, GOAL_NODE, entrances.back());
+    SearchSector(context, goalSector, true, entrances.back());
+    AppendNodePath(context, entrances.back(), true, &nodes);
+  }
+  else if (goalNode != START_NODE)
+  {
+    AppendNodePath(context, goalNode, false, &nodes);
+  }
+  return goalG;
+}
+
+bool Pathfinder::RefineLeg(SearchContext *context, SDL_Point from, SDL_Point to, vector<SDL_Point> *steps) const
+{
+  steps->clear();
+  if (from.x == to.x && from.y == to.y)
+  {
+    return true;
+  }
+  if (TileCost(to.x, to.y) == 0)
+  {
+    return false;
+  }
+  int fromCluster = (from.y >> CLUSTER_SHIFT) * clustersW + (from.x >> CLUSTER_SHIFT);
+  int toCluster = (to.y >> CLUSTER_SHIFT) * clustersW + (to.x >> CLUSTER_SHIFT);
+  if (fromCluster != toCluster)
+  {
+    // A border crossing, always a single step.
+    steps->push_back(to);
+    return true;
+  }
+
+  int fromTile = ((from.y & (CHUNK_TILES - 1)) << CLUSTER_SHIFT) | (from.x & (CHUNK_TILES - 1));
+  int toTile = ((to.y & (CHUNK_TILES - 1)) << CLUSTER_SHIFT) | (to.x & (CHUNK_TILES - 1));
+  SearchCluster(context, fromCluster, fromTile, false, bitset<CLUSTER_AREA>().set(toTile));
+  if (context->dist[toTile] == INT_MAX)
+  {
+    return false;
+  }
+  // Only the first PATH_MAX_STEPS; NextStep() comes back for the rest.
+  int length = 0;
+  for (int tile = toTile; tile != fromTile; tile = context->parent[tile])
+  {
+    length++;
+  }
+  int last = toTile;
+  for (int skip = length - PATH_MAX_STEPS; skip > 0; skip--)
+  {
+    last = context->parent[last];
+  }
+  int originX = to.x & ~(CHUNK_TILES - 1), originY = to.y & ~(CHUNK_TILES - 1);
+  for (int tile = last; tile != fromTile; tile = context->parent[tile])
+  {
+    steps->push_back({x : originX + (tile & (CHUNK_TILES - 1)), y : originY + (tile >> CLUSTER_SHIFT)});
+  }
+  reverse(steps->begin(), steps->end());
+  return true;
+}
+
+bool Pathfinder::NextStep(Path *path, SDL_Point *step)
+{
+  while (path->step >= (int)path->steps.size())
+  {
+    // Steps run up to the waypoint leg; a leg cut short at PATH_MAX_STEPS
+    // carries on from where its steps ended.
+    if (path->leg > 0 && !path->steps.empty() && (path->steps.back().x != path->waypoints[path->leg].x ||
+                                                  path->steps.back().y != path->waypoints[path->leg].y))
+    {
+      if (!RefineLeg(contexts[0].get(), path->steps.back(), path->waypoints[path->leg], &path->steps))
+      {
+        path->Clear();
+        return false;
+      }
+      path->step = 0;
+      continue;
+    }
+    if (path->leg + 1 >= (int)path->waypoints.size())
+    {
+      return false;
+    }
+    if (!RefineLeg(contexts[0].get(), path->waypoints[path->leg], path->waypoints[path->leg + 1], &path->steps))
+    {
+      path->Clear();
+      return false;
+    }
+    path->leg++;
+    path->step = 0;
+  }
+  *step = path->steps[path->step++];
+  return true;
+}
+
+PathfinderStats Pathfinder::GetStats() const
+{
+  PathfinderStats stats = {
+    clusters : (int)clusters.size(),
+    nodes : 0,
+    sectors : (int)sectors.size(),
+    sectorEntrances : 0,
+    memoryUsage : clusters.capacity() * sizeof(Cluster) + sectors.capacity() * sizeof(Sector),
+    cached : cached,
+    lastRebuiltClusters : lastRebuiltClusters,
+    lastRebuildMs : lastRebuildMs};
+  for (const Cluster &cluster : clusters)
+  {
+    stats.nodes += cluster.nodeCount;
+    stats.memoryUsage += cluster.costs.capacity() * sizeof(uint16_t);
+  }
+  for (const Sector &sector : sectors)
+  {
+    stats.sectorEntrances += sector.entrances.size();
+    stats.memoryUsage += sector.entrances.capacity() * sizeof(int) + sector.tiles.capacity() * sizeof(SDL_Point) +
+                         sector.across.capacity() * sizeof(int) + sector.acrossCosts.capacity() * sizeof(uint8_t) +
+                         sector.costs.capacity() * sizeof(uint16_t) + sector.landmarkCosts.capacity() * sizeof(int);
+  }
+  for (const unique_ptr<SearchContext> &context : contexts)
+  {
+    stats.memoryUsage += sizeof(SearchContext) + context->clusterNodes.MemoryUsage() + context->sectorNodes.MemoryUsage();
+  }
+  return stats;
+}
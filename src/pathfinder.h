@@ -0,0 +1,281 @@
+#pragma once
+
+#include <bitset>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SDL.h>
+#include "constants.h"
+#include "world.h"
+#include "save_state.h"
+
+using namespace std;
+
+// A border between two clusters opens in at most CHUNK_TILES / 2 separate
+// places, on each of the four sides.
+const int MAX_CLUSTER_NODES = 4 * CHUNK_TILES / 2;
+const int CLUSTER_AREA = CHUNK_TILES * CHUNK_TILES;
+// NextStep() fills in at most this many steps of a leg at a time, so a
+// path's steps never need more room than this.
+const int PATH_MAX_STEPS = 2 * CHUNK_TILES;
+
+// A route from Pathfinder::FindPath(). Only the crossings between clusters
+// are known up front; NextStep() fills in the tiles of one leg at a time as
+// the walker gets there.
+struct Path
+{
+  vector<SDL_Point> waypoints; // start, cluster crossings, goal; empty if none
+  int cost = 0;                // sum of TILE_MOVE_COSTS along the way
+  vector<SDL_Point> steps;     // next tiles of the current leg, at most PATH_MAX_STEPS
+  int leg = 0;
+  int step = 0;
+
+  bool IsEmpty() const;
+  // Keeps the vectors' memory for the next route.
+  void Clear();
+
+  // For save files: appends the waypoints and then the current leg's steps
+  // to points.
+  SaveRoute Save(vector<SDL_Point> *points) const;
+  // Puts back a saved path whose points start at *points, and moves
+  // *points past them.
+  void Load(const SaveRoute &saved, const SDL_Point **points);
+};
+
+struct PathRequest
+{
+  SDL_Point from, to;
+  // Routes with more waypoints than this count as not found, so a path
+  // reserved that big never grows. 0 for no limit.
+  int maxWaypoints;
+};
+
+// Path graph cache (.tbg), kept next to the world file the graph was built
+// from and read back instead of building it while that file is unchanged.
+// In the machine's own byte order:
+//   PathGraphHeader
+//   per cluster, row-major: uint8 nodeCount, uint8 regionCount,
+//     uint8 nodes[nodeCount], uint8 regions[nodeCount],
+//     uint16 costs[nodeCount * nodeCount]
+//   per sector, row-major: uint32 entranceCount, uint32 landmarkCostCount,
+//     int32 entrances[entranceCount], int32 across[entranceCount * 2],
+//     uint8 acrossCosts[entranceCount * 2],
+//     uint16 costs[entranceCount * entranceCount],
+//     int32 landmarkCosts[landmarkCostCount]
+const char PATH_GRAPH_MAGIC[4] = {'T', 'B', 'R', 'G'};
+const uint32_t PATH_GRAPH_VERSION = 1;
+
+struct PathGraphHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t worldStamp; // World::GetFileStamp() of the world it was built from
+  uint32_t clustersW, clustersH;
+  // How the graph was laid out; a cache from another layout is rebuilt.
+  uint32_t chunkTiles, sectorChunks, landmarks;
+  uint32_t reserved;
+  uint64_t dataSize; // bytes after the header
+};
+
+struct PathfinderStats
+{
+  int clusters;
+  int nodes; // cluster entrances
+  int sectors;
+  int sectorEntrances;
+  size_t memoryUsage;
+  bool cached; // read from the cache instead of built
+  int lastRebuiltClusters;
+  double lastRebuildMs;
+};
+
+// HPA*-style pathfinding over the world's tiles, on two levels. Each chunk
+// is a cluster; the tiles where a cluster's border can be crossed are the
+// nodes of an abstract graph, with the cost of walking between two nodes of
+// the same cluster worked out once ahead of time. Clusters are grouped into
+// sectors the same way, and the nodes on a sector's border are its
+// entrances, with the costs between them found over the nodes inside.
+// Nearby goals are searched for over the nodes. Further ones search the
+// entrances, guided by their costs from a few landmarks, then fill in the
+// nodes between them a sector at a time. On a 4096 x 4096 world a route
+// half-way across or more takes around half a millisecond, and one around
+// the worst detours ten or so (the bench's "long_paths" scene). Routes come
+// out near-optimal, not optimal.
+//
+// Editing tiles only rebuilds the edited chunks and their neighbours, found
+// through World::GetChangedChunks().
+class Pathfinder
+{
+public:
+  // Builds the whole graph. Rebuilds and batches of queries are split over
+  // threads threads (0 for one per core): the calling one and a pool kept
+  // for the pathfinder's lifetime. For a world opened from a file, a graph
+  // cached at cachePath for that file is read instead, and one built is
+  // saved there; edits made since the world was opened are caught up with
+  // by the first Update().
+  Pathfinder(const World *world, int threads = 0, const string &cachePath = "");
+  ~Pathfinder();
+
+  // Catches up with world edits. The queries below call it themselves.
+  void Update();
+
+  // False (and an empty path) if either end cannot be walked on or there
+  // is no way between them.
+  bool FindPath(SDL_Point from, SDL_Point to, Path *path);
+  // Answers count requests at once, split over the worker threads when there
+  // are enough of them. paths[i] is empty when requests[i] has no route.
+  void FindPaths(const PathRequest *requests, int count, Path *paths);
+
+  // The next tile to step onto. False at the end of the path, or when the
+  // tiles changed since the path was found and the next leg is now blocked,
+  // in which case the path is cleared.
+  bool NextStep(Path *path, SDL_Point *step);
+
+  PathfinderStats GetStats() const;
+
+private:
+  struct Cluster
+  {
+    unsigned int revision;
+    int nodeCount;
+    // Local tile index, y * CHUNK_TILES + x, in ascending order.
+    uint8_t nodes[MAX_CLUSTER_NODES];
+    // nodeCount x nodeCount walking costs inside the cluster.
+    vector<uint16_t> costs;
+    // Nodes in the same region can reach each other inside the cluster.
+    uint8_t regions[MAX_CLUSTER_NODES];
+    int regionCount;
+  };
+  struct Sector
+  {
+    // Node ids (cluster * MAX_CLUSTER_NODES + node) that face a node of
+    // another sector, in ascending order, and the tiles they are on.
+    vector<int> entrances;
+    vector<SDL_Point> tiles;
+    // The nodes each entrance faces in other sectors, two to an entrance
+    // (one past a corner) and -1 when there is no second, and the cost of
+    // stepping onto them.
+    vector<int> across;
+    vector<uint8_t> acrossCosts;
+    // entrances x entrances walking costs inside the sector, in COST_UNITs.
+    vector<uint16_t> costs;
+    // entrances x LANDMARKS costs of walking from each landmark to the
+    // entrance, INT_MAX where there is no way. Empty until worked out.
+    vector<int> landmarkCosts;
+  };
+  struct SearchContext;
+  // What ParallelFor() hands the pool: run calls work, a Work functor.
+  struct Job
+  {
+    void (*run)(const void *work, SearchContext *context, int first, int last);
+    const void *work;
+    int count;
+    int threads;
+  };
+
+  int TileCost(int x, int y) const;
+  // Queues the cluster and the four around it for rebuilding: a change can
+  // open or close crossings on its borders, which are nodes of the
+  // neighbours across them too.
+  void MarkDirty(int cx, int cy);
+  // Also rebuilds the sectors the clusters are in.
+  void RebuildClusters(const vector<int> &clusters);
+  void BuildCluster(SearchContext *context, int cluster);
+  void BuildSector(SearchContext *context, int sector);
+  // Picks entrances spread around the world's edges as landmarks and fills
+  // in every sector's landmarkCosts, a landmark per thread.
+  void FindLandmarks();
+  // False, leaving the graph to be built, if there is no cache at path for
+  // this world file or it doesn't fit.
+  bool ReadGraph(const string &path);
+  void WriteGraph(const string &path) const;
+  // Dijkstra over the tiles of one cluster from the local tile source,
+  // stopping once every tile in targets is settled (none: search it all).
+  // Forward, dist is the cost of walking from source; reversed, the cost of
+  // walking to it.
+  void SearchCluster(SearchContext *context, int cluster, int source, bool reverse, const bitset<CLUSTER_AREA> &targets) const;
+  int FindNode(int cluster, int localTile) const;
+  int FindEntrance(int sector, int node) const;
+  int SectorOf(int cluster) const;
+  SDL_Point NodeTile(int node) const;
+  // Calls visit(node, cost) for the node facing node across each cluster
+  // border it is on, with the cost of stepping onto that one.
+  template <typename Visit>
+  void ForEachCrossing(int node, Visit visit) const;
+  // Calls visit(next, cost) for every node one edge from node inside
+  // sector (-1: in any). Reversed, the edges lead to node and cost what
+  // walking them does.
+  template <typename Visit>
+  void ForEachEdge(int node, int sector, bool reverse, Visit visit) const;
+  // Calls visit(next, cost) for every entrance one edge from entrance id
+  // (sector * MAX_SECTOR_ENTRANCES + entrance): across the sector, or into
+  // the next one.
+  template <typename Visit>
+  void ForEachSectorEdge(int id, Visit visit) const;
+  // Seeds the nodes of cluster that dist (indexed by node) reaches, with
+  // parent as their parent, for a search headed for target.
+  void SeedCluster(SearchContext *context, int cluster, const int *dist, int parent, int target) const;
+  // A cost from node to target that is never too high; 0 without a target.
+  int EstimateCost(int node, int target) const;
+  // A* over the nodes inside one sector from the ones seeded into context,
+  // until target is settled (-1: Dijkstra over all of them).
+  void SearchSector(SearchContext *context, int sector, bool reverse, int target) const;
+  // Appends the nodes the last SearchSector() went through to reach node,
+  // from the first one after a seed, in walking order.
+  void AppendNodePath(SearchContext *context, int node, bool reverse, vector<int> *out) const;
+  // Which regions are connected through other clusters, so routes to
+  // unreachable goals fail without a search.
+  void LabelComponents();
+  bool FindPathWith(SearchContext *context, SDL_Point from, SDL_Point to, int maxWaypoints, Path *path);
+  // The two ways FindPathWith() searches once the start's and the goal's
+  // clusters have been searched, with context's startDist and goalDist
+  // filled in. Both return the cost of the cheapest route they find
+  // (directCost if that one, straight through the shared cluster, is
+  // cheaper) and leave its nodes in context's nodePath. SearchNear() goes
+  // over the nodes and gives up with -1 once it has been through
+  // MAX_NEAR_NODES of them; SearchFar() goes over the sectors' entrances.
+  int SearchNear(SearchContext *context, int startCluster, int goalCluster, SDL_Point to, int directCost) const;
+  int SearchFar(SearchContext *context, int startCluster, int goalCluster, SDL_Point to, int directCost) const;
+  bool RefineLeg(SearchContext *context, SDL_Point from, SDL_Point to, vector<SDL_Point> *steps) const;
+  // Runs work(context, first, last) over [0, count), split between threads
+  // if count reaches minPerThread * 2.
+  template <typename Work>
+  void ParallelFor(int count, int minPerThread, Work work);
+  // Worker worker takes its share of each job that uses it, with
+  // contexts[worker].
+  void WorkerLoop(int worker);
+
+  const World *world;
+  int clustersW, clustersH;
+  vector<Cluster> clusters;
+  int sectorsW, sectorsH;
+  vector<Sector> sectors;
+  unsigned int worldRevision;
+  // Kept between updates so catching up allocates nothing once warm.
+  vector<size_t> changedChunks;
+  vector<bool> dirty;
+  vector<int> rebuild;
+  vector<bool> sectorDirty;
+  vector<int> rebuildSectors;
+  // Per cluster, the index of its first region in components, which holds
+  // a shared label for every group of connected regions.
+  vector<int> regionBases;
+  vector<int> components;
+  bool componentsDirty = true;
+  vector<unique_ptr<SearchContext>> contexts;
+  vector<thread> workers;
+  mutex workLock;
+  condition_variable workAvailable;
+  condition_variable workFinished;
+  Job job = {};
+  unsigned int jobNumber = 0;
+  int workersBusy = 0;
+  bool workersStopping = false;
+  bool cached = false;
+  int lastRebuiltClusters = 0;
+  double lastRebuildMs = 0;
+};
@@ -0,0 +1,15 @@
+#include <string>
+#include <SDL.h>
+#include "paths.h"
+
+using namespace std;
+
+string ProjectDirPath()
+{
+  char *basePath = SDL_GetBasePath();
+  string buildDirPath = basePath != NULL ? basePath : "./";
+  SDL_free(basePath);
+  // The base path ends in a separator, so drop that first, then build/.
+  buildDirPath = buildDirPath.substr(0, buildDirPath.find_last_of("/\\"));
+  return buildDirPath.substr(0, buildDirPath.find_last_of("/\\"));
+}
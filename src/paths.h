@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+using namespace std;
+
+// The repository root, i.e. the parent of the build/ directory holding the
+// executable, found through SDL_GetBasePath so it works on every platform
+// and from any working directory. Needs SDL to be initialized.
+string ProjectDirPath();
@@ -0,0 +1,158 @@
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "alloc_counter.h"
+#include "profiler.h"
+
+using namespace std;
+
+Profiler g_profiler;
+
+const int MAX_TRACE_EVENTS_PER_FRAME = 64;
+const double ZONE_AVERAGE_WEIGHT = 0.05;
+const char *COUNTER_NAMES[] = {"sprite_draws", "draw_calls", "color_mod_changes", "allocations"};
+
+Profiler::Profiler()
+{
+  epoch = frameStart = chrono::steady_clock::now();
+  // g_profiler is constructed before main() runs.
+  mainThread = this_thread::get_id();
+  // Zones are looked up by name every frame; keep them from reallocating
+  // while the overlay holds references, and the copy from allocating.
+  zones.reserve(32);
+  lastFrameZones.reserve(32);
+}
+
+void Profiler::BeginFrame()
+{
+  lock_guard<mutex> guard(lock);
+  frameStart = chrono::steady_clock::now();
+  counters[(int)ProfileCounter::Allocations] = -(long long)GetThreadAllocationCount();
+}
+
+void Profiler::EndFrame()
+{
+  lock_guard<mutex> guard(lock);
+  counters[(int)ProfileCounter::Allocations] += GetThreadAllocationCount();
+  auto now = chrono::steady_clock::now();
+  lastFrameMs = chrono::duration<double, milli>(now - frameStart).count();
+
+  for (ZoneTiming &zone : zones)
+  {
+    zone.lastFrameMs = zone.accumulatingMs;
+    zone.averageMs += (zone.lastFrameMs - zone.averageMs) * ZONE_AVERAGE_WEIGHT;
+    zone.accumulatingMs = 0;
+  }
+  lastFrameZones = zones;
+  memcpy(lastFrameCounters, counters, sizeof(counters));
+  memset(counters, 0, sizeof(counters));
+
+  if (captureFramesLeft > 0)
+  {
+    CounterSample sample;
+    sample.timeUs = chrono::duration_cast<chrono::microseconds>(now - epoch).count();
+    memcpy(sample.values, lastFrameCounters, sizeof(sample.values));
+    captureCounters.push_back(sample);
+    if (--captureFramesLeft == 0)
+    {
+      WriteCapture();
+    }
+  }
+}
+
+void Profiler::EndZone(const char *name, chrono::steady_clock::time_point start)
+{
+  auto end = chrono::steady_clock::now();
+  lock_guard<mutex> guard(lock);
+  ZoneTiming *zone = FindZone(name);
+  zone->accumulatingMs += chrono::duration<double, milli>(end - start).count();
+
+  if (captureFramesLeft > 0)
+  {
+    long long startUs = chrono::duration_cast<chrono::microseconds>(start - epoch).count();
+    long long endUs = chrono::duration_cast<chrono::microseconds>(end - epoch).count();
+    captureEvents.push_back({name : name, startUs : startUs, durationUs : endUs - startUs,
+                             threadId : this_thread::get_id() == mainThread ? 1 : 2});
+  }
+}
+
+void Profiler::Count(ProfileCounter counter, long long amount)
+{
+  lock_guard<mutex> guard(lock);
+  counters[(int)counter] += amount;
+}
+
+void Profiler::StartCapture(int frames, const string &path)
+{
+  lock_guard<mutex> guard(lock);
+  captureFramesLeft = frames;
+  capturePath = path;
+  captureEvents.clear();
+  captureCounters.clear();
+  // Reserve up front so recording does not show up as allocations in the
+  // very frames it is measuring.
+  captureEvents.reserve(frames * MAX_TRACE_EVENTS_PER_FRAME);
+  captureCounters.reserve(frames);
+}
+
+bool Profiler::IsCapturing() const
+{
+  return captureFramesLeft > 0;
+}
+
+const vector<Profiler::ZoneTiming> &Profiler::GetZones() const
+{
+  return lastFrameZones;
+}
+
+long long Profiler::GetLastFrameCount(ProfileCounter counter) const
+{
+  return lastFrameCounters[(int)counter];
+}
+
+double Profiler::GetLastFrameMs() const
+{
+  return lastFrameMs;
+}
+
+Profiler::ZoneTiming *Profiler::FindZone(const char *name)
+{
+  // Names are string literals, so comparing pointers is almost always enough.
+  for (ZoneTiming &zone : zones)
+  {
+    if (zone.name == name || strcmp(zone.name, name) == 0)
+    {
+      return &zone;
+    }
+  }
+  zones.push_back({name : name, lastFrameMs : 0, averageMs : 0, accumulatingMs : 0});
+  return &zones.back();
+}
+
+void Profiler::WriteCapture()
+{
+  ofstream out(capturePath);
+  out << "{\"traceEvents\": [\n";
+  bool first = true;
+  for (const TraceEvent &event : captureEvents)
+  {
+    out << (first ? "" : ",\n") << "{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.threadId
+        << ", \"ts\": " << event.startUs << ", \"dur\": " << event.durationUs << "}";
+    first = false;
+  }
+  for (const CounterSample &sample : captureCounters)
+  {
+    out << (first ? "" : ",\n") << "{\"name\": \"counters\", \"ph\": \"C\", \"pid\": 1, \"ts\": " << sample.timeUs << ", \"args\": {";
+    for (int counter = 0; counter < (int)ProfileCounter::Count; counter++)
+    {
+      out << (counter > 0 ? ", " : "") << "\"" << COUNTER_NAMES[counter] << "\": " << sample.values[counter];
+    }
+    out << "}}";
+    first = false;
+  }
+  out << "\n]}\n";
+  printf("Wrote %zu trace events to %s\n", captureEvents.size(), capturePath.c_str());
+}
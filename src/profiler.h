@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum class ProfileCounter
+{
+  SpriteDraws,     // quads queued, one per former SDL_RenderCopy
+  DrawCalls,       // SDL_RenderGeometry submissions
+  ColorModChanges, // sheet/texture color mod actually changed
+  Allocations,     // operator new calls on the main and update threads
+  Count
+};
+
+// Collects scoped timing zones and counters per frame. The last frame's
+// numbers feed the on-screen overlay; while a capture is running every zone
+// is also recorded so it can be written out as a Chrome trace (load the file
+// in chrome://tracing or ui.perfetto.dev).
+//
+// Zones and counters may come from the update thread as well as the main
+// one. Frames begin and end on the main thread while the update thread is
+// idle, and the numbers the overlay reads only change then.
+class Profiler
+{
+public:
+  Profiler();
+
+  void BeginFrame();
+  void EndFrame();
+
+  void EndZone(const char *name, chrono::steady_clock::time_point start);
+  void Count(ProfileCounter counter, long long amount = 1);
+
+  // Records the next `frames` frames and writes them to path when done.
+  void StartCapture(int frames, const string &path);
+  bool IsCapturing() const;
+
+  struct ZoneTiming
+  {
+    const char *name;
+    double lastFrameMs;
+    double averageMs; // exponential moving average, steadier to read
+    double accumulatingMs;
+  };
+
+  const vector<ZoneTiming> &GetZones() const;
+  long long GetLastFrameCount(ProfileCounter counter) const;
+  double GetLastFrameMs() const;
+
+private:
+  struct TraceEvent
+  {
+    const char *name;
+    long long startUs, durationUs;
+    int threadId; // 1 for the main thread, 2 for any other
+  };
+
+  struct CounterSample
+  {
+    long long timeUs;
+    long long values[(int)ProfileCounter::Count];
+  };
+
+  ZoneTiming *FindZone(const char *name);
+  void WriteCapture();
+
+  chrono::steady_clock::time_point epoch;
+  chrono::steady_clock::time_point frameStart;
+  double lastFrameMs = 0;
+  thread::id mainThread;
+  mutex lock;
+  vector<ZoneTiming> zones;
+  vector<ZoneTiming> lastFrameZones; // what GetZones() hands out
+  long long counters[(int)ProfileCounter::Count] = {};
+  long long lastFrameCounters[(int)ProfileCounter::Count] = {};
+
+  int captureFramesLeft = 0;
+  string capturePath;
+  vector<TraceEvent> captureEvents;
+  vector<CounterSample> captureCounters;
+};
+
+extern Profiler g_profiler;
+
+// Times the enclosing scope as a zone named `name` (a string literal).
+struct ProfileZone
+{
+  const char *name;
+  chrono::steady_clock::time_point start;
+
+  ProfileZone(const char *name) : name(name), start(chrono::steady_clock::now()) {}
+  ~ProfileZone() { g_profiler.EndZone(name, start); }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
@@ -0,0 +1,43 @@
+#include <string>
+#include <string_view>
+#include <SDL.h>
+#include "atlas.h"
+#include "sprite_batch.h"
+#include "text_renderer.h"
+#include "gui.h"
+#include "profiler.h"
+#include "frame_arena.h"
+#include "profiler_overlay.h"
+
+using namespace std;
+
+const int OVERLAY_LINE_H = 8;
+const int OVERLAY_MAX_LINES = 18;
+
+void DrawProfilerOverlay(TextRenderer *textRenderer, SpriteBatch *batch, SpriteSheet *gui, FrameArena *arena)
+{
+  // The font only has letters, digits and a little punctuation, so keep the
+  // labels to those.
+  string_view text = arena->Format("Frame {:.2f} ms\n", g_profiler.GetLastFrameMs());
+  int lines = 1;
+  for (const Profiler::ZoneTiming &zone : g_profiler.GetZones())
+  {
+    if (lines >= OVERLAY_MAX_LINES - 3)
+    {
+      break;
+    }
+    text = arena->Append(text, "{} {:.2f}\n", zone.name, zone.averageMs);
+    lines++;
+  }
+  text = arena->Append(text, "Sprites {} Calls {}\nColors {} Allocs {}\nArena {} of {} KB",
+                       g_profiler.GetLastFrameCount(ProfileCounter::SpriteDraws),
+                       g_profiler.GetLastFrameCount(ProfileCounter::DrawCalls),
+                       g_profiler.GetLastFrameCount(ProfileCounter::ColorModChanges),
+                       g_profiler.GetLastFrameCount(ProfileCounter::Allocations),
+                       (arena->GetHighWater() + 1023) / 1024, arena->GetCapacity() / 1024);
+  lines += 3;
+
+  SDL_Rect textArea = {x : 8, y : 8, w : 176, h : lines * OVERLAY_LINE_H};
+  textRenderer->SetTextColor(255, 255, 160);
+  DrawTextBox(textRenderer, text, batch, gui, &textArea, 20, 20, 40);
+}
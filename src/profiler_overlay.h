@@ -0,0 +1,11 @@
+#pragma once
+
+#include "atlas.h"
+#include "sprite_batch.h"
+#include "text_renderer.h"
+#include "frame_arena.h"
+
+// Draws the profiler's last-frame zone timings and counters in a box in the
+// top left corner. The text is built in arena, which also reports on
+// itself.
+void DrawProfilerOverlay(TextRenderer *textRenderer, SpriteBatch *batch, SpriteSheet *gui, FrameArena *arena);
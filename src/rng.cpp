@@ -0,0 +1,58 @@
+#include <cstdint>
+#include "rng.h"
+
+using namespace std;
+
+const uint64_t PCG_MULTIPLIER = 6364136223846793005ULL;
+
+Rng::Rng(uint64_t seed, uint64_t stream)
+{
+  state = 0;
+  increment = (stream << 1) | 1;
+  Next();
+  state += seed;
+  Next();
+}
+
+uint32_t Rng::Next()
+{
+  uint64_t previous = state;
+  state = previous * PCG_MULTIPLIER + increment;
+  uint32_t xorShifted = ((previous >> 18) ^ previous) >> 27;
+  uint32_t rotation = previous >> 59;
+  return (xorShifted >> rotation) | (xorShifted << ((-rotation) & 31));
+}
+
+int Rng::Range(int min, int max)
+{
+  uint32_t bound = (uint32_t)(max - min) + 1;
+  if (bound == 0)
+  {
+    return (int)Next();
+  }
+  // Values below threshold would make the low results slightly more likely.
+  uint32_t threshold = -bound % bound;
+  uint32_t value;
+  do
+  {
+    value = Next();
+  } while (value < threshold);
+  return min + (int)(value % bound);
+}
+
+uint64_t Rng::GetState() const
+{
+  return state;
+}
+
+uint64_t Rng::GetIncrement() const
+{
+  return increment;
+}
+
+void Rng::Restore(uint64_t state, uint64_t increment)
+{
+  this->state = state;
+  // PCG needs an odd increment.
+  this->increment = increment | 1;
+}
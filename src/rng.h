@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+using namespace std;
+
+// Each subsystem draws from its own stream of the session seed, so adding a
+// roll in one (say, a new battle effect) does not shift the numbers another
+// one sees.
+enum RngStream : uint64_t
+{
+  RNG_STREAM_WORLD = 1,
+  RNG_STREAM_BATTLE = 2,
+  RNG_STREAM_ENTITIES = 3, // where entities spawn and what they are
+  RNG_STREAM_WANDER = 4,   // where they wander and walk to afterwards
+};
+
+// PCG32 (pcg-random.org). Small, fast and, unlike rand(), each instance is
+// its own generator, so every battle, worker thread or replay can own a
+// reproducible stream. Generators with the same seed but different streams
+// produce unrelated sequences.
+class Rng
+{
+public:
+  Rng(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t stream = 0);
+
+  uint32_t Next();
+  // Uniform in [min, max], without modulo bias.
+  int Range(int min, int max);
+
+  // For save files: all there is to the generator, to carry on from where
+  // it left off.
+  uint64_t GetState() const;
+  uint64_t GetIncrement() const;
+  void Restore(uint64_t state, uint64_t increment);
+
+private:
+  uint64_t state;
+  uint64_t increment;
+};
@@ -0,0 +1,292 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SDL.h>
+#include "constants.h"
+#include "mapped_file.h"
+#include "save_state.h"
+
+using namespace std;
+
+const int MAX_TILE_RUN = 256;
+
+// Appends tiles as (run length - 1, tile) pairs and returns how many bytes
+// that took. Terrain comes in patches, so most chunks shrink several times.
+static size_t EncodeTileRuns(const Tile *tiles, vector<unsigned char> *out)
+{
+  size_t start = out->size();
+  for (int i = 0; i < CHUNK_AREA;)
+  {
+    int run = 1;
+    while (i + run < CHUNK_AREA && run < MAX_TILE_RUN && tiles[i + run] == tiles[i])
+    {
+      run++;
+    }
+    out->push_back(run - 1);
+    out->push_back(tiles[i]);
+    i += run;
+  }
+  return out->size() - start;
+}
+
+// False unless data is whole runs of known tiles covering exactly one
+// chunk. tiles may be NULL to only check.
+static bool DecodeTileRuns(const unsigned char *data, size_t size, Tile *tiles)
+{
+  int filled = 0;
+  for (size_t i = 0; i + 1 < size; i += 2)
+  {
+    int run = data[i] + 1;
+    if (filled + run > CHUNK_AREA || data[i + 1] > H)
+    {
+      return false;
+    }
+    if (tiles != NULL)
+    {
+      memset(tiles + filled, data[i + 1], run);
+    }
+    filled += run;
+  }
+  return size % 2 == 0 && filled == CHUNK_AREA;
+}
+
+bool IsValidSaveRoute(const SaveRoute &route)
+{
+  // Path::Clear() leaves everything 0; otherwise the walker is on leg and
+  // about to take step, which may be one past the last to move on a leg.
+  return route.leg >= 0 && route.step >= 0 && (uint32_t)route.step <= route.stepCount &&
+         (route.waypointCount == 0 ? route.stepCount == 0 : (uint32_t)route.leg < route.waypointCount);
+}
+
+SaveWriter::SaveWriter(const string &path)
+    : path(path)
+{
+  writerThread = thread(&SaveWriter::WriteLoop, this);
+}
+
+SaveWriter::~SaveWriter()
+{
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  saveCommitted.notify_one();
+  writerThread.join();
+}
+
+GameSnapshot *SaveWriter::BeginSave()
+{
+  lock_guard<mutex> guard(lock);
+  if (pending)
+  {
+    stats.skipped++;
+    return NULL;
+  }
+  return &snapshot;
+}
+
+void SaveWriter::CommitSave()
+{
+  {
+    lock_guard<mutex> guard(lock);
+    pending = true;
+  }
+  saveCommitted.notify_one();
+}
+
+void SaveWriter::Wait()
+{
+  unique_lock<mutex> guard(lock);
+  saveWritten.wait(guard, [this]
+                   { return !pending; });
+}
+
+SaveWriterStats SaveWriter::GetStats()
+{
+  lock_guard<mutex> guard(lock);
+  return stats;
+}
+
+void SaveWriter::WriteLoop()
+{
+  while (true)
+  {
+    {
+      unique_lock<mutex> guard(lock);
+      saveCommitted.wait(guard, [this]
+                         { return stopping || pending; });
+      // A committed save is still written when stopping, so the last one
+      // before quitting isn't lost.
+      if (!pending)
+      {
+        return;
+      }
+    }
+
+    auto start = chrono::steady_clock::now();
+    bool written = WriteSnapshot();
+    double writeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    {
+      lock_guard<mutex> guard(lock);
+      if (written)
+      {
+        stats.saves++;
+        stats.lastWriteMs = writeMs;
+      }
+      else
+      {
+        stats.failed++;
+      }
+      pending = false;
+    }
+    saveWritten.notify_all();
+  }
+}
+
+bool SaveWriter::WriteSnapshot()
+{
+  chunkData.clear();
+  const Tile *tiles = snapshot.chunkTiles.data();
+  for (SaveChunk &chunk : snapshot.chunks)
+  {
+    if (chunk.kind == SAVE_CHUNK_TILES)
+    {
+      chunk.dataOffset = chunkData.size();
+      chunk.dataSize = EncodeTileRuns(tiles, &chunkData);
+      tiles += CHUNK_AREA;
+    }
+  }
+  SaveFileHeader &header = snapshot.header;
+  header.entityCount = snapshot.entities.size();
+  header.routePointCount = snapshot.routePoints.size();
+  header.chunkCount = snapshot.chunks.size();
+  header.spriteCount = snapshot.sprites.size();
+  header.chunkDataSize = chunkData.size();
+
+  string tempPath = path + ".tmp";
+  FILE *file = fopen(tempPath.c_str(), "wb");
+  if (file == NULL)
+  {
+    printf("Unable to write save %s\n", tempPath.c_str());
+    return false;
+  }
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(&snapshot.state, sizeof(snapshot.state), 1, file);
+  fwrite(snapshot.entities.data(), sizeof(SaveEntity), snapshot.entities.size(), file);
+  fwrite(snapshot.routePoints.data(), sizeof(SDL_Point), snapshot.routePoints.size(), file);
+  fwrite(snapshot.chunks.data(), sizeof(SaveChunk), snapshot.chunks.size(), file);
+  fwrite(snapshot.sprites.data(), sizeof(SaveSprite), snapshot.sprites.size(), file);
+  fwrite(chunkData.data(), 1, chunkData.size(), file);
+  bool written = !ferror(file);
+  size_t fileSize = ftell(file);
+  written = fclose(file) == 0 && written;
+
+  error_code error;
+  if (written)
+  {
+    filesystem::rename(tempPath, path, error);
+  }
+  if (!written || error)
+  {
+    printf("Unable to write save %s\n", path.c_str());
+    return false;
+  }
+  lock_guard<mutex> guard(lock);
+  stats.lastFileSize = fileSize;
+  return true;
+}
+
+SaveFile *SaveFile::Open(const string &path)
+{
+  unique_ptr<MappedFile> file = make_unique<MappedFile>();
+  if (!file->Open(path))
+  {
+    return NULL;
+  }
+
+  const unsigned char *data = file->GetData();
+  const SaveFileHeader *header = (const SaveFileHeader *)data;
+  if (file->GetSize() < sizeof(SaveFileHeader) ||
+      memcmp(header->magic, SAVE_FILE_MAGIC, sizeof(header->magic)) != 0 || header->version != SAVE_FILE_VERSION)
+  {
+    printf("%s is not a version %u save\n", path.c_str(), SAVE_FILE_VERSION);
+    return NULL;
+  }
+  // Counts come from the file, so add them up in 64 bits where a damaged
+  // one can't wrap around.
+  uint64_t size = sizeof(SaveFileHeader) + sizeof(SaveGameState) + (uint64_t)header->entityCount * sizeof(SaveEntity) +
+                  header->routePointCount * sizeof(SDL_Point) + (uint64_t)header->chunkCount * sizeof(SaveChunk) +
+                  (uint64_t)header->spriteCount * sizeof(SaveSprite) + header->chunkDataSize;
+  if (header->routePointCount > file->GetSize() || header->chunkDataSize > file->GetSize() || size != file->GetSize())
+  {
+    printf("%s is truncated\n", path.c_str());
+    return NULL;
+  }
+
+  SaveFile *save = new SaveFile();
+  save->header = header;
+  save->state = (const SaveGameState *)(data + sizeof(SaveFileHeader));
+  save->entities = (const SaveEntity *)(save->state + 1);
+  save->routePoints = (const SDL_Point *)(save->entities + header->entityCount);
+  save->chunks = (const SaveChunk *)(save->routePoints + header->routePointCount);
+  save->sprites = (const SaveSprite *)(save->chunks + header->chunkCount);
+  save->chunkData = (const unsigned char *)(save->sprites + header->spriteCount);
+  for (uint32_t i = 0; i < header->chunkCount; i++)
+  {
+    const SaveChunk &chunk = save->chunks[i];
+    if (chunk.kind == SAVE_CHUNK_TILES &&
+        (chunk.dataOffset > header->chunkDataSize || chunk.dataSize > header->chunkDataSize - chunk.dataOffset ||
+         !DecodeTileRuns(save->chunkData + chunk.dataOffset, chunk.dataSize, NULL)))
+    {
+      printf("%s has a damaged chunk\n", path.c_str());
+      delete save;
+      return NULL;
+    }
+  }
+  save->file = move(file);
+  return save;
+}
+
+const SaveFileHeader &SaveFile::GetHeader() const
+{
+  return *header;
+}
+
+const SaveGameState &SaveFile::GetState() const
+{
+  return *state;
+}
+
+const SaveEntity *SaveFile::GetEntities() const
+{
+  return entities;
+}
+
+const SDL_Point *SaveFile::GetRoutePoints() const
+{
+  return routePoints;
+}
+
+const SaveChunk *SaveFile::GetChunks() const
+{
+  return chunks;
+}
+
+const SaveSprite *SaveFile::GetSprites() const
+{
+  return sprites;
+}
+
+void SaveFile::DecodeChunk(const SaveChunk &chunk, Tile *tiles) const
+{
+  DecodeTileRuns(chunkData + chunk.dataOffset, chunk.dataSize, tiles);
+}
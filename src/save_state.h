@@ -0,0 +1,212 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SDL.h>
+#include "constants.h"
+#include "battle.h"
+#include "mapped_file.h"
+
+using namespace std;
+
+// Save file (.tbs), little-endian:
+//   SaveFileHeader
+//   SaveGameState
+//   SaveEntity entities[entityCount]
+//   SDL_Point routePoints[routePointCount]: the player's click route, then
+//   each routed entity's in entity order, each as its waypoints followed by
+//   the steps of its current leg
+//   SaveChunk chunks[chunkCount]
+//   SaveSprite sprites[spriteCount], every Animator sprite in order
+//   chunk data, chunkDataSize bytes: the tiles of SAVE_CHUNK_TILES chunks as
+//   (run length - 1, tile) byte pairs, each running along the chunk's rows
+//
+// Everything but the tiles is stored as it sits in memory and read straight
+// out of the mapping. Tiles are only stored for chunks that were edited:
+// loading starts from the world opened or generated the same way as the
+// saved one, so the rest are either already there or made again from the
+// seed.
+const char SAVE_FILE_MAGIC[4] = {'T', 'B', 'R', 'S'};
+const uint32_t SAVE_FILE_VERSION = 2;
+
+struct SaveFileHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t seed;
+  uint32_t worldW, worldH;
+  uint32_t worldOnDemand; // 1 if the world was generated on demand
+  uint32_t entityCount;
+  uint32_t chunkCount;
+  uint32_t spriteCount;
+  uint64_t routePointCount;
+  uint64_t chunkDataSize;
+};
+
+// A Path: its points are waypointCount waypoints and then stepCount steps.
+struct SaveRoute
+{
+  uint32_t waypointCount; // 0 for no route
+  uint32_t stepCount;
+  int32_t cost;
+  int32_t leg;
+  int32_t step;
+  uint32_t reserved;
+};
+
+// False if following the route would read past its points.
+bool IsValidSaveRoute(const SaveRoute &route);
+
+struct SaveGameState
+{
+  uint64_t tickCount;
+  uint64_t walkStart;
+  uint64_t rngState, rngIncrement;
+  uint64_t entityRngState, entityRngIncrement;
+  int32_t currentScreen;
+  int32_t playerX, playerY;
+  int32_t walkDirection, facing;
+  uint8_t isWalking, showText;
+  uint8_t reserved[2];
+  int32_t textRevealTicks;
+  SaveRoute autoWalk; // first in routePoints
+
+  int32_t battleStep, battleAction, battleHighlightIndex, battleRevealTicks;
+  int32_t enemyCount, turns;
+  int32_t enemyHp[MAX_BATTLE_ENEMIES], enemyMaxHp[MAX_BATTLE_ENEMIES];
+  uint32_t actionTextLength;
+  char actionText[ACTION_TEXT_CAPACITY];
+};
+
+struct SaveEntity
+{
+  SDL_Point position, previousPosition;
+  uint64_t moveStart, nextMoveTick;
+  SaveRoute route;
+  uint8_t kind;
+  uint8_t reserved[7];
+};
+
+enum SaveChunkKind : uint8_t
+{
+  SAVE_CHUNK_GENERATED = 0, // made on demand and untouched since; made again on load
+  SAVE_CHUNK_FILL = 1,      // edited, every tile fillTile
+  SAVE_CHUNK_TILES = 2,     // edited, tiles in the chunk data
+};
+
+struct SaveChunk
+{
+  uint32_t chunk; // row-major chunk index
+  uint8_t kind;
+  uint8_t fillTile;
+  uint16_t dataSize;
+  uint64_t dataOffset; // from the start of the chunk data
+};
+
+struct SaveSprite
+{
+  int32_t clip;
+  int32_t frame; // within the clip
+  int32_t ticksLeft;
+};
+
+// The sections are read in place, so each has to start aligned.
+static_assert(sizeof(SaveFileHeader) % 8 == 0 && sizeof(SaveGameState) % 8 == 0 && sizeof(SaveEntity) % 8 == 0 &&
+                  sizeof(SaveChunk) % 8 == 0,
+              "Save file sections must stay 8-byte aligned");
+
+// Everything a save holds, copied out of the game between ticks. The
+// vectors keep their memory from one save to the next.
+struct GameSnapshot
+{
+  SaveFileHeader header;
+  SaveGameState state;
+  vector<SaveEntity> entities;
+  vector<SDL_Point> routePoints;
+  vector<SaveChunk> chunks;
+  vector<SaveSprite> sprites;
+  // CHUNK_AREA tiles for each SAVE_CHUNK_TILES chunk, in order. The writer
+  // codes them and fills in the chunks' data offsets and sizes.
+  vector<Tile> chunkTiles;
+};
+
+struct SaveWriterStats
+{
+  int saves;
+  int skipped;      // saves asked for while the last one was still being written
+  int failed;
+  double lastWriteMs; // coding and writing, on the writer thread
+  size_t lastFileSize;
+};
+
+// Writes snapshots to one file on its own thread, so the game only pays
+// for copying its state. Each save goes to a temporary file that is then
+// renamed over the last one, so quitting or crashing mid-write keeps the
+// previous save whole.
+class SaveWriter
+{
+public:
+  SaveWriter(const string &path);
+  // Finishes the save being written, if any.
+  ~SaveWriter();
+
+  // The snapshot to fill in for the next save, or NULL while the last one
+  // is still being written, in which case the save is counted as skipped.
+  GameSnapshot *BeginSave();
+  // Hands the snapshot from BeginSave() to the writer thread.
+  void CommitSave();
+  // Blocks until the last committed save is on disk.
+  void Wait();
+
+  SaveWriterStats GetStats();
+
+private:
+  void WriteLoop();
+  bool WriteSnapshot();
+
+  string path;
+  GameSnapshot snapshot;
+  vector<unsigned char> chunkData;
+  thread writerThread;
+  mutex lock;
+  condition_variable saveCommitted;
+  condition_variable saveWritten;
+  bool pending = false;
+  bool stopping = false;
+  SaveWriterStats stats = {};
+};
+
+// A save file, mapped into memory. What the Get functions return points
+// into the mapping and is only valid while the SaveFile is.
+class SaveFile
+{
+public:
+  // NULL if the file is missing, damaged or from another version.
+  static SaveFile *Open(const string &path);
+
+  const SaveFileHeader &GetHeader() const;
+  const SaveGameState &GetState() const;
+  const SaveEntity *GetEntities() const;
+  const SDL_Point *GetRoutePoints() const;
+  const SaveChunk *GetChunks() const;
+  const SaveSprite *GetSprites() const;
+  // Decodes a SAVE_CHUNK_TILES chunk into CHUNK_AREA tiles. Open() has
+  // already checked that every chunk decodes.
+  void DecodeChunk(const SaveChunk &chunk, Tile *tiles) const;
+
+private:
+  unique_ptr<MappedFile> file;
+  const SaveFileHeader *header;
+  const SaveGameState *state;
+  const SaveEntity *entities;
+  const SDL_Point *routePoints;
+  const SaveChunk *chunks;
+  const SaveSprite *sprites;
+  const unsigned char *chunkData;
+};
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cstdio>
+#include <SDL.h>
+#include "constants.h"
+#include "screen.h"
+
+using namespace std;
+
+Screen::Screen(SDL_Renderer *renderer)
+    : renderer(renderer)
+{
+  if (SDL_RenderTargetSupported(renderer))
+  {
+    target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, GAME_W, GAME_H);
+  }
+  if (target != NULL)
+  {
+    SDL_SetTextureScaleMode(target, SDL_ScaleModeNearest);
+  }
+  else
+  {
+    printf("Unable to create the game texture, scaling every draw instead! SDL Error: %s\n", SDL_GetError());
+    SDL_RenderSetLogicalSize(renderer, GAME_W, GAME_H);
+    SDL_RenderSetIntegerScale(renderer, SDL_TRUE);
+  }
+  UpdateLayout();
+}
+
+Screen::~Screen()
+{
+  if (target != NULL)
+  {
+    SDL_DestroyTexture(target);
+  }
+}
+
+void Screen::UpdateLayout()
+{
+  int outputW, outputH, windowW, windowH;
+  SDL_GetRendererOutputSize(renderer, &outputW, &outputH);
+  SDL_GetWindowSize(SDL_RenderGetWindow(renderer), &windowW, &windowH);
+  scale = max(1, min(outputW / GAME_W, outputH / GAME_H));
+  viewport = {x : (outputW - GAME_W * scale) / 2, y : (outputH - GAME_H * scale) / 2, w : GAME_W * scale, h : GAME_H * scale};
+  pixelsPerPointX = windowW > 0 ? (double)outputW / windowW : 1;
+  pixelsPerPointY = windowH > 0 ? (double)outputH / windowH : 1;
+}
+
+void Screen::BeginFrame()
+{
+  if (target != NULL)
+  {
+    SDL_SetRenderTarget(renderer, target);
+  }
+  SDL_RenderClear(renderer);
+}
+
+void Screen::Present()
+{
+  if (target != NULL)
+  {
+    // Checked every frame, so resizing or moving to another display just
+    // takes effect on the next one.
+    UpdateLayout();
+    SDL_SetRenderTarget(renderer, NULL);
+    Uint8 r, g, b, a;
+    SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, target, NULL, &viewport);
+    SDL_SetRenderDrawColor(renderer, r, g, b, a);
+  }
+  SDL_RenderPresent(renderer);
+}
+
+bool Screen::ToGamePoint(int windowX, int windowY, SDL_Point *point) const
+{
+  if (target == NULL)
+  {
+    *point = {x : windowX, y : windowY};
+    return windowX >= 0 && windowX < GAME_W && windowY >= 0 && windowY < GAME_H;
+  }
+  SDL_Point output = {x : (int)(windowX * pixelsPerPointX), y : (int)(windowY * pixelsPerPointY)};
+  if (!SDL_PointInRect(&output, &viewport))
+  {
+    return false;
+  }
+  *point = {x : (output.x - viewport.x) / scale, y : (output.y - viewport.y) / scale};
+  return true;
+}
+
+int Screen::GetScale() const
+{
+  return scale;
+}
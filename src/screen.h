@@ -0,0 +1,39 @@
+#pragma once
+
+#include <SDL.h>
+
+using namespace std;
+
+// Everything the game draws goes into one GAME_W x GAME_H texture, which is
+// then copied to the window once, scaled by the largest whole factor that
+// fits and centred between black bars. Sprites are filled at game size
+// rather than at window size, and the window can be any size.
+class Screen
+{
+public:
+  Screen(SDL_Renderer *renderer);
+  ~Screen();
+
+  // Points the renderer at the game texture and clears it.
+  void BeginFrame();
+  // Scales the game texture up to the window and presents it. The frame's
+  // batch must have been submitted first.
+  void Present();
+
+  // Converts a mouse position in window coordinates to game pixels. False
+  // if it is in the bars around the picture.
+  bool ToGamePoint(int windowX, int windowY, SDL_Point *point) const;
+  int GetScale() const;
+
+private:
+  void UpdateLayout();
+
+  SDL_Renderer *renderer;
+  // NULL if the renderer can't draw to textures, in which case SDL scales
+  // every draw call itself and already converts mouse events.
+  SDL_Texture *target = NULL;
+  int scale = 1;
+  SDL_Rect viewport; // where the game texture goes, in output pixels
+  // Output pixels per window coordinate; above 1 on high-DPI displays.
+  double pixelsPerPointX = 1, pixelsPerPointY = 1;
+};
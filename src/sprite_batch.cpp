@@ -0,0 +1,74 @@
+#include <vector>
+#include <SDL.h>
+#include "atlas.h"
+#include "draw_list.h"
+#include "sprite_batch.h"
+
+using namespace std;
+
+SpriteBatch::SpriteBatch(SDL_Renderer *renderer) : renderer(renderer)
+{
+}
+
+void SpriteBatch::Draw(
+    SDL_Texture *texture,
+    const SDL_Rect *srcRect,
+    const SDL_Rect *dstRect,
+    SDL_RendererFlip flip)
+{
+  // The texture's size and color mod are looked up when played, so
+  // recording never reads renderer state.
+  lists[recording].Push({
+    op : DrawOp::TextureSprite,
+    flip : flip,
+    color : {r : 255, g : 255, b : 255, a : 255},
+    texture : texture,
+    src : srcRect != NULL ? *srcRect : SDL_Rect{x : 0, y : 0, w : 0, h : 0},
+    dst : *dstRect});
+}
+
+void SpriteBatch::Draw(
+    const SpriteSheet *sheet,
+    const SDL_Rect *srcRect,
+    const SDL_Rect *dstRect,
+    SDL_RendererFlip flip)
+{
+  lists[recording].Push({
+    op : DrawOp::Sprite,
+    flip : flip,
+    color : sheet->color,
+    texture : sheet->texture,
+    src : {x : srcRect->x + sheet->origin.x, y : srcRect->y + sheet->origin.y, w : srcRect->w, h : srcRect->h},
+    dst : *dstRect});
+}
+
+void SpriteBatch::BeginTarget(SDL_Texture *texture)
+{
+  lists[recording].Push({op : DrawOp::BeginTarget, flip : SDL_FLIP_NONE, color : {}, texture : texture, src : {}, dst : {}});
+}
+
+void SpriteBatch::EndTarget()
+{
+  lists[recording].Push({op : DrawOp::EndTarget, flip : SDL_FLIP_NONE, color : {}, texture : NULL, src : {}, dst : {}});
+}
+
+void SpriteBatch::EndFrame()
+{
+  recording ^= 1;
+  lists[recording].Clear();
+}
+
+void SpriteBatch::Submit()
+{
+  lastFrame = lists[recording ^ 1].Play(renderer);
+}
+
+SDL_Renderer *SpriteBatch::GetRenderer() const
+{
+  return renderer;
+}
+
+SpriteBatchStats SpriteBatch::GetLastFrameStats() const
+{
+  return lastFrame;
+}
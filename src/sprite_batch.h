@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <SDL.h>
+#include "atlas.h"
+#include "draw_list.h"
+
+using namespace std;
+
+// Records textured quads into a DrawList. Every run of quads sharing a
+// texture is submitted with a single SDL_RenderGeometry call when the list is
+// played, and draw order is preserved.
+//
+// There are two lists, so one frame can be recorded while the one before it
+// is played back on the renderer's thread: Draw() and the target calls only
+// write the recording list, Submit() only reads the finished one, and
+// EndFrame() swaps them while neither is in use.
+class SpriteBatch
+{
+public:
+  SpriteBatch(SDL_Renderer *renderer);
+
+  // Queues a copy of srcRect (whole texture if NULL) into dstRect, using the
+  // texture's color/alpha mod when played just like SDL_RenderCopy would.
+  void Draw(
+      SDL_Texture *texture,
+      const SDL_Rect *srcRect,
+      const SDL_Rect *dstRect,
+      SDL_RendererFlip flip = SDL_FLIP_NONE);
+
+  // Queues a sprite from an atlas sheet. srcRect is in sheet coordinates and
+  // the sheet's color replaces the texture color mod, since sheets sharing a
+  // page cannot each have their own.
+  void Draw(
+      const SpriteSheet *sheet,
+      const SDL_Rect *srcRect,
+      const SDL_Rect *dstRect,
+      SDL_RendererFlip flip = SDL_FLIP_NONE);
+
+  // Everything queued until EndTarget() is drawn into texture, which is
+  // cleared to transparent first. Targets don't nest.
+  void BeginTarget(SDL_Texture *texture);
+  void EndTarget();
+
+  // Finishes the frame being recorded, for the next Submit() to play, and
+  // starts an empty one.
+  void EndFrame();
+  // Plays the last finished frame on the renderer and rolls its counters
+  // into GetLastFrameStats().
+  void Submit();
+
+  // Only for checking what the renderer supports and creating textures up
+  // front; drawing goes through the lists.
+  SDL_Renderer *GetRenderer() const;
+  SpriteBatchStats GetLastFrameStats() const;
+
+private:
+  SDL_Renderer *renderer;
+  DrawList lists[2];
+  int recording = 0;
+  SpriteBatchStats lastFrame = {0, 0};
+};
@@ -0,0 +1,152 @@
+#include <cstdint>
+#include "constants.h"
+#include "rng.h"
+#include "terrain.h"
+
+using namespace std;
+
+const int CHUNK_AREA_TILES = CHUNK_TILES * CHUNK_TILES;
+
+// Noise layers, coarsest first. Periods are powers of two in tiles, so
+// lattice cells line up with chunk edges and a chunk never straddles more
+// than a handful of them.
+struct NoiseOctave
+{
+  int period;
+  float amplitude;
+};
+const NoiseOctave HEIGHT_OCTAVES[] = {
+    {period : 256, amplitude : 1.0f},
+    {period : 128, amplitude : 0.5f},
+    {period : 64, amplitude : 0.25f},
+    {period : 32, amplitude : 0.125f},
+    {period : 16, amplitude : 0.0625f},
+    {period : 8, amplitude : 0.03125f},
+};
+const NoiseOctave MOISTURE_OCTAVES[] = {
+    {period : 512, amplitude : 1.0f},
+    {period : 128, amplitude : 0.5f},
+    {period : 32, amplitude : 0.25f},
+};
+
+// Thresholds on the noise, each roughly in [-1, 1]: the sea is everything
+// low, mountains the highest peaks, and hills sit below the peaks or
+// wherever the land is dry.
+const float SEA_LEVEL = -0.2f;
+const float HILL_LEVEL = 0.25f;
+const float MOUNTAIN_LEVEL = 0.4f;
+const float DRY_LEVEL = -0.45f;
+
+enum NoiseField : uint64_t
+{
+  NOISE_HEIGHT = 0,
+  NOISE_MOISTURE = 1,
+};
+
+// SplitMix64's finalizer: every input bit affects every output bit.
+static uint64_t MixBits(uint64_t value)
+{
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+  return value ^ (value >> 31);
+}
+
+// Random value in [-1, 1) at a lattice point of one octave.
+static float LatticeValue(uint64_t octaveKey, int cellX, int cellY)
+{
+  uint64_t hash = MixBits(octaveKey ^ ((uint64_t)(uint32_t)cellX << 32 | (uint32_t)cellY));
+  return (float)(hash >> 40) * (2.0f / (1 << 24)) - 1.0f;
+}
+
+// Smoothstep, so slopes meet without creases at cell edges.
+static float Fade(float t)
+{
+  return t * t * (3.0f - 2.0f * t);
+}
+
+// Adds one octave of value noise over the whole chunk. Lattice values are
+// looked up once per cell row and blended along x into top and bottom, so
+// the per-tile loop is a straight run of multiply-adds over each row that
+// the compiler turns into SIMD.
+static void AddOctave(float *values, uint64_t octaveKey, const NoiseOctave &octave, int originX, int originY)
+{
+  int shift = __builtin_ctz(octave.period);
+  int mask = octave.period - 1;
+  float scale = 1.0f / octave.period;
+  float fadeX[CHUNK_TILES], fadeY[CHUNK_TILES];
+  for (int i = 0; i < CHUNK_TILES; i++)
+  {
+    fadeX[i] = Fade(((originX + i) & mask) * scale);
+    fadeY[i] = Fade(((originY + i) & mask) * scale);
+  }
+
+  // Arithmetic shifts round down, so this works left of and above 0 too.
+  int firstCellX = originX >> shift;
+  int cellsX = ((originX + CHUNK_TILES - 1) >> shift) - firstCellX + 2;
+  float upper[CHUNK_TILES + 1], lower[CHUNK_TILES + 1];
+  float top[CHUNK_TILES], bottom[CHUNK_TILES];
+  int cellY = 0;
+  for (int y = 0; y < CHUNK_TILES; y++)
+  {
+    if (y == 0 || ((originY + y) & mask) == 0)
+    {
+      cellY = (originY + y) >> shift;
+      for (int cell = 0; cell < cellsX; cell++)
+      {
+        upper[cell] = LatticeValue(octaveKey, firstCellX + cell, cellY);
+        lower[cell] = LatticeValue(octaveKey, firstCellX + cell, cellY + 1);
+      }
+      for (int x = 0; x < CHUNK_TILES; x++)
+      {
+        int cell = ((originX + x) >> shift) - firstCellX;
+        top[x] = upper[cell] + (upper[cell + 1] - upper[cell]) * fadeX[x];
+        bottom[x] = lower[cell] + (lower[cell + 1] - lower[cell]) * fadeX[x];
+      }
+    }
+
+    float *row = values + y * CHUNK_TILES;
+    float fade = fadeY[y];
+    for (int x = 0; x < CHUNK_TILES; x++)
+    {
+      row[x] += octave.amplitude * (top[x] + (bottom[x] - top[x]) * fade);
+    }
+  }
+}
+
+template <size_t N>
+static void FillNoise(float *values, uint64_t seed, NoiseField field, const NoiseOctave (&octaves)[N], int originX, int originY)
+{
+  float totalAmplitude = 0;
+  for (int i = 0; i < CHUNK_AREA_TILES; i++)
+  {
+    values[i] = 0;
+  }
+  for (size_t octave = 0; octave < N; octave++)
+  {
+    uint64_t octaveKey = MixBits(seed ^ MixBits((uint64_t)RNG_STREAM_WORLD << 32 | field << 8 | octave));
+    AddOctave(values, octaveKey, octaves[octave], originX, originY);
+    totalAmplitude += octaves[octave].amplitude;
+  }
+  float scale = 1.0f / totalAmplitude;
+  for (int i = 0; i < CHUNK_AREA_TILES; i++)
+  {
+    values[i] *= scale;
+  }
+}
+
+void GenerateTerrainChunk(uint64_t seed, int chunkX, int chunkY, Tile *tiles)
+{
+  int originX = chunkX * CHUNK_TILES, originY = chunkY * CHUNK_TILES;
+  float height[CHUNK_AREA_TILES], moisture[CHUNK_AREA_TILES];
+  FillNoise(height, seed, NOISE_HEIGHT, HEIGHT_OCTAVES, originX, originY);
+  FillNoise(moisture, seed, NOISE_MOISTURE, MOISTURE_OCTAVES, originX, originY);
+
+  for (int i = 0; i < CHUNK_AREA_TILES; i++)
+  {
+    Tile tile = G;
+    tile = height[i] > HILL_LEVEL || moisture[i] < DRY_LEVEL ? H : tile;
+    tile = height[i] > MOUNTAIN_LEVEL ? M : tile;
+    tile = height[i] < SEA_LEVEL ? W : tile;
+    tiles[i] = tile;
+  }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include "constants.h"
+
+using namespace std;
+
+// Fills tiles (CHUNK_TILES x CHUNK_TILES, row-major) with the terrain of one
+// chunk: layered value noise for height and moisture, mapped to water, grass,
+// hills and mountains. Only depends on seed and the chunk's position, so
+// chunks can be made in any order, on any thread, and still line up.
+void GenerateTerrainChunk(uint64_t seed, int chunkX, int chunkY, Tile *tiles);
@@ -1,34 +1,69 @@
 #include <string>
-#include <queue>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
 #include <SDL.h>
+#include "atlas.h"
+#include "constants.h"
+#include "sprite_batch.h"
 #include "text_renderer.h"
 
 using namespace std;
 
 const int LETTER_W = 8, LETTER_H = 8;
-const string FONT_CHARACTERS = " !',-.0123456789?ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz:";
+constexpr string_view FONT_CHARACTERS = " !',-.0123456789?ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz:";
 const int FONT_ROWS = 7, FONT_COLUMNS = 10;
+// The dialog box and battle description box, plus the profiler overlay.
+const int MAX_CACHED_LAYOUTS = 4;
+// A screen full of letters; no text area can place more glyphs than that.
+const int MAX_LAYOUT_GLYPHS = (GAME_W / LETTER_W) * (GAME_H / LETTER_H);
 
-TextRenderer::TextRenderer(SDL_Renderer *renderer, SDL_Texture *font) : renderer(renderer), font(font)
+struct GlyphTable
 {
+  SDL_Rect rects[128];
+  bool present[128];
+};
+
+// Glyph source rects indexed by character, worked out at compile time from
+// the order of FONT_CHARACTERS in font.png.
+constexpr GlyphTable BuildGlyphTable()
+{
+  GlyphTable table = {};
   for (int col = 0; col < FONT_COLUMNS; col++)
   {
     for (int row = 0; row < FONT_ROWS; row++)
     {
-      char c = FONT_CHARACTERS.at(row * FONT_COLUMNS + col);
-      letterRects[c] = {x : col * LETTER_W, y : row * LETTER_H, w : LETTER_W, h : LETTER_H};
+      unsigned char c = FONT_CHARACTERS.at(row * FONT_COLUMNS + col);
+      table.rects[c] = {x : col * LETTER_W, y : row * LETTER_H, w : LETTER_W, h : LETTER_H};
+      table.present[c] = true;
     }
   }
+  return table;
+}
+
+constexpr GlyphTable GLYPHS = BuildGlyphTable();
+
+static bool HasGlyph(char c)
+{
+  return (unsigned char)c < 128 && GLYPHS.present[(unsigned char)c];
+}
+
+// Characters without a glyph get an empty rect, which draws nothing.
+static const SDL_Rect *GlyphRect(char c)
+{
+  return &GLYPHS.rects[(unsigned char)c < 128 ? (unsigned char)c : 0];
+}
+
+TextRenderer::TextRenderer(SpriteBatch *batch, SpriteSheet *font) : batch(batch), font(font)
+{
+  layouts.reserve(MAX_CACHED_LAYOUTS);
 };
 
 void TextRenderer::DrawText(
-    const string &text,
+    string_view text,
     SDL_Rect *textArea)
 {
   SDL_Rect dstRect;
-  const int textAreaW = (textArea->w / LETTER_W) * LETTER_W,
-            textAreaH = (textArea->h / LETTER_H) * LETTER_H;
+  const int textAreaW = (textArea->w / LETTER_W) * LETTER_W;
   for (int pos = 0; pos < text.length(); ++pos)
   {
     int relativeY = ((pos * LETTER_W) / textAreaW) * LETTER_H;
@@ -38,7 +73,7 @@ void TextRenderer::DrawText(
     }
     int relativeX = (pos * LETTER_W) % textAreaW;
     dstRect = {x : textArea->x + relativeX, y : textArea->y + relativeY, w : LETTER_W, h : LETTER_H};
-    SDL_RenderCopy(renderer, font, &letterRects[text.at(pos)], &dstRect);
+    batch->Draw(font, GlyphRect(text[pos]), &dstRect);
   }
 }
 
@@ -51,34 +86,89 @@ void TextRenderer::DrawCharAt(
   int relativeX = positionInRow * LETTER_W;
   int relativeY = rowIndex * LETTER_H;
   SDL_Rect dstRect = {x : textArea->x + relativeX, y : textArea->y + relativeY, w : LETTER_W, h : LETTER_H};
-  SDL_RenderCopy(renderer, font, &letterRects[c], &dstRect);
+  batch->Draw(font, GlyphRect(c), &dstRect);
 }
 
 void TextRenderer::DrawTextWrapped(
-    const string &text,
+    string_view text,
     const SDL_Rect *textArea,
     int charsToRender)
 {
+  const TextLayout &layout = GetLayout(text, textArea);
+  for (const PlacedGlyph &glyph : layout.glyphs)
+  {
+    if (charsToRender >= 0 && glyph.revealIndex >= charsToRender)
+    {
+      break;
+    }
+    batch->Draw(font, glyph.src, &glyph.dst);
+  }
+}
+
+const TextRenderer::TextLayout &TextRenderer::GetLayout(string_view text, const SDL_Rect *textArea)
+{
+  layoutUseCount++;
+
+  TextLayout *oldest = NULL;
+  for (TextLayout &layout : layouts)
+  {
+    if (layout.text == text &&
+        layout.area.x == textArea->x && layout.area.y == textArea->y &&
+        layout.area.w == textArea->w && layout.area.h == textArea->h)
+    {
+      layout.lastUsed = layoutUseCount;
+      return layout;
+    }
+    if (oldest == NULL || layout.lastUsed < oldest->lastUsed)
+    {
+      oldest = &layout;
+    }
+  }
+
+  if (layouts.size() < MAX_CACHED_LAYOUTS)
+  {
+    layouts.push_back({});
+    oldest = &layouts.back();
+    // Sized up front so that text changing in steady state doesn't grow them.
+    oldest->text.reserve(MAX_LAYOUT_GLYPHS);
+    oldest->glyphs.reserve(MAX_LAYOUT_GLYPHS);
+  }
+
+  oldest->text.assign(text);
+  oldest->area = *textArea;
+  oldest->lastUsed = layoutUseCount;
+  LayoutTextWrapped(*oldest);
+  return *oldest;
+}
+
+void TextRenderer::LayoutTextWrapped(TextLayout &layout)
+{
+  const string &text = layout.text;
+  const SDL_Rect *textArea = &layout.area;
   const int rowLength = (textArea->w / LETTER_W),
             totalRows = (textArea->h / LETTER_H);
 
-  string strToRender = text + " ";
+  layout.glyphs.clear();
 
-  queue<char> charBuf;
+  // Words are placed once the space or newline after them is reached; the
+  // end of the text counts as one last space.
+  int wordStart = 0;
+  int wordLength = 0;
   int curCharsInRow = 0;
   int curRowIndex = 0;
   int totalCharsRendered = 0;
-  for (char c : strToRender)
+  for (int i = 0; i <= (int)text.length(); i++)
   {
+    char c = i < (int)text.length() ? text[i] : ' ';
     if (c == ' ' || c == '\n')
     {
-      if (charBuf.size() > rowLength)
+      if (wordLength > rowLength)
       {
-        break;
+        return;
       }
 
       int spaceCharNeeded = curCharsInRow > 0;
-      if (curCharsInRow + spaceCharNeeded + charBuf.size() > rowLength)
+      if (curCharsInRow + spaceCharNeeded + wordLength > rowLength)
       {
         curRowIndex++;
         curCharsInRow = 0;
@@ -87,42 +177,40 @@ void TextRenderer::DrawTextWrapped(
 
       if (curRowIndex >= totalRows)
       {
-        break;
+        return;
       }
 
       curCharsInRow += spaceCharNeeded;
       totalCharsRendered += spaceCharNeeded;
-      while (charBuf.size() > 0)
+      for (int j = wordStart; j < i; j++)
       {
-        if (charsToRender >= 0 && totalCharsRendered >= charsToRender)
+        if (!HasGlyph(text[j]))
         {
-          return;
+          continue;
         }
-        DrawCharAt(charBuf.front(), textArea, curCharsInRow, curRowIndex);
+        SDL_Rect dst = {x : textArea->x + curCharsInRow * LETTER_W, y : textArea->y + curRowIndex * LETTER_H, w : LETTER_W, h : LETTER_H};
+        layout.glyphs.push_back({src : GlyphRect(text[j]), dst : dst, revealIndex : totalCharsRendered});
         curCharsInRow++;
         totalCharsRendered++;
-        charBuf.pop();
       }
+      wordStart = i + 1;
+      wordLength = 0;
 
       if (c == '\n')
       {
         curRowIndex++;
         curCharsInRow = 0;
-        spaceCharNeeded = 0;
         totalCharsRendered++;
       }
     }
-    else
+    else if (HasGlyph(c))
     {
-      if (letterRects.contains(c))
-      {
-        charBuf.push(c);
-      }
+      wordLength++;
     }
   }
 }
 
 void TextRenderer::SetTextColor(int r, int g, int b)
 {
-  SDL_SetTextureColorMod(font, r, g, b);
+  SetSheetColor(font, r, g, b);
 }
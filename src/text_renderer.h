@@ -1,19 +1,21 @@
 #pragma once
 
 #include <string>
-#include <queue>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
 #include <SDL.h>
+#include "atlas.h"
+#include "sprite_batch.h"
 
 using namespace std;
 
 class TextRenderer
 {
 public:
-  TextRenderer(SDL_Renderer *renderer, SDL_Texture *font);
+  TextRenderer(SpriteBatch *batch, SpriteSheet *font);
 
   void DrawText(
-      const string &text,
+      string_view text,
       SDL_Rect *textArea);
 
   void DrawCharAt(
@@ -22,15 +24,41 @@ public:
       int positionInRow,
       int rowIndex);
 
+  // Word wraps text into textArea. The layout is cached per (text, area), so
+  // redrawing the same text, e.g. while it is revealed a few characters at a
+  // time with charsToRender, only copies out the glyphs.
   void DrawTextWrapped(
-      const string &text,
+      string_view text,
       const SDL_Rect *textArea,
       int charsToRender = -1);
 
   void SetTextColor(int r, int g, int b);
 
 private:
-  SDL_Renderer *renderer;
-  SDL_Texture *font;
-  unordered_map<char, SDL_Rect> letterRects;
+  struct PlacedGlyph
+  {
+    const SDL_Rect *src;
+    SDL_Rect dst;
+    // Characters (spaces and newlines included) before this glyph, which is
+    // what charsToRender is compared against.
+    int revealIndex;
+  };
+
+  struct TextLayout
+  {
+    string text;
+    SDL_Rect area;
+    vector<PlacedGlyph> glyphs;
+    unsigned long long lastUsed;
+  };
+
+  const TextLayout &GetLayout(string_view text, const SDL_Rect *textArea);
+  void LayoutTextWrapped(TextLayout &layout);
+
+  SpriteBatch *batch;
+  SpriteSheet *font;
+  // Slots are recycled in place with room for a screen of text, so relaying
+  // out text allocates nothing either.
+  vector<TextLayout> layouts;
+  unsigned long long layoutUseCount = 0;
 };
@@ -0,0 +1,198 @@
+#include <unordered_map>
+#include <vector>
+#include <SDL.h>
+#include "constants.h"
+#include "atlas.h"
+#include "sprite_batch.h"
+#include "world.h"
+#include "tile_map_renderer.h"
+
+using namespace std;
+
+const SDL_Rect TILE_RECTS[] = {
+    {x : 0, y : 0, w : 16, h : 16},  // G
+    {x : 16, y : 0, w : 16, h : 16}, // W
+    {x : 32, y : 0, w : 16, h : 16}, // M
+    {x : 48, y : 0, w : 16, h : 16}, // H
+};
+
+const size_t MAX_CACHED_CHUNKS = 32;
+
+int FloorDiv(int a, int b)
+{
+  return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+long long ChunkKey(int chunkX, int chunkY)
+{
+  return ((long long)chunkY << 32) | (unsigned int)chunkX;
+}
+
+TileMapRenderer::TileMapRenderer(SpriteBatch *batch, SpriteSheet *worldMap, const World *world)
+    : batch(batch), worldMap(worldMap), world(world)
+{
+  SDL_Renderer *renderer = batch->GetRenderer();
+  useRenderTargets = SDL_RenderTargetSupported(renderer);
+  if (!useRenderTargets)
+  {
+    printf("Render targets are not supported, drawing map tiles directly\n");
+    return;
+  }
+  // One more than the budget for the ocean chunk.
+  for (size_t i = 0; i <= MAX_CACHED_CHUNKS; i++)
+  {
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, CHUNK_W, CHUNK_H);
+    if (texture == NULL)
+    {
+      printf("Unable to create chunk texture, drawing map tiles directly! SDL Error: %s\n", SDL_GetError());
+      useRenderTargets = false;
+      return;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    freeTextures.push_back(texture);
+  }
+  oceanChunk.texture = freeTextures.back();
+  freeTextures.pop_back();
+}
+
+TileMapRenderer::~TileMapRenderer()
+{
+  for (auto &[key, chunk] : chunks)
+  {
+    SDL_DestroyTexture(chunk.texture);
+  }
+  for (SDL_Texture *texture : freeTextures)
+  {
+    SDL_DestroyTexture(texture);
+  }
+  if (oceanChunk.texture != NULL)
+  {
+    SDL_DestroyTexture(oceanChunk.texture);
+  }
+}
+
+void TileMapRenderer::Draw(int cameraX, int cameraY)
+{
+  if (!useRenderTargets)
+  {
+    DrawTilesDirect(cameraX, cameraY);
+    return;
+  }
+
+  drawCount++;
+  int firstChunkX = FloorDiv(cameraX, CHUNK_W), lastChunkX = FloorDiv(cameraX + GAME_W - 1, CHUNK_W);
+  int firstChunkY = FloorDiv(cameraY, CHUNK_H), lastChunkY = FloorDiv(cameraY + GAME_H - 1, CHUNK_H);
+  for (int chunkY = firstChunkY; chunkY <= lastChunkY; chunkY++)
+  {
+    for (int chunkX = firstChunkX; chunkX <= lastChunkX; chunkX++)
+    {
+      SDL_Texture *texture = GetChunkTexture(chunkX, chunkY);
+      SDL_Rect dstRect = {x : chunkX * CHUNK_W - cameraX, y : chunkY * CHUNK_H - cameraY, w : CHUNK_W, h : CHUNK_H};
+      batch->Draw(texture, NULL, &dstRect);
+    }
+  }
+}
+
+void TileMapRenderer::InvalidateAll()
+{
+  for (auto &[key, chunk] : chunks)
+  {
+    chunk.dirty = true;
+  }
+  oceanChunk.dirty = true;
+}
+
+SDL_Texture *TileMapRenderer::GetChunkTexture(int chunkX, int chunkY)
+{
+  ChunkTexture *chunk;
+  unsigned int revision = 0;
+  if (world->IsChunkInWorld(chunkX, chunkY))
+  {
+    long long key = ChunkKey(chunkX, chunkY);
+    auto it = chunks.find(key);
+    if (it == chunks.end())
+    {
+      SDL_Texture *texture;
+      if (freeTextures.empty())
+      {
+        texture = EvictLeastRecentlyUsed();
+      }
+      else
+      {
+        texture = freeTextures.back();
+        freeTextures.pop_back();
+      }
+      it = chunks.emplace(key, ChunkTexture{texture, true, 0, 0}).first;
+    }
+    chunk = &it->second;
+    revision = world->GetChunkRevision(chunkX, chunkY);
+  }
+  else
+  {
+    chunk = &oceanChunk;
+  }
+
+  if (chunk->dirty || chunk->bakedRevision != revision)
+  {
+    BakeChunk(chunk->texture, chunkX, chunkY);
+    chunk->dirty = false;
+    chunk->bakedRevision = revision;
+  }
+  chunk->lastUsed = drawCount;
+  return chunk->texture;
+}
+
+void TileMapRenderer::BakeChunk(SDL_Texture *texture, int chunkX, int chunkY)
+{
+  batch->BeginTarget(texture);
+
+  // Padding past the world edge is stored as water, so an in-world chunk can
+  // be read straight through; the shared ocean chunk has no storage at all.
+  const Tile *chunkTiles = world->IsChunkInWorld(chunkX, chunkY) ? world->GetChunk(chunkX, chunkY) : NULL;
+  SDL_Rect dstRect = {x : 0, y : 0, w : TILE_W, h : TILE_H};
+  for (int y = 0; y < CHUNK_TILES; y++)
+  {
+    for (int x = 0; x < CHUNK_TILES; x++)
+    {
+      dstRect.x = x * TILE_W;
+      dstRect.y = y * TILE_H;
+      Tile tile = chunkTiles != NULL ? chunkTiles[y * CHUNK_TILES + x] : W;
+      batch->Draw(worldMap, &TILE_RECTS[tile & TILE_MASK], &dstRect);
+    }
+  }
+
+  batch->EndTarget();
+}
+
+void TileMapRenderer::DrawTilesDirect(int cameraX, int cameraY)
+{
+  int firstTileX = FloorDiv(cameraX, TILE_W), lastTileX = FloorDiv(cameraX + GAME_W - 1, TILE_W);
+  int firstTileY = FloorDiv(cameraY, TILE_H), lastTileY = FloorDiv(cameraY + GAME_H - 1, TILE_H);
+  SDL_Rect dstRect = {x : 0, y : 0, w : TILE_W, h : TILE_H};
+  for (int tileY = firstTileY; tileY <= lastTileY; tileY++)
+  {
+    for (int tileX = firstTileX; tileX <= lastTileX; tileX++)
+    {
+      dstRect.x = tileX * TILE_W - cameraX;
+      dstRect.y = tileY * TILE_H - cameraY;
+      batch->Draw(worldMap, &TILE_RECTS[world->Get(tileX, tileY)], &dstRect);
+    }
+  }
+}
+
+SDL_Texture *TileMapRenderer::EvictLeastRecentlyUsed()
+{
+  auto oldest = chunks.begin();
+  for (auto it = chunks.begin(); it != chunks.end(); ++it)
+  {
+    if (it->second.lastUsed < oldest->second.lastUsed)
+    {
+      oldest = it;
+    }
+  }
+  // The texture may still be drawn from in the frame being played, but that
+  // is done before this frame's rebake of it is.
+  SDL_Texture *texture = oldest->second.texture;
+  chunks.erase(oldest);
+  return texture;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <SDL.h>
+#include "constants.h"
+#include "atlas.h"
+#include "sprite_batch.h"
+#include "world.h"
+
+using namespace std;
+
+// Draws the world map from CHUNK_TILES x CHUNK_TILES blocks of tiles that are
+// baked once into render-target textures, so a frame costs a few chunk blits
+// instead of one copy per visible tile. Chunks are rebaked only when their
+// World revision changes. The textures are all made up front, so drawing never
+// needs the renderer; past that budget the least recently drawn chunk gives
+// up its texture.
+class TileMapRenderer
+{
+public:
+  TileMapRenderer(SpriteBatch *batch, SpriteSheet *worldMap, const World *world);
+  ~TileMapRenderer();
+
+  // cameraX/cameraY is the world pixel drawn at the top left of the screen.
+  void Draw(int cameraX, int cameraY);
+
+  // Every cached chunk is rebaked on next use. Needed after
+  // SDL_RENDER_TARGETS_RESET, when the renderer drops target contents.
+  void InvalidateAll();
+
+private:
+  struct ChunkTexture
+  {
+    SDL_Texture *texture;
+    bool dirty;
+    unsigned int bakedRevision;
+    unsigned long long lastUsed;
+  };
+
+  SDL_Texture *GetChunkTexture(int chunkX, int chunkY);
+  void BakeChunk(SDL_Texture *texture, int chunkX, int chunkY);
+  void DrawTilesDirect(int cameraX, int cameraY);
+  SDL_Texture *EvictLeastRecentlyUsed();
+
+  SpriteBatch *batch;
+  SpriteSheet *worldMap;
+  const World *world;
+  bool useRenderTargets;
+  unordered_map<long long, ChunkTexture> chunks;
+  vector<SDL_Texture *> freeTextures;
+  // Every chunk entirely outside the world is water, so they share one bake.
+  ChunkTexture oceanChunk = {NULL, true, 0, 0};
+  unsigned long long drawCount = 0;
+};
@@ -0,0 +1,285 @@
+// Monte Carlo balance runs for the battle rules: plays many battles with a
+// fixed strategy on every core and prints win rate, turn counts and damage
+// rolls as JSON.
+//
+// Usage:
+//   battle_sim [--battles N] [--threads N] [--seed N] [--max-turns N]
+//              [--policy attack|magic|mixed] [--formation NAME]
+//
+// Enemies come from the game's content (assets/content/, run from the
+// repository root); the default formation is the one the game fights.
+//
+// Battle i always uses RNG stream i of the seed, so results only depend on
+// the seed and the battle count, not on how the work was split up.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../rng.cpp"
+#include "../battle.cpp"
+#include "../content.cpp"
+
+using namespace std;
+
+enum class Policy
+{
+  Attack,
+  Magic,
+  Mixed
+};
+
+const char *POLICY_NAMES[] = {"attack", "magic", "mixed"};
+const char *ACTION_NAMES[BATTLE_ACTION_COUNT] = {"attack", "magic", "item", "run"};
+const int MAX_RULE_AMOUNT = 64;
+
+struct SimStats
+{
+  long long battles = 0;
+  long long wins = 0;
+  // turnCounts[t] is how many battles were won in exactly t turns.
+  vector<long long> turnCounts;
+  long long amountCounts[BATTLE_ACTION_COUNT][MAX_RULE_AMOUNT + 1] = {};
+};
+
+struct SimOptions
+{
+  long long battles = 1000000;
+  int threads = 0;
+  uint64_t seed = 1;
+  int maxTurns = 100;
+  Policy policy = Policy::Mixed;
+  string formation;
+  int enemyHp[MAX_BATTLE_ENEMIES];
+  int enemyCount = 0;
+};
+
+BattleAction ChooseAction(Policy policy, Rng *rng)
+{
+  switch (policy)
+  {
+  case Policy::Attack:
+    return BattleAction::Attack;
+  case Policy::Magic:
+    return BattleAction::Magic;
+  default:
+    return rng->Range(0, 1) == 0 ? BattleAction::Attack : BattleAction::Magic;
+  }
+}
+
+void SimulateRange(const SimOptions &options, long long first, long long last, SimStats *stats)
+{
+  stats->turnCounts.assign(options.maxTurns + 1, 0);
+  BattleState state;
+  for (long long i = first; i < last; i++)
+  {
+    Rng rng(options.seed, i);
+    StartBattle(&state, options.enemyHp, options.enemyCount);
+
+    // Focus fire: always hit the first enemy still standing.
+    int target;
+    while ((target = FirstLivingEnemy(&state)) >= 0 && state.turns < options.maxTurns)
+    {
+      BattleAction action = ChooseAction(options.policy, &rng);
+      BattleResult result = PerformAction(&state, action, target, &rng);
+      stats->amountCounts[static_cast<int>(action)][result.amount]++;
+    }
+
+    stats->battles++;
+    if (target < 0)
+    {
+      stats->wins++;
+      stats->turnCounts[state.turns]++;
+    }
+  }
+}
+
+// -1 when no battle was won, like min and max.
+int TurnPercentile(const SimStats &stats, double percentile)
+{
+  if (stats.wins == 0)
+  {
+    return -1;
+  }
+  long long rank = (long long)(stats.wins * percentile);
+  long long seen = 0;
+  for (int turns = 0; turns < (int)stats.turnCounts.size(); turns++)
+  {
+    seen += stats.turnCounts[turns];
+    if (seen > rank)
+    {
+      return turns;
+    }
+  }
+  return (int)stats.turnCounts.size() - 1;
+}
+
+void PrintJson(const SimOptions &options, const SimStats &stats, int threads, double seconds)
+{
+  long long turnSum = 0;
+  int minTurns = -1, maxTurns = -1;
+  for (int turns = 0; turns < (int)stats.turnCounts.size(); turns++)
+  {
+    if (stats.turnCounts[turns] > 0)
+    {
+      turnSum += turns * stats.turnCounts[turns];
+      minTurns = minTurns < 0 ? turns : minTurns;
+      maxTurns = turns;
+    }
+  }
+
+  printf("{\n");
+  printf("  \"battles\": %lld,\n", stats.battles);
+  printf("  \"threads\": %d,\n", threads);
+  printf("  \"seed\": %llu,\n", (unsigned long long)options.seed);
+  printf("  \"policy\": \"%s\",\n", POLICY_NAMES[static_cast<int>(options.policy)]);
+  printf("  \"formation\": \"%s\",\n", options.formation.c_str());
+  printf("  \"maxTurns\": %d,\n", options.maxTurns);
+  printf("  \"seconds\": %.3f,\n", seconds);
+  printf("  \"battlesPerSecond\": %.0f,\n", stats.battles / seconds);
+  printf("  \"winRate\": %.6f,\n", (double)stats.wins / stats.battles);
+  printf("  \"turnsToWin\": {\"mean\": %.3f, \"min\": %d, \"p50\": %d, \"p95\": %d, \"p99\": %d, \"max\": %d},\n",
+         stats.wins > 0 ? (double)turnSum / stats.wins : 0.0, minTurns,
+         TurnPercentile(stats, 0.5), TurnPercentile(stats, 0.95), TurnPercentile(stats, 0.99), maxTurns);
+  printf("  \"rolls\": {");
+  bool firstAction = true;
+  for (int action = 0; action < BATTLE_ACTION_COUNT; action++)
+  {
+    const BattleActionRule &rule = BATTLE_ACTION_RULES[action];
+    long long rolls = 0, total = 0;
+    for (int amount = 0; amount <= rule.maxAmount; amount++)
+    {
+      rolls += stats.amountCounts[action][amount];
+      total += amount * stats.amountCounts[action][amount];
+    }
+    if (rolls == 0)
+    {
+      continue;
+    }
+    printf("%s\n    \"%s\": {\"count\": %lld, \"mean\": %.4f, \"distribution\": [", firstAction ? "" : ",",
+           ACTION_NAMES[action], rolls, (double)total / rolls);
+    for (int amount = rule.minAmount; amount <= rule.maxAmount; amount++)
+    {
+      printf("%s%.4f", amount > rule.minAmount ? ", " : "", (double)stats.amountCounts[action][amount] / rolls);
+    }
+    printf("]}");
+    firstAction = false;
+  }
+  printf("\n  }\n}\n");
+}
+
+int main(int argc, char **argv)
+{
+  SimOptions options;
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    string arg = argv[i];
+    if (arg == "--battles")
+    {
+      options.battles = atoll(argv[i + 1]);
+    }
+    else if (arg == "--threads")
+    {
+      options.threads = atoi(argv[i + 1]);
+    }
+    else if (arg == "--seed")
+    {
+      options.seed = strtoull(argv[i + 1], NULL, 10);
+    }
+    else if (arg == "--max-turns")
+    {
+      options.maxTurns = atoi(argv[i + 1]);
+    }
+    else if (arg == "--policy")
+    {
+      string policy = argv[i + 1];
+      options.policy = policy == "attack" ? Policy::Attack : policy == "magic" ? Policy::Magic
+                                                                               : Policy::Mixed;
+    }
+    else if (arg == "--formation")
+    {
+      options.formation = argv[i + 1];
+    }
+    else
+    {
+      printf("Unknown option %s\n", arg.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+  for (const BattleActionRule &rule : BATTLE_ACTION_RULES)
+  {
+    if (rule.maxAmount > MAX_RULE_AMOUNT)
+    {
+      printf("Action amounts above %d are not tracked\n", MAX_RULE_AMOUNT);
+      return EXIT_FAILURE;
+    }
+  }
+  if (options.battles < 1 || options.maxTurns < 1)
+  {
+    printf("--battles and --max-turns must be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  Content *content = Content::Load("assets/content", "assets/content.tbc");
+  if (content == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+  int formationIndex = options.formation.empty() ? 0 : content->FindFormation(options.formation);
+  if (formationIndex < 0)
+  {
+    printf("No formation %s in assets/content/formations.json\n", options.formation.c_str());
+    return EXIT_FAILURE;
+  }
+  const Formation &formation = content->GetFormation(formationIndex);
+  options.formation = formation.name;
+  options.enemyCount = formation.slotCount;
+  for (int i = 0; i < formation.slotCount; i++)
+  {
+    options.enemyHp[i] = content->GetEnemyKind(formation.slots[i].enemyKind).hp;
+  }
+  delete content;
+
+  int threads = options.threads > 0 ? options.threads : (int)thread::hardware_concurrency();
+  threads = max(1, (int)min<long long>(threads, options.battles));
+
+  auto start = chrono::steady_clock::now();
+  vector<SimStats> threadStats(threads);
+  vector<thread> workers;
+  for (int t = 0; t < threads; t++)
+  {
+    long long first = options.battles * t / threads, last = options.battles * (t + 1) / threads;
+    workers.emplace_back(SimulateRange, cref(options), first, last, &threadStats[t]);
+  }
+  for (thread &worker : workers)
+  {
+    worker.join();
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  SimStats total;
+  total.turnCounts.assign(options.maxTurns + 1, 0);
+  for (const SimStats &stats : threadStats)
+  {
+    total.battles += stats.battles;
+    total.wins += stats.wins;
+    for (int turns = 0; turns <= options.maxTurns; turns++)
+    {
+      total.turnCounts[turns] += stats.turnCounts[turns];
+    }
+    for (int action = 0; action < BATTLE_ACTION_COUNT; action++)
+    {
+      for (int amount = 0; amount <= MAX_RULE_AMOUNT; amount++)
+      {
+        total.amountCounts[action][amount] += stats.amountCounts[action][amount];
+      }
+    }
+  }
+
+  PrintJson(options, total, threads, seconds);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+// Writes .tbw world files for the game to memory-map.
+//
+// Usage:
+//   convert_world <map.png> <out.tbw>
+//     One pixel per tile, mapped to the closest of the TILE_COLORS below.
+//   convert_world --random <width> <height> <seed> <out.tbw>
+//     Noise terrain: the top-left width x height tiles of what the game
+//     generates for that --seed.
+
+#include <cstdlib>
+#include <string>
+#include <SDL.h>
+#include <SDL_image.h>
+#include "../constants.h"
+#include "../mapped_file.cpp"
+#include "../terrain.cpp"
+#include "../save_state.cpp"
+#include "../world.cpp"
+
+using namespace std;
+
+const SDL_Color TILE_COLORS[] = {
+    {r : 56, g : 168, b : 56, a : 255},  // G
+    {r : 48, g : 96, b : 200, a : 255},  // W
+    {r : 128, g : 128, b : 128, a : 255}, // M
+    {r : 160, g : 128, b : 64, a : 255},  // H
+};
+
+Tile ClosestTile(Uint8 r, Uint8 g, Uint8 b)
+{
+  int bestTile = 0, bestDistance = INT32_MAX;
+  for (int tile = 0; tile < 4; tile++)
+  {
+    int dr = r - TILE_COLORS[tile].r, dg = g - TILE_COLORS[tile].g, db = b - TILE_COLORS[tile].b;
+    int distance = dr * dr + dg * dg + db * db;
+    if (distance < bestDistance)
+    {
+      bestDistance = distance;
+      bestTile = tile;
+    }
+  }
+  return (Tile)bestTile;
+}
+
+World *WorldFromImage(const string &path)
+{
+  SDL_Surface *loaded = IMG_Load(path.c_str());
+  if (loaded == NULL)
+  {
+    printf("Unable to load %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError());
+    return NULL;
+  }
+  SDL_Surface *image = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+  SDL_FreeSurface(loaded);
+
+  World *world = new World(image->w, image->h);
+  SDL_LockSurface(image);
+  for (int y = 0; y < image->h; y++)
+  {
+    const Uint8 *row = (const Uint8 *)image->pixels + y * image->pitch;
+    for (int x = 0; x < image->w; x++)
+    {
+      world->Set(x, y, ClosestTile(row[x * 4], row[x * 4 + 1], row[x * 4 + 2]));
+    }
+  }
+  SDL_UnlockSurface(image);
+  SDL_FreeSurface(image);
+  return world;
+}
+
+int main(int argc, char **argv)
+{
+  World *world;
+  string outPath;
+  if (argc == 6 && string(argv[1]) == "--random")
+  {
+    world = World::Generate(atoi(argv[2]), atoi(argv[3]), strtoull(argv[4], NULL, 10));
+    outPath = argv[5];
+  }
+  else if (argc == 3)
+  {
+    if (IMG_Init(IMG_INIT_PNG) < 1)
+    {
+      printf("SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError());
+      return EXIT_FAILURE;
+    }
+    world = WorldFromImage(argv[1]);
+    outPath = argv[2];
+  }
+  else
+  {
+    printf("Usage: %s <map.png> <out.tbw>\n       %s --random <width> <height> <seed> <out.tbw>\n", argv[0], argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (world == NULL || !world->Save(outPath))
+  {
+    printf("Unable to write %s\n", outPath.c_str());
+    return EXIT_FAILURE;
+  }
+  printf("Wrote %s (%dx%d tiles)\n", outPath.c_str(), world->GetWidth(), world->GetHeight());
+  delete world;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,182 @@
+// Writes assets/assets.tbp, a single pre-decoded archive the game
+// memory-maps instead of opening and inflating each PNG at startup.
+//
+// Usage (from the repository root): pack_assets [assetsDir] [out.tbp]
+//
+// Atlas pages come from assets/atlas{N}.png when tools/pack_atlas has been
+// run, otherwise they are composed from the sheets the same way the game
+// does. Every .wav and .ogg in assets/ is stored as is.
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include <SDL_image.h>
+#include "../atlas.h"
+#include "../asset_pack.h"
+
+using namespace std;
+
+// What every desktop SDL renderer picks first, so textures can usually be
+// filled without a conversion.
+const SDL_PixelFormatEnum PACK_PIXEL_FORMAT = SDL_PIXELFORMAT_ARGB8888;
+
+SDL_Surface *LoadAtlasPage(int page, const string &assetsDir)
+{
+  string pagePath = assetsDir + "/atlas" + to_string(page) + ".png";
+  SDL_Surface *surface = IMG_Load(pagePath.c_str());
+  if (surface != NULL)
+  {
+    return surface;
+  }
+
+  printf("No packed atlas at %s, composing it from the source sheets\n", pagePath.c_str());
+  surface = SDL_CreateRGBSurfaceWithFormat(0, ATLAS_PAGE_W, ATLAS_PAGE_H, 32, SDL_PIXELFORMAT_RGBA32);
+  for (const AtlasEntry &entry : ATLAS_ENTRIES)
+  {
+    if (entry.page != page)
+    {
+      continue;
+    }
+    string sheetPath = assetsDir + "/" + entry.file;
+    SDL_Surface *sheet = IMG_Load(sheetPath.c_str());
+    if (sheet == NULL)
+    {
+      printf("Unable to load %s! SDL_image Error: %s\n", sheetPath.c_str(), IMG_GetError());
+      SDL_FreeSurface(surface);
+      return NULL;
+    }
+    SDL_Rect srcRect = {x : 0, y : 0, w : min(sheet->w, entry.rect.w), h : min(sheet->h, entry.rect.h)};
+    SDL_Rect dstRect = entry.rect;
+    SDL_SetSurfaceBlendMode(sheet, SDL_BLENDMODE_NONE);
+    SDL_BlitSurface(sheet, &srcRect, surface, &dstRect);
+    SDL_FreeSurface(sheet);
+  }
+  return surface;
+}
+
+void PadTo(ofstream &out, uint64_t *position, uint64_t alignment)
+{
+  static const char padding[ASSET_PACK_ALIGN] = {};
+  uint64_t padLength = (alignment - *position % alignment) % alignment;
+  out.write(padding, padLength);
+  *position += padLength;
+}
+
+bool SetName(AssetPackEntry *entry, const string &name)
+{
+  if (name.length() >= ASSET_PACK_NAME_LENGTH)
+  {
+    printf("%s is too long for an asset pack name\n", name.c_str());
+    return false;
+  }
+  memcpy(entry->name, name.c_str(), name.length());
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  string assetsDir = argc > 1 ? argv[1] : "assets";
+  string outPath = argc > 2 ? argv[2] : assetsDir + "/assets.tbp";
+
+  if (SDL_Init(0) < 0 || IMG_Init(IMG_INIT_PNG) < 1)
+  {
+    printf("SDL could not initialize! SDL Error: %s\n", SDL_GetError());
+    return EXIT_FAILURE;
+  }
+
+  ofstream out(outPath, ios::binary | ios::trunc);
+  if (!out)
+  {
+    printf("Unable to write %s\n", outPath.c_str());
+    return EXIT_FAILURE;
+  }
+
+  AssetPackHeader header = {};
+  memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic));
+  header.version = ASSET_PACK_VERSION;
+  out.write((const char *)&header, sizeof(header));
+  uint64_t position = sizeof(header);
+  vector<AssetPackEntry> index;
+
+  for (int page = 0; page < ATLAS_PAGE_COUNT; page++)
+  {
+    SDL_Surface *loaded = LoadAtlasPage(page, assetsDir);
+    if (loaded == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+    SDL_Surface *surface = SDL_ConvertSurfaceFormat(loaded, PACK_PIXEL_FORMAT, 0);
+    SDL_FreeSurface(loaded);
+
+    AssetPackEntry entry = {};
+    if (!SetName(&entry, "atlas" + to_string(page) + ".png"))
+    {
+      return EXIT_FAILURE;
+    }
+    entry.kind = ASSET_PACK_IMAGE;
+    entry.format = PACK_PIXEL_FORMAT;
+    entry.width = surface->w;
+    entry.height = surface->h;
+    entry.pitch = surface->w * SDL_BYTESPERPIXEL(PACK_PIXEL_FORMAT);
+
+    PadTo(out, &position, ASSET_PACK_ALIGN);
+    entry.offset = position;
+    entry.size = (uint64_t)entry.pitch * entry.height;
+    SDL_LockSurface(surface);
+    for (int y = 0; y < surface->h; y++)
+    {
+      out.write((const char *)surface->pixels + y * surface->pitch, entry.pitch);
+    }
+    SDL_UnlockSurface(surface);
+    SDL_FreeSurface(surface);
+    position += entry.size;
+    index.push_back(entry);
+    printf("Packed %s (%ux%u)\n", entry.name, entry.width, entry.height);
+  }
+
+  for (const auto &dirEntry : filesystem::directory_iterator(assetsDir))
+  {
+    if (dirEntry.path().extension() != ".wav" && dirEntry.path().extension() != ".ogg")
+    {
+      continue;
+    }
+    ifstream in(dirEntry.path(), ios::binary);
+    vector<char> data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    AssetPackEntry entry = {};
+    if (!SetName(&entry, dirEntry.path().filename().string()))
+    {
+      return EXIT_FAILURE;
+    }
+    entry.kind = ASSET_PACK_RAW;
+    PadTo(out, &position, ASSET_PACK_ALIGN);
+    entry.offset = position;
+    entry.size = data.size();
+    out.write(data.data(), data.size());
+    position += entry.size;
+    index.push_back(entry);
+    printf("Packed %s (%llu bytes)\n", entry.name, (unsigned long long)entry.size);
+  }
+
+  PadTo(out, &position, ASSET_PACK_ALIGN);
+  header.entryCount = index.size();
+  header.indexOffset = position;
+  out.write((const char *)index.data(), index.size() * sizeof(AssetPackEntry));
+  out.seekp(0);
+  out.write((const char *)&header, sizeof(header));
+  if (!out)
+  {
+    printf("Unable to write %s\n", outPath.c_str());
+    return EXIT_FAILURE;
+  }
+  printf("Wrote %s (%zu entries)\n", outPath.c_str(), index.size());
+
+  IMG_Quit();
+  SDL_Quit();
+  return EXIT_SUCCESS;
+}
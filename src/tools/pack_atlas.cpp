@@ -0,0 +1,152 @@
+// Packs every sheet in assets/ into atlas pages and regenerates
+// src/atlas_layout.h, the table the game uses to find each sheet on a page.
+//
+// Usage (from the repository root): pack_atlas [assetsDir] [layoutHeader]
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include <SDL_image.h>
+
+using namespace std;
+
+const int ATLAS_MIN_PAGE = 128, ATLAS_MAX_PAGE = 2048;
+const int ATLAS_PADDING = 1;
+
+struct PackedSheet
+{
+  string file;
+  SDL_Surface *surface;
+  int page;
+  SDL_Rect rect;
+};
+
+// Shelf packing: tallest sheets first, left to right, starting a new shelf
+// when a row fills up and a new page when the shelves run out. Returns the
+// number of pages used.
+int PackShelves(vector<PackedSheet> &sheets, int pageSize)
+{
+  int page = 0, x = 0, y = 0, shelfH = 0;
+  for (PackedSheet &sheet : sheets)
+  {
+    int w = sheet.surface->w, h = sheet.surface->h;
+    if (x + w > pageSize)
+    {
+      x = 0;
+      y += shelfH + ATLAS_PADDING;
+      shelfH = 0;
+    }
+    if (y + h > pageSize)
+    {
+      page++;
+      x = 0;
+      y = 0;
+      shelfH = 0;
+    }
+    sheet.page = page;
+    sheet.rect = {x : x, y : y, w : w, h : h};
+    x += w + ATLAS_PADDING;
+    shelfH = max(shelfH, h);
+  }
+  return page + 1;
+}
+
+int main(int argc, char **argv)
+{
+  string assetsDir = argc > 1 ? argv[1] : "assets";
+  string layoutPath = argc > 2 ? argv[2] : "src/atlas_layout.h";
+
+  if (SDL_Init(0) < 0 || IMG_Init(IMG_INIT_PNG) < 1)
+  {
+    printf("SDL could not initialize! SDL Error: %s\n", SDL_GetError());
+    return EXIT_FAILURE;
+  }
+
+  vector<PackedSheet> sheets;
+  for (const auto &dirEntry : filesystem::directory_iterator(assetsDir))
+  {
+    string file = dirEntry.path().filename().string();
+    if (dirEntry.path().extension() != ".png" || file.starts_with("atlas"))
+    {
+      continue;
+    }
+
+    SDL_Surface *surface = IMG_Load(dirEntry.path().string().c_str());
+    if (surface == NULL)
+    {
+      printf("Unable to load %s! SDL_image Error: %s\n", file.c_str(), IMG_GetError());
+      return EXIT_FAILURE;
+    }
+    if (surface->w > ATLAS_MAX_PAGE || surface->h > ATLAS_MAX_PAGE)
+    {
+      printf("%s is larger than the maximum atlas page (%d)!\n", file.c_str(), ATLAS_MAX_PAGE);
+      return EXIT_FAILURE;
+    }
+    sheets.push_back({file : file, surface : surface, page : 0, rect : {}});
+  }
+
+  sort(sheets.begin(), sheets.end(), [](const PackedSheet &a, const PackedSheet &b)
+       {
+    if (a.surface->h != b.surface->h)
+      return a.surface->h > b.surface->h;
+    if (a.surface->w != b.surface->w)
+      return a.surface->w > b.surface->w;
+    return a.file < b.file; });
+
+  // Use the smallest power-of-two page that holds everything; only fall back
+  // to several pages once even the largest page is not enough.
+  int pageSize = ATLAS_MIN_PAGE;
+  int pageCount = PackShelves(sheets, pageSize);
+  while (pageCount > 1 && pageSize < ATLAS_MAX_PAGE)
+  {
+    pageSize *= 2;
+    pageCount = PackShelves(sheets, pageSize);
+  }
+
+  for (int page = 0; page < pageCount; page++)
+  {
+    SDL_Surface *pageSurface = SDL_CreateRGBSurfaceWithFormat(0, pageSize, pageSize, 32, SDL_PIXELFORMAT_RGBA32);
+    for (PackedSheet &sheet : sheets)
+    {
+      if (sheet.page == page)
+      {
+        SDL_Rect dstRect = sheet.rect;
+        SDL_SetSurfaceBlendMode(sheet.surface, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(sheet.surface, NULL, pageSurface, &dstRect);
+      }
+    }
+
+    string pagePath = assetsDir + "/atlas" + to_string(page) + ".png";
+    if (IMG_SavePNG(pageSurface, pagePath.c_str()) < 0)
+    {
+      printf("Unable to write %s! SDL_image Error: %s\n", pagePath.c_str(), IMG_GetError());
+      return EXIT_FAILURE;
+    }
+    SDL_FreeSurface(pageSurface);
+    printf("Wrote %s (%dx%d)\n", pagePath.c_str(), pageSize, pageSize);
+  }
+
+  ofstream layout(layoutPath);
+  layout << "#pragma once\n\n"
+         << "// Generated by tools/pack_atlas.cpp from assets/*.png. Do not edit by hand;\n"
+         << "// rerun the packer whenever a sheet is added or resized.\n\n"
+         << "const int ATLAS_PAGE_W = " << pageSize << ", ATLAS_PAGE_H = " << pageSize << ";\n"
+         << "const int ATLAS_PAGE_COUNT = " << pageCount << ";\n\n"
+         << "const AtlasEntry ATLAS_ENTRIES[] = {\n";
+  for (PackedSheet &sheet : sheets)
+  {
+    layout << "    {file : \"" << sheet.file << "\", page : " << sheet.page
+           << ", rect : {x : " << sheet.rect.x << ", y : " << sheet.rect.y
+           << ", w : " << sheet.rect.w << ", h : " << sheet.rect.h << "}},\n";
+    SDL_FreeSurface(sheet.surface);
+  }
+  layout << "};\n";
+  printf("Wrote %s (%zu sheets)\n", layoutPath.c_str(), sheets.size());
+
+  IMG_Quit();
+  SDL_Quit();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,756 @@
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "constants.h"
+#include "mapped_file.h"
+#include "save_state.h"
+#include "terrain.h"
+#include "world.h"
+
+using namespace std;
+
+const int CHUNK_SHIFT = __builtin_ctz(CHUNK_TILES);
+const int RESIDENT_REGION_RADIUS = 1;
+static_assert((WORLD_CHANGE_LOG_SIZE & (WORLD_CHANGE_LOG_SIZE - 1)) == 0, "The change log is indexed by revision");
+
+// Shared storage for chunks a world file marks as a single repeated tile.
+const Tile *FillChunk(Tile tile)
+{
+  static Tile fillChunks[4][CHUNK_AREA];
+  static bool initialized = false;
+  if (!initialized)
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      fill(fillChunks[i], fillChunks[i] + CHUNK_AREA, (Tile)i);
+    }
+    initialized = true;
+  }
+  return fillChunks[tile];
+}
+
+World::World(int width, int height)
+    : width(width),
+      height(height),
+      chunksW((width + CHUNK_TILES - 1) / CHUNK_TILES),
+      chunksH((height + CHUNK_TILES - 1) / CHUNK_TILES),
+      chunks((size_t)chunksW * chunksH),
+      chunkOwned((size_t)chunksW * chunksH, true),
+      chunkEdited((size_t)chunksW * chunksH, false),
+      tiles((size_t)chunksW * chunksH * CHUNK_AREA, W),
+      revisions((size_t)chunksW * chunksH, 0),
+      changeLog(WORLD_CHANGE_LOG_SIZE)
+{
+  for (size_t chunk = 0; chunk < chunks.size(); chunk++)
+  {
+    chunks[chunk] = &tiles[chunk * CHUNK_AREA];
+  }
+}
+
+World::~World()
+{
+  {
+    lock_guard<mutex> guard(generatorLock);
+    generatorsStopping = true;
+  }
+  generatorWork.notify_all();
+  for (thread &generator : generators)
+  {
+    generator.join();
+  }
+}
+
+World *World::Generate(int width, int height, uint64_t seed)
+{
+  World *world = new World(width, height);
+  world->seed = seed;
+  int threads = max(1, (int)thread::hardware_concurrency());
+  vector<thread> workers;
+  for (int t = 0; t < threads; t++)
+  {
+    workers.emplace_back([world, t, threads]
+                         {
+                           for (size_t chunk = t; chunk < world->chunks.size(); chunk += threads)
+                           {
+                             world->GenerateChunkTiles(chunk, &world->tiles[chunk * CHUNK_AREA]);
+                           } });
+  }
+  for (thread &worker : workers)
+  {
+    worker.join();
+  }
+  return world;
+}
+
+World *World::GenerateOnDemand(int width, int height, uint64_t seed, int threads)
+{
+  World *world = new World(0, 0);
+  world->width = width;
+  world->height = height;
+  world->chunksW = (width + CHUNK_TILES - 1) / CHUNK_TILES;
+  world->chunksH = (height + CHUNK_TILES - 1) / CHUNK_TILES;
+  size_t chunkCount = (size_t)world->chunksW * world->chunksH;
+  world->chunks.assign(chunkCount, FillChunk(W));
+  world->chunkOwned.assign(chunkCount, false);
+  world->chunkEdited.assign(chunkCount, false);
+  world->revisions.assign(chunkCount, 0);
+  world->seed = seed;
+  world->chunkStates.assign(chunkCount, ChunkState::Missing);
+  world->readyChunks.resize(chunkCount);
+
+  if (threads <= 0)
+  {
+    threads = max(1, (int)thread::hardware_concurrency() - 1);
+  }
+  for (int t = 0; t < threads; t++)
+  {
+    world->generators.emplace_back(&World::GeneratorLoop, world);
+  }
+  return world;
+}
+
+// FNV-1a over the file's size and modification time, which is cheaper to
+// check than the contents.
+static uint64_t StampWorldFile(const string &path, uint64_t size)
+{
+  error_code error;
+  int64_t modified = filesystem::last_write_time(path, error).time_since_epoch().count();
+  uint64_t stamp = 0xcbf29ce484222325ULL;
+  for (uint64_t value : {size, (uint64_t)modified})
+  {
+    for (int i = 0; i < 8; i++)
+    {
+      stamp = (stamp ^ ((value >> (i * 8)) & 0xff)) * 0x100000001b3ULL;
+    }
+  }
+  return stamp;
+}
+
+World *World::Open(const string &path)
+{
+  unique_ptr<MappedFile> file = make_unique<MappedFile>();
+  if (!file->Open(path))
+  {
+    return NULL;
+  }
+
+  WorldFileHeader header;
+  if (file->GetSize() < sizeof(header))
+  {
+    printf("%s is too small to be a world file\n", path.c_str());
+    return NULL;
+  }
+  memcpy(&header, file->GetData(), sizeof(header));
+  if (memcmp(header.magic, WORLD_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != WORLD_FILE_VERSION)
+  {
+    printf("%s is not a version %u world file\n", path.c_str(), WORLD_FILE_VERSION);
+    return NULL;
+  }
+  if (header.chunkTiles != CHUNK_TILES || header.regionChunks != WORLD_REGION_CHUNKS)
+  {
+    printf("%s uses %ux%u chunks, expected %dx%d\n", path.c_str(), header.chunkTiles, header.chunkTiles, CHUNK_TILES, CHUNK_TILES);
+    return NULL;
+  }
+
+  // Tiles are looked up by chunk without checking against chunksW, so the
+  // chunk grid has to be exactly the one that covers width x height.
+  if (header.width > INT_MAX || header.height > INT_MAX ||
+      header.chunksW != ((uint64_t)header.width + CHUNK_TILES - 1) / CHUNK_TILES ||
+      header.chunksH != ((uint64_t)header.height + CHUNK_TILES - 1) / CHUNK_TILES)
+  {
+    printf("%s has %ux%u chunks for a %ux%u world\n", path.c_str(), header.chunksW, header.chunksH, header.width, header.height);
+    return NULL;
+  }
+  size_t chunkCount = (size_t)header.chunksW * header.chunksH;
+  if (header.indexOffset > file->GetSize() || chunkCount > (file->GetSize() - header.indexOffset) / sizeof(WorldFileChunk))
+  {
+    printf("%s has a truncated chunk index\n", path.c_str());
+    return NULL;
+  }
+
+  World *world = new World(0, 0);
+  world->width = header.width;
+  world->height = header.height;
+  world->chunksW = header.chunksW;
+  world->chunksH = header.chunksH;
+
+  // Only the index is read up front. Tile data stays on disk until a chunk
+  // is first drawn or queried, and is masked with TILE_MASK as it is read.
+  world->fileIndex = (const WorldFileChunk *)(file->GetData() + header.indexOffset);
+  world->chunks.resize(chunkCount);
+  world->chunkOwned.assign(chunkCount, false);
+  world->chunkEdited.assign(chunkCount, false);
+  world->revisions.assign(chunkCount, 0);
+  for (size_t chunk = 0; chunk < chunkCount; chunk++)
+  {
+    const WorldFileChunk &entry = world->fileIndex[chunk];
+    if (entry.offset == 0)
+    {
+      if (entry.fillTile > H)
+      {
+        printf("%s has a damaged chunk\n", path.c_str());
+        delete world;
+        return NULL;
+      }
+      world->chunks[chunk] = FillChunk((Tile)entry.fillTile);
+    }
+    else if (file->GetSize() >= CHUNK_AREA && entry.offset <= file->GetSize() - CHUNK_AREA)
+    {
+      world->chunks[chunk] = (const Tile *)(file->GetData() + entry.offset);
+    }
+    else
+    {
+      printf("%s has a chunk past the end of the file\n", path.c_str());
+      delete world;
+      return NULL;
+    }
+  }
+  world->file = move(file);
+  world->fileStamp = StampWorldFile(path, world->file->GetSize());
+  return world;
+}
+
+bool World::Save(const string &path) const
+{
+  ofstream out(path, ios::binary | ios::trunc);
+  if (!out)
+  {
+    return false;
+  }
+
+  WorldFileHeader header = {};
+  memcpy(header.magic, WORLD_FILE_MAGIC, sizeof(header.magic));
+  header.version = WORLD_FILE_VERSION;
+  header.width = width;
+  header.height = height;
+  header.chunkTiles = CHUNK_TILES;
+  header.chunksW = chunksW;
+  header.chunksH = chunksH;
+  header.regionChunks = WORLD_REGION_CHUNKS;
+  header.indexOffset = sizeof(WorldFileHeader);
+
+  vector<WorldFileChunk> index((size_t)chunksW * chunksH, WorldFileChunk{});
+  uint64_t position = header.indexOffset + index.size() * sizeof(WorldFileChunk);
+  out.write((const char *)&header, sizeof(header));
+  out.write((const char *)index.data(), index.size() * sizeof(WorldFileChunk));
+
+  static const char padding[WORLD_REGION_ALIGN] = {};
+  int regionsW = (chunksW + WORLD_REGION_CHUNKS - 1) / WORLD_REGION_CHUNKS;
+  int regionsH = (chunksH + WORLD_REGION_CHUNKS - 1) / WORLD_REGION_CHUNKS;
+  for (int regionY = 0; regionY < regionsH; regionY++)
+  {
+    for (int regionX = 0; regionX < regionsW; regionX++)
+    {
+      bool regionStarted = false;
+      for (int y = regionY * WORLD_REGION_CHUNKS; y < min(chunksH, (regionY + 1) * WORLD_REGION_CHUNKS); y++)
+      {
+        for (int x = regionX * WORLD_REGION_CHUNKS; x < min(chunksW, (regionX + 1) * WORLD_REGION_CHUNKS); x++)
+        {
+          const Tile *chunkTiles = GetChunk(x, y);
+          WorldFileChunk &entry = index[(size_t)y * chunksW + x];
+          if (all_of(chunkTiles, chunkTiles + CHUNK_AREA, [&](Tile tile)
+                     { return tile == chunkTiles[0]; }))
+          {
+            entry.fillTile = chunkTiles[0];
+            continue;
+          }
+
+          if (!regionStarted && position % WORLD_REGION_ALIGN != 0)
+          {
+            uint64_t padLength = WORLD_REGION_ALIGN - position % WORLD_REGION_ALIGN;
+            out.write(padding, padLength);
+            position += padLength;
+          }
+          regionStarted = true;
+          entry.offset = position;
+          out.write((const char *)chunkTiles, CHUNK_AREA);
+          position += CHUNK_AREA;
+        }
+      }
+    }
+  }
+
+  out.seekp(header.indexOffset);
+  out.write((const char *)index.data(), index.size() * sizeof(WorldFileChunk));
+  return out.good();
+}
+
+bool World::IsGeneratedOnDemand() const
+{
+  return !chunkStates.empty();
+}
+
+uint64_t World::GetFileStamp() const
+{
+  return fileStamp;
+}
+
+int World::GetWidth() const
+{
+  return width;
+}
+
+int World::GetHeight() const
+{
+  return height;
+}
+
+int World::GetChunksW() const
+{
+  return chunksW;
+}
+
+int World::GetChunksH() const
+{
+  return chunksH;
+}
+
+Tile World::Get(int x, int y) const
+{
+  if (x < 0 || y < 0 || x >= width || y >= height)
+  {
+    return W;
+  }
+  return GetUnchecked(x, y);
+}
+
+Tile World::GetUnchecked(int x, int y) const
+{
+  return (Tile)(chunks[ChunkIndex(x, y)][((y & (CHUNK_TILES - 1)) << CHUNK_SHIFT) | (x & (CHUNK_TILES - 1))] & TILE_MASK);
+}
+
+void World::Set(int x, int y, Tile tile)
+{
+  if (x < 0 || y < 0 || x >= width || y >= height)
+  {
+    return;
+  }
+
+  size_t chunk = ChunkIndex(x, y);
+  GetWritableChunk(chunk)[((y & (CHUNK_TILES - 1)) << CHUNK_SHIFT) | (x & (CHUNK_TILES - 1))] = tile;
+  chunkEdited[chunk] = true;
+  MarkChanged(chunk);
+}
+
+const Tile *World::GetChunk(int chunkX, int chunkY) const
+{
+  return chunks[(size_t)chunkY * chunksW + chunkX];
+}
+
+unsigned int World::GetChunkRevision(int chunkX, int chunkY) const
+{
+  return revisions[(size_t)chunkY * chunksW + chunkX];
+}
+
+unsigned int World::GetRevision() const
+{
+  return revision;
+}
+
+bool World::GetChangedChunks(unsigned int since, vector<size_t> *out) const
+{
+  // Unsigned, so this still holds once the revision wraps around.
+  if (revision - since > (unsigned int)WORLD_CHANGE_LOG_SIZE)
+  {
+    return false;
+  }
+  for (unsigned int r = since; r != revision; r++)
+  {
+    out->push_back(changeLog[r & (WORLD_CHANGE_LOG_SIZE - 1)]);
+  }
+  return true;
+}
+
+bool World::IsChunkInWorld(int chunkX, int chunkY) const
+{
+  return chunkX >= 0 && chunkY >= 0 && chunkX < chunksW && chunkY < chunksH;
+}
+
+void World::FindLand(int *tileX, int *tileY, int maxChunks) const
+{
+  int centerX = clamp(*tileX, 0, max(width - 1, 0)) >> CHUNK_SHIFT;
+  int centerY = clamp(*tileY, 0, max(height - 1, 0)) >> CHUNK_SHIFT;
+  Tile generated[CHUNK_AREA];
+  for (int radius = 0; radius <= maxChunks; radius++)
+  {
+    for (int y = centerY - radius; y <= centerY + radius; y++)
+    {
+      // Only the ring's outline; the inside was looked at already.
+      int step = y == centerY - radius || y == centerY + radius ? 1 : max(radius * 2, 1);
+      for (int x = centerX - radius; x <= centerX + radius; x += step)
+      {
+        if (!IsChunkInWorld(x, y))
+        {
+          continue;
+        }
+        size_t chunk = (size_t)y * chunksW + x;
+        const Tile *chunkTiles = chunks[chunk];
+        if (IsGeneratedOnDemand() && chunkStates[chunk] != ChunkState::Added)
+        {
+          GenerateChunkTiles(chunk, generated);
+          chunkTiles = generated;
+        }
+        if (count_if(chunkTiles, chunkTiles + CHUNK_AREA, [](Tile tile)
+                     { return TILE_MOVE_COSTS[tile & TILE_MASK] > 0; }) * 2 > CHUNK_AREA)
+        {
+          *tileX = x * CHUNK_TILES + CHUNK_TILES / 2;
+          *tileY = y * CHUNK_TILES + CHUNK_TILES / 2;
+          return;
+        }
+      }
+    }
+  }
+}
+
+void World::UpdateResidency(int tileX, int tileY, Direction heading)
+{
+  if (IsGeneratedOnDemand())
+  {
+    GenerateAround(tileX, tileY, heading);
+    return;
+  }
+  if (file == NULL)
+  {
+    return;
+  }
+
+  int regionTiles = CHUNK_TILES * WORLD_REGION_CHUNKS;
+  int regionX = clamp(tileX, 0, max(width - 1, 0)) / regionTiles;
+  int regionY = clamp(tileY, 0, max(height - 1, 0)) / regionTiles;
+  int minX = regionX - RESIDENT_REGION_RADIUS, maxX = regionX + RESIDENT_REGION_RADIUS;
+  int minY = regionY - RESIDENT_REGION_RADIUS, maxY = regionY + RESIDENT_REGION_RADIUS;
+  if (minX == residentMinX && minY == residentMinY && maxX == residentMaxX && maxY == residentMaxY)
+  {
+    return;
+  }
+
+  for (int y = residentMinY; y <= residentMaxY; y++)
+  {
+    for (int x = residentMinX; x <= residentMaxX; x++)
+    {
+      if (x < minX || x > maxX || y < minY || y > maxY)
+      {
+        AdviseRegion(x, y, false);
+      }
+    }
+  }
+  for (int y = minY; y <= maxY; y++)
+  {
+    for (int x = minX; x <= maxX; x++)
+    {
+      if (x < residentMinX || x > residentMaxX || y < residentMinY || y > residentMaxY)
+      {
+        AdviseRegion(x, y, true);
+      }
+    }
+  }
+
+  residentMinX = minX;
+  residentMinY = minY;
+  residentMaxX = maxX;
+  residentMaxY = maxY;
+}
+
+size_t World::MemoryUsage() const
+{
+  size_t usage = sizeof(World) +
+                 tiles.capacity() * sizeof(Tile) +
+                 ownedChunks.size() * CHUNK_AREA +
+                 chunks.capacity() * sizeof(const Tile *) +
+                 chunkOwned.capacity() / 8 +
+                 chunkEdited.capacity() / 8 +
+                 revisions.capacity() * sizeof(unsigned int) +
+                 changeLog.capacity() * sizeof(uint32_t) +
+                 chunkStates.capacity() * sizeof(ChunkState) +
+                 readyChunks.capacity() * sizeof(unique_ptr<Tile[]>) +
+                 count(chunkStates.begin(), chunkStates.end(), ChunkState::Ready) * CHUNK_AREA;
+  if (file != NULL)
+  {
+    int residentRegions = (residentMaxX - residentMinX + 1) * (residentMaxY - residentMinY + 1);
+    usage += (size_t)max(residentRegions, 0) * WORLD_REGION_ALIGN;
+  }
+  return usage;
+}
+
+void World::SnapshotChunks(vector<SaveChunk> *out, vector<Tile> *tiles) const
+{
+  bool onDemand = IsGeneratedOnDemand();
+  for (size_t chunk = 0; chunk < chunks.size(); chunk++)
+  {
+    if (chunkEdited[chunk])
+    {
+      const Tile *chunkTiles = chunks[chunk];
+      SaveChunk saved = {chunk : (uint32_t)chunk, kind : SAVE_CHUNK_FILL, fillTile : chunkTiles[0], dataSize : 0, dataOffset : 0};
+      if (!all_of(chunkTiles, chunkTiles + CHUNK_AREA, [&](Tile tile)
+                  { return tile == chunkTiles[0]; }))
+      {
+        saved.kind = SAVE_CHUNK_TILES;
+        tiles->insert(tiles->end(), chunkTiles, chunkTiles + CHUNK_AREA);
+      }
+      out->push_back(saved);
+    }
+    else if (onDemand && chunkStates[chunk] == ChunkState::Added)
+    {
+      out->push_back({chunk : (uint32_t)chunk, kind : SAVE_CHUNK_GENERATED, fillTile : 0, dataSize : 0, dataOffset : 0});
+    }
+  }
+}
+
+bool World::RestoreChunks(const SaveFile *save)
+{
+  const SaveChunk *saved = save->GetChunks();
+  uint32_t count = save->GetHeader().chunkCount;
+  bool onDemand = IsGeneratedOnDemand();
+  for (uint32_t i = 0; i < count; i++)
+  {
+    if (saved[i].chunk >= chunks.size() || saved[i].kind > SAVE_CHUNK_TILES || saved[i].fillTile > H ||
+        (saved[i].kind == SAVE_CHUNK_GENERATED && !onDemand))
+    {
+      return false;
+    }
+  }
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    size_t chunk = saved[i].chunk;
+    // Generated chunks come out the same every time, so only the ones that
+    // were edited afterwards need their tiles from the save.
+    if (onDemand && chunkStates[chunk] != ChunkState::Added)
+    {
+      AddGeneratedChunk(chunk);
+    }
+    if (saved[i].kind == SAVE_CHUNK_GENERATED)
+    {
+      continue;
+    }
+    Tile *chunkTiles = GetWritableChunk(chunk);
+    if (saved[i].kind == SAVE_CHUNK_FILL)
+    {
+      fill(chunkTiles, chunkTiles + CHUNK_AREA, (Tile)saved[i].fillTile);
+    }
+    else
+    {
+      save->DecodeChunk(saved[i], chunkTiles);
+    }
+    chunkEdited[chunk] = true;
+    MarkChanged(chunk);
+  }
+  return true;
+}
+
+size_t World::ChunkIndex(int x, int y) const
+{
+  return (size_t)(y >> CHUNK_SHIFT) * chunksW + (x >> CHUNK_SHIFT);
+}
+
+void World::MarkChanged(size_t chunk)
+{
+  changeLog[revision & (WORLD_CHANGE_LOG_SIZE - 1)] = chunk;
+  revisions[chunk]++;
+  revision++;
+}
+
+Tile *World::GetWritableChunk(size_t chunk)
+{
+  if (!chunkOwned[chunk])
+  {
+    // Mapped chunks are read-only, so the first edit takes a private copy.
+    ownedChunks.push_back(make_unique<Tile[]>(CHUNK_AREA));
+    transform(chunks[chunk], chunks[chunk] + CHUNK_AREA, ownedChunks.back().get(), [](Tile tile)
+              { return (Tile)(tile & TILE_MASK); });
+    chunks[chunk] = ownedChunks.back().get();
+    chunkOwned[chunk] = true;
+  }
+  return const_cast<Tile *>(chunks[chunk]);
+}
+
+void World::AdviseRegion(int regionX, int regionY, bool resident)
+{
+  // A region's stored chunks are contiguous, so its byte range is just the
+  // span of their offsets.
+  uint64_t start = UINT64_MAX, end = 0;
+  for (int y = regionY * WORLD_REGION_CHUNKS; y < (regionY + 1) * WORLD_REGION_CHUNKS; y++)
+  {
+    for (int x = regionX * WORLD_REGION_CHUNKS; x < (regionX + 1) * WORLD_REGION_CHUNKS; x++)
+    {
+      if (!IsChunkInWorld(x, y))
+      {
+        continue;
+      }
+      uint64_t offset = fileIndex[(size_t)y * chunksW + x].offset;
+      if (offset != 0)
+      {
+        start = min(start, offset);
+        end = max(end, offset + CHUNK_AREA);
+      }
+    }
+  }
+
+  if (start >= end)
+  {
+    return;
+  }
+  if (resident)
+  {
+    file->Prefetch(start, end - start);
+  }
+  else
+  {
+    file->Release(start, end - start);
+  }
+}
+
+void World::GenerateChunkTiles(size_t chunk, Tile *chunkTiles) const
+{
+  int chunkX = chunk % chunksW, chunkY = chunk / chunksW;
+  GenerateTerrainChunk(seed, chunkX, chunkY, chunkTiles);
+  int edgeX = width - chunkX * CHUNK_TILES, edgeY = height - chunkY * CHUNK_TILES;
+  if (edgeX >= CHUNK_TILES && edgeY >= CHUNK_TILES)
+  {
+    return;
+  }
+  for (int y = 0; y < CHUNK_TILES; y++)
+  {
+    for (int x = 0; x < CHUNK_TILES; x++)
+    {
+      if (x >= edgeX || y >= edgeY)
+      {
+        chunkTiles[(y << CHUNK_SHIFT) | x] = W;
+      }
+    }
+  }
+}
+
+void World::GenerateAround(int tileX, int tileY, Direction heading)
+{
+  int centerX = clamp(tileX, 0, max(width - 1, 0)) >> CHUNK_SHIFT;
+  int centerY = clamp(tileY, 0, max(height - 1, 0)) >> CHUNK_SHIFT;
+  if (centerX == generatedCenterX && centerY == generatedCenterY && heading == generatedHeading)
+  {
+    return;
+  }
+  generatedCenterX = centerX;
+  generatedCenterY = centerY;
+  generatedHeading = heading;
+
+  vector<GeneratedChunk> results;
+  {
+    lock_guard<mutex> guard(generatorLock);
+    results.swap(generatorResults);
+  }
+  for (GeneratedChunk &result : results)
+  {
+    // Chunks that were needed before their thread got to them are already
+    // in; those copies go to waste.
+    if (chunkStates[result.chunk] == ChunkState::Queued)
+    {
+      readyChunks[result.chunk] = move(result.tiles);
+      chunkStates[result.chunk] = ChunkState::Ready;
+    }
+  }
+
+  for (int y = centerY - WORLD_GENERATE_RADIUS; y <= centerY + WORLD_GENERATE_RADIUS; y++)
+  {
+    for (int x = centerX - WORLD_GENERATE_RADIUS; x <= centerX + WORLD_GENERATE_RADIUS; x++)
+    {
+      if (IsChunkInWorld(x, y) && chunkStates[(size_t)y * chunksW + x] != ChunkState::Added)
+      {
+        AddGeneratedChunk((size_t)y * chunksW + x);
+      }
+    }
+  }
+
+  // The queue only ever holds the chunks around where the player is headed
+  // now, nearest first; whatever the threads have not started on from
+  // earlier calls is dropped. Some of those may have just been added above,
+  // and stay added.
+  int aheadX = centerX, aheadY = centerY;
+  switch (heading)
+  {
+  case LEFT:
+    aheadX -= WORLD_PREFETCH_AHEAD;
+    break;
+  case RIGHT:
+    aheadX += WORLD_PREFETCH_AHEAD;
+    break;
+  case UP:
+    aheadY -= WORLD_PREFETCH_AHEAD;
+    break;
+  case DOWN:
+    aheadY += WORLD_PREFETCH_AHEAD;
+    break;
+  }
+  lock_guard<mutex> guard(generatorLock);
+  for (size_t chunk : generatorQueue)
+  {
+    if (chunkStates[chunk] == ChunkState::Queued)
+    {
+      chunkStates[chunk] = ChunkState::Missing;
+    }
+  }
+  generatorQueue.clear();
+  for (int distance = 0; distance <= WORLD_PREFETCH_RADIUS + WORLD_PREFETCH_AHEAD; distance++)
+  {
+    for (int y = aheadY - WORLD_PREFETCH_RADIUS; y <= aheadY + WORLD_PREFETCH_RADIUS; y++)
+    {
+      for (int x = aheadX - WORLD_PREFETCH_RADIUS; x <= aheadX + WORLD_PREFETCH_RADIUS; x++)
+      {
+        size_t chunk = (size_t)y * chunksW + x;
+        if (max(abs(x - centerX), abs(y - centerY)) == distance && IsChunkInWorld(x, y) &&
+            chunkStates[chunk] == ChunkState::Missing)
+        {
+          generatorQueue.push_back(chunk);
+          chunkStates[chunk] = ChunkState::Queued;
+        }
+      }
+    }
+  }
+  generatorWork.notify_all();
+}
+
+void World::AddGeneratedChunk(size_t chunk)
+{
+  unique_ptr<Tile[]> chunkTiles = move(readyChunks[chunk]);
+  if (chunkTiles == NULL)
+  {
+    chunkTiles = make_unique<Tile[]>(CHUNK_AREA);
+    GenerateChunkTiles(chunk, chunkTiles.get());
+  }
+  chunks[chunk] = chunkTiles.get();
+  chunkOwned[chunk] = true;
+  ownedChunks.push_back(move(chunkTiles));
+  chunkStates[chunk] = ChunkState::Added;
+  MarkChanged(chunk);
+}
+
+void World::GeneratorLoop()
+{
+  while (true)
+  {
+    size_t chunk;
+    {
+      unique_lock<mutex> guard(generatorLock);
+      generatorWork.wait(guard, [this]
+                         { return generatorsStopping || !generatorQueue.empty(); });
+      if (generatorsStopping)
+      {
+        return;
+      }
+      chunk = generatorQueue.front();
+      generatorQueue.pop_front();
+    }
+
+    unique_ptr<Tile[]> chunkTiles = make_unique<Tile[]>(CHUNK_AREA);
+    GenerateChunkTiles(chunk, chunkTiles.get());
+    lock_guard<mutex> guard(generatorLock);
+    generatorResults.push_back({chunk : chunk, tiles : move(chunkTiles)});
+  }
+}
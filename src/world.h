@@ -0,0 +1,194 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "constants.h"
+#include "mapped_file.h"
+#include "save_state.h"
+
+using namespace std;
+
+// World file (.tbw), little-endian:
+//   WorldFileHeader
+//   WorldFileChunk index[chunksW * chunksH], row-major by chunk
+//   chunk data, grouped into regions of WORLD_REGION_CHUNKS x
+//   WORLD_REGION_CHUNKS chunks that each start on a 4 KB boundary, so one
+//   region is exactly one page and can be paged in or dropped on its own.
+const char WORLD_FILE_MAGIC[4] = {'T', 'B', 'R', 'W'};
+const uint32_t WORLD_FILE_VERSION = 1;
+const int WORLD_REGION_CHUNKS = 4;
+const int WORLD_REGION_ALIGN = 4096;
+
+// Generated on demand: chunks within WORLD_GENERATE_RADIUS chunks of the
+// player exist before the game can look at them, and the ones up to
+// WORLD_PREFETCH_RADIUS around a spot WORLD_PREFETCH_AHEAD chunks in the
+// walking direction are made in the background.
+const int WORLD_GENERATE_RADIUS = 3;
+const int WORLD_PREFETCH_RADIUS = 4;
+const int WORLD_PREFETCH_AHEAD = 2;
+// How many of the latest chunk changes GetChangedChunks() can list. A power
+// of two, so the log can be indexed by revision.
+const int WORLD_CHANGE_LOG_SIZE = 1024;
+
+struct WorldFileHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t width, height;
+  uint32_t chunkTiles;
+  uint32_t chunksW, chunksH;
+  uint32_t regionChunks;
+  uint64_t indexOffset;
+};
+
+struct WorldFileChunk
+{
+  uint64_t offset; // 0 when every tile in the chunk is fillTile
+  uint8_t fillTile;
+  uint8_t reserved[7];
+};
+
+// Tile storage for the world map. Tiles are one byte each and grouped into
+// CHUNK_TILES x CHUNK_TILES chunks that are contiguous in memory (row-major
+// inside a chunk), so a chunk is a single 256 byte block. Chunks along the
+// right and bottom edges are padded with water.
+//
+// A world is either generated in memory or opened from a world file, in
+// which case chunks point straight into the mapping and are only copied when
+// edited. Generated worlds can also be made a chunk at a time as the player
+// explores, so a huge one costs nothing up front.
+class World
+{
+public:
+  World(int width, int height);
+  ~World();
+  static World *Open(const string &path);
+  // Noise terrain from seed (see terrain.h), all of it now, spread over
+  // every core.
+  static World *Generate(int width, int height, uint64_t seed);
+  // The same terrain, but chunks only appear once UpdateResidency() is
+  // called near them; until then they read as water. threads <= 0 uses one
+  // background thread per core, less one for the game.
+  static World *GenerateOnDemand(int width, int height, uint64_t seed, int threads = 0);
+  bool Save(const string &path) const;
+
+  bool IsGeneratedOnDemand() const;
+  // Changes whenever the file Open() read is resized or saved over, so
+  // what is built from it can be cached. 0 for generated worlds.
+  uint64_t GetFileStamp() const;
+  int GetWidth() const;
+  int GetHeight() const;
+  int GetChunksW() const;
+  int GetChunksH() const;
+
+  // Returns water outside the world.
+  Tile Get(int x, int y) const;
+  // Caller guarantees 0 <= x < GetChunksW() * CHUNK_TILES (same for y).
+  Tile GetUnchecked(int x, int y) const;
+  void Set(int x, int y, Tile tile);
+
+  // CHUNK_TILES * CHUNK_TILES tiles, row-major. They may come straight from
+  // the world file, so mask them with TILE_MASK before using them as indices.
+  const Tile *GetChunk(int chunkX, int chunkY) const;
+  // Bumped on every Set() inside the chunk, so caches can tell when to rebuild.
+  unsigned int GetChunkRevision(int chunkX, int chunkY) const;
+  // Bumped on every Set() anywhere, to skip looking at each chunk's.
+  unsigned int GetRevision() const;
+  // Appends the index of the chunk behind each revision bump after since,
+  // oldest first, to out; a chunk changed twice is there twice. False if
+  // that goes back past the last WORLD_CHANGE_LOG_SIZE changes, in which
+  // case the caller has to compare every chunk's revision instead.
+  bool GetChangedChunks(unsigned int since, vector<size_t> *out) const;
+  bool IsChunkInWorld(int chunkX, int chunkY) const;
+
+  // Moves (tileX, tileY) to the middle of the nearest chunk that is mostly
+  // land, looking in rings of chunks up to maxChunks away, including chunks
+  // not generated yet. Leaves them as they are if there is none.
+  void FindLand(int *tileX, int *tileY, int maxChunks) const;
+
+  // Keeps the file regions around (tileX, tileY) paged in and lets the OS
+  // drop the rest. For worlds generated on demand, adds every chunk within
+  // WORLD_GENERATE_RADIUS, making any the background threads have not
+  // finished yet, and queues the ones ahead in heading. Chunks only ever
+  // appear here, so the same calls always leave the same tiles, however
+  // far the threads got.
+  void UpdateResidency(int tileX, int tileY, Direction heading);
+
+  // Heap owned by the world plus the mapped pages kept resident.
+  size_t MemoryUsage() const;
+
+  // For save files: appends every chunk that differs from the world as
+  // Open() or GenerateOnDemand() first made it to out, and the tiles of
+  // the edited ones to tiles.
+  void SnapshotChunks(vector<SaveChunk> *out, vector<Tile> *tiles) const;
+  // Puts back the chunks of a save made from a world that was opened or
+  // generated the same way. False, changing nothing, if they don't fit.
+  bool RestoreChunks(const SaveFile *save);
+
+private:
+  enum class ChunkState : uint8_t
+  {
+    Missing,
+    Queued,
+    Ready, // generated in the background, not added yet
+    Added
+  };
+  struct GeneratedChunk
+  {
+    size_t chunk;
+    unique_ptr<Tile[]> tiles;
+  };
+
+  size_t ChunkIndex(int x, int y) const;
+  // Bumps the chunk's revision and the world's, and logs the change.
+  void MarkChanged(size_t chunk);
+  // The chunk's tiles, copied out of the mapping first if need be.
+  Tile *GetWritableChunk(size_t chunk);
+  void AdviseRegion(int regionX, int regionY, bool resident);
+  // Noise terrain for the chunk, with anything past the world's edge
+  // turned to water.
+  void GenerateChunkTiles(size_t chunk, Tile *chunkTiles) const;
+  void GenerateAround(int tileX, int tileY, Direction heading);
+  void AddGeneratedChunk(size_t chunk);
+  void GeneratorLoop();
+
+  int width, height;
+  int chunksW, chunksH;
+  vector<const Tile *> chunks;
+  vector<bool> chunkOwned;
+  // Changed by Set() or a save since the world was made.
+  vector<bool> chunkEdited;
+  vector<Tile> tiles;
+  // Chunks copied on their first edit, or generated on demand.
+  vector<unique_ptr<Tile[]>> ownedChunks;
+  vector<unsigned int> revisions;
+  unsigned int revision = 0;
+  // changeLog[r % WORLD_CHANGE_LOG_SIZE] is the chunk that changed going
+  // from revision r to r + 1.
+  vector<uint32_t> changeLog;
+
+  // Generation on demand. chunkStates and readyChunks belong to the game
+  // thread; the generator threads only see the two queues.
+  uint64_t seed = 0;
+  vector<ChunkState> chunkStates;
+  vector<unique_ptr<Tile[]>> readyChunks;
+  int generatedCenterX = -1, generatedCenterY = -1;
+  Direction generatedHeading = DOWN;
+  vector<thread> generators;
+  mutex generatorLock;
+  condition_variable generatorWork;
+  deque<size_t> generatorQueue;
+  vector<GeneratedChunk> generatorResults;
+  bool generatorsStopping = false;
+
+  unique_ptr<MappedFile> file;
+  const WorldFileChunk *fileIndex = NULL;
+  uint64_t fileStamp = 0;
+  int residentMinX = 0, residentMinY = 0, residentMaxX = -1, residentMaxY = -1;
+};